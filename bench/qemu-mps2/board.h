@@ -0,0 +1,206 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: board.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Reemplazo mínimo de los módulos board/chip/sapi de la EDU-CIAA para correr
+ * el kernel en la placa mps2-an386 (Cortex-M4F) emulada por QEMU. Solo
+ * declara lo que usan el kernel y el port del Cortex-M4: los periféricos del
+ * núcleo (SCB, SysTick, NVIC, DWT, CoreDebug y FPU) y los intrínsecos de
+ * CMSIS, con las mismas direcciones y nombres.
+ *
+ *===========================================================================*/
+
+#ifndef BENCH_QEMU_MPS2_BOARD_H_
+#define BENCH_QEMU_MPS2_BOARD_H_
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+
+/********************************************************************************
+ * Definicion de las constantes
+ *******************************************************************************/
+#define __NVIC_PRIO_BITS			3			// Igual que el LPC4337 (PendSV_Handler.S)
+#define __FPU_USED					1
+
+typedef enum  {
+	NonMaskableInt_IRQn		= -14,
+	HardFault_IRQn			= -13,
+	MemoryManagement_IRQn	= -12,
+	BusFault_IRQn			= -11,
+	UsageFault_IRQn			= -10,
+	SVCall_IRQn				= -5,
+	DebugMonitor_IRQn		= -4,
+	PendSV_IRQn				= -2,
+	SysTick_IRQn			= -1,
+	UART0RX_IRQn			= 0				// Primera interrupción externa de la AN386
+} IRQn_Type;
+
+
+/********************************************************************************
+ * Periféricos del núcleo
+ *******************************************************************************/
+typedef struct  {
+	volatile uint32_t CPUID, ICSR, VTOR, AIRCR, SCR, CCR;
+	volatile uint8_t SHP[12];
+	volatile uint32_t SHCSR, CFSR, HFSR, DFSR, MMFAR, BFAR, AFSR;
+	volatile uint32_t PFR[2], DFR, ADR, MMFR[4], ISAR[5];
+	uint32_t RESERVADO0[5];
+	volatile uint32_t CPACR;
+} SCB_Type;
+
+typedef struct  {
+	volatile uint32_t CTRL, LOAD, VAL, CALIB;
+} SysTick_Type;
+
+typedef struct  {
+	volatile uint32_t ISER[8];
+	uint32_t RESERVADO0[24];
+	volatile uint32_t ICER[8];
+	uint32_t RESERVADO1[24];
+	volatile uint32_t ISPR[8];
+	uint32_t RESERVADO2[24];
+	volatile uint32_t ICPR[8];
+	uint32_t RESERVADO3[24];
+	volatile uint32_t IABR[8];
+	uint32_t RESERVADO4[56];
+	volatile uint8_t IP[240];
+} NVIC_Type;
+
+typedef struct  {
+	volatile uint32_t CTRL, CYCCNT;
+} DWT_Type;
+
+typedef struct  {
+	volatile uint32_t DHCSR, DCRSR, DCRDR, DEMCR;
+} CoreDebug_Type;
+
+typedef struct  {
+	uint32_t RESERVADO0;
+	volatile uint32_t FPCCR, FPCAR, FPDSCR;
+} FPU_Type;
+
+#define SCB					((SCB_Type*)0xE000ED00UL)
+#define SysTick				((SysTick_Type*)0xE000E010UL)
+#define NVIC				((NVIC_Type*)0xE000E100UL)
+#define DWT					((DWT_Type*)0xE0001000UL)
+#define CoreDebug			((CoreDebug_Type*)0xE000EDF0UL)
+#define FPU					((FPU_Type*)0xE000EF30UL)
+
+#define SCB_ICSR_PENDSVSET_Msk			(1UL << 28)
+#define SCB_ICSR_PENDSTSET_Msk			(1UL << 26)
+#define SysTick_CTRL_COUNTFLAG_Msk		(1UL << 16)
+#define SysTick_CTRL_CLKSOURCE_Msk		(1UL << 2)
+#define SysTick_CTRL_TICKINT_Msk		(1UL << 1)
+#define SysTick_CTRL_ENABLE_Msk			(1UL << 0)
+#define SysTick_LOAD_RELOAD_Msk			0xFFFFFFUL
+#define DWT_CTRL_CYCCNTENA_Msk			(1UL << 0)
+#define DWT_CTRL_NOCYCCNT_Msk			(1UL << 25)
+#define CoreDebug_DEMCR_TRCENA_Msk		(1UL << 24)
+#define FPU_FPCCR_ASPEN_Msk				(1UL << 31)
+#define FPU_FPCCR_LSPEN_Msk				(1UL << 30)
+#define CONTROL_FPCA_Msk				(1UL << 2)
+
+
+/********************************************************************************
+ * Intrínsecos de CMSIS
+ *******************************************************************************/
+static inline void __ISB(void)  { __asm volatile("isb 0xF" ::: "memory"); }
+static inline void __DSB(void)  { __asm volatile("dsb 0xF" ::: "memory"); }
+static inline void __DMB(void)  { __asm volatile("dmb 0xF" ::: "memory"); }
+static inline void __NOP(void)  { __asm volatile("nop"); }
+static inline void __WFI(void)  { __asm volatile("wfi"); }
+
+static inline uint32_t __CLZ(uint32_t valor)  {
+	uint32_t resultado;
+
+	__asm("clz %0, %1" : "=r"(resultado) : "r"(valor));
+	return resultado;
+}
+
+static inline uint32_t __RBIT(uint32_t valor)  {
+	uint32_t resultado;
+
+	__asm("rbit %0, %1" : "=r"(resultado) : "r"(valor));
+	return resultado;
+}
+
+static inline uint32_t __get_IPSR(void)  {
+	uint32_t resultado;
+
+	__asm volatile("mrs %0, ipsr" : "=r"(resultado));
+	return resultado;
+}
+
+static inline uint32_t __get_PRIMASK(void)  {
+	uint32_t resultado;
+
+	__asm volatile("mrs %0, primask" : "=r"(resultado));
+	return resultado;
+}
+
+static inline uint32_t __get_BASEPRI(void)  {
+	uint32_t resultado;
+
+	__asm volatile("mrs %0, basepri" : "=r"(resultado));
+	return resultado;
+}
+
+static inline void __set_BASEPRI(uint32_t valor)  {
+	__asm volatile("msr basepri, %0" :: "r"(valor) : "memory");
+}
+
+static inline void __set_BASEPRI_MAX(uint32_t valor)  {
+	__asm volatile("msr basepri_max, %0" :: "r"(valor) : "memory");
+}
+
+static inline uint32_t __get_CONTROL(void)  {
+	uint32_t resultado;
+
+	__asm volatile("mrs %0, control" : "=r"(resultado));
+	return resultado;
+}
+
+static inline void __set_CONTROL(uint32_t valor)  {
+	__asm volatile("msr control, %0" :: "r"(valor) : "memory");
+}
+
+static inline void __set_PSP(uint32_t valor)  {
+	__asm volatile("msr psp, %0" :: "r"(valor));
+}
+
+static inline void NVIC_SetPriority(IRQn_Type irq, uint32_t prioridad)  {
+	uint8_t valor=(uint8_t)(prioridad << (8-__NVIC_PRIO_BITS));
+
+	if(irq<0)
+		SCB->SHP[((uint32_t)irq & 0xF)-4]=valor;
+	else
+		NVIC->IP[irq]=valor;
+}
+
+static inline uint32_t SysTick_Config(uint32_t ciclos)  {
+	if(ciclos-1 > SysTick_LOAD_RELOAD_Msk)
+		return 1;
+
+	SysTick->LOAD=ciclos-1;
+	NVIC_SetPriority(SysTick_IRQn, (1 << __NVIC_PRIO_BITS)-1);
+	SysTick->VAL=0;
+	SysTick->CTRL=SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+	return 0;
+}
+
+
+/********************************************************************************
+ * Definicion de las variables externas
+ *******************************************************************************/
+extern uint32_t SystemCoreClock;				// 25 MHz en la mps2-an386
+
+
+#endif /* BENCH_QEMU_MPS2_BOARD_H_ */
@@ -0,0 +1,548 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: main.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * Benchmarks de las primitivas del kernel en la mps2-an386 emulada por QEMU.
+ * tareaBench (la más prioritaria) corre cada benchmark despertando a sus
+ * tareas y esperando a que terminen, y escribe una línea JSON por resultado
+ * por semihosting:
+ *  - cambio_contexto: dos tareas de igual prioridad que se ceden la CPU con
+ *    os_Yield(); costo por cambio de contexto.
+ *  - cambio_contexto_fpu_mixto: lo mismo con una tarea que usa la FPU en cada
+ *    vuelta y otra que no; solo la primera guarda y recupera s16-s31.
+ *  - cambio_contexto_fpu: lo mismo con las dos tareas usando la FPU.
+ *  - semaforo_ping_pong: dos tareas que se pasan dos semáforos; costo de una
+ *    ida y vuelta (dos Give, dos Take y dos cambios de contexto).
+ *  - cola_throughput: productor y consumidor de datos de 4 bytes por una
+ *    cola; costo por dato.
+ *  - cola_anterior_throughput: lo mismo con la cola anterior al buffer
+ *    circular (el dato se saca del principio y se corre el resto byte a byte,
+ *    y cada Push y Pop cede la CPU), reproducida en este archivo.
+ *  - tick_isr: una tarea que lee el tiempo sin parar mide los huecos que
+ *    deja SysTick_Handler sin cambio de contexto; costo por tick.
+ *  - seleccion_mapa_N: N (4, 10 y 64) tareas de igual prioridad que se ceden
+ *    la CPU con os_Yield(); costo por cambio de contexto con la elección por
+ *    mapa de prioridades del kernel, que no debe crecer con N.
+ *  - seleccion_recorrido_N: la elección anterior (busqueda() y roundRobin()
+ *    recorriendo la lista de tareas por cada prioridad), reproducida sobre N
+ *    tareas listas más la idle; costo por elección, sin cambio de contexto.
+ * Los tiempos salen de os_getCiclos64(): en QEMU el DWT no cuenta y se usa
+ * el SysTick. Con -icount los resultados son deterministas y comparables
+ * entre versiones (tools/bench_comparar.py).
+ *
+ *===========================================================================*/
+
+/*==================[inclusions]=============================================*/
+
+#include "board.h"
+#include "semihosting.h"
+
+#include "MSE_OS_Core.h"
+#include "MSE_API.h"
+
+/*==================[Macros and definitions]=================================*/
+
+#define MILISEC				1000		// Con 1000 el systick=1ms
+
+#define N_CAMBIOS			20000		// os_Yield() de cada tarea
+#define N_PING_PONG			10000		// Idas y vueltas
+#define N_COLA				20000		// Datos por la cola
+#define N_TICKS				1000		// Ticks medidos
+#define N_CALIBRACION		1000		// Vueltas para medir el lazo sin interrupciones
+#define N_SELECCION			12800		// os_Yield() en total, divisible por cada N
+#define N_RECORRIDO			10000		// Elecciones con el recorrido anterior
+
+#define SELECCION_MAX		64			// Tareas del benchmark de selección
+
+#define STACK_BENCH			1024		// Stack de tareaBench (formatea los resultados)
+#define STACK_FPU			512			// Contexto con FPU (204 bytes) más el SVC de os_Yield()
+
+/*==================[internal data definition]===============================*/
+
+static tarea estadoTareaBench;
+static tarea estadoTareaYield1, estadoTareaYield2;
+static tarea estadoTareaFPU1, estadoTareaFPU2;
+static tarea estadoTareaPing, estadoTareaPong;
+static tarea estadoTareaProductor, estadoTareaConsumidor;
+static tarea estadoTareaProductorAnt, estadoTareaConsumidorAnt;
+static tarea estadoTareaGiro;
+static tarea estadoTareaSeleccion[SELECCION_MAX];
+
+static uint32_t stackTareaBench[STACK_BENCH/4] __attribute__((aligned(8)));
+static uint32_t stackTareaFPU1[STACK_FPU/4] __attribute__((aligned(8)));
+static uint32_t stackTareaFPU2[STACK_FPU/4] __attribute__((aligned(8)));
+
+static semaforo semInicioYield, semInicioPingPong, semInicioCola, semInicioGiro;
+static semaforo semInicioSeleccion, semInicioFPU, semInicioColaAnt;
+static semaforo semFin;						// Cuenta las tareas que terminaron
+static semaforo semPing, semPong;
+static cola colaDatos;
+
+// Cola anterior al buffer circular, para comparar
+static struct  {
+	listaEspera productores;
+	listaEspera consumidores;
+	uint8_t dato[LONG_COLA];
+	uint16_t cantElementosMax;
+	uint16_t contadorElementos;
+	uint16_t longElemento;
+} colaAnterior;
+
+static uint32_t ticksHuecos;				// Resultado de tareaGiro
+static uint64_t ciclosHuecos;
+static uint32_t yieldsSeleccion;			// os_Yield() de cada tarea de selección
+
+// Tareas de la elección anterior: solo se usan prioridad y estado
+static tarea tareasRecorrido[SELECCION_MAX+1];
+static tarea *listaRecorrido[SELECCION_MAX+1];
+static uint8_t cantRecorrido;				// Tareas de usuario, la idle va en la última
+static tarea * volatile tareaElegida;
+
+static const struct  {
+	uint8_t cantidad;
+	const char *mapa;
+	const char *recorrido;
+} selecciones[]={
+	{4, "seleccion_mapa_4", "seleccion_recorrido_4"},
+	{10, "seleccion_mapa_10", "seleccion_recorrido_10"},
+	{64, "seleccion_mapa_64", "seleccion_recorrido_64"},
+};
+
+static char linea[160];						// Línea JSON en armado
+static uint8_t largoLinea;
+
+/*==================[internal functions definition]==========================*/
+
+static void agregar(const char *texto)  {
+	while(*texto!='\0' && largoLinea<sizeof(linea)-1)
+		linea[largoLinea++]=*texto++;
+	linea[largoLinea]='\0';
+}
+
+static void agregarNumero(uint64_t valor)  {
+	char digitos[21];
+	uint8_t c=sizeof(digitos)-1;
+
+	digitos[c]='\0';
+	do  {
+		digitos[--c]=(char)('0'+valor%10);
+		valor/=10;
+	} while(valor!=0);
+	agregar(&digitos[c]);
+}
+
+static void agregarCampo(const char *nombre, uint64_t valor)  {
+	agregar(",\"");
+	agregar(nombre);
+	agregar("\":");
+	agregarNumero(valor);
+}
+
+// Escribe {"bench":nombre,"n":n,"ciclos":total,"ciclos_op":..,"ns_op":..,"op_s":..}
+static void informar(const char *nombre, uint32_t n, uint64_t ciclos)  {
+	largoLinea=0;
+	agregar("{\"bench\":\"");
+	agregar(nombre);
+	agregar("\"");
+	agregarCampo("n", n);
+	agregarCampo("ciclos", ciclos);
+	agregarCampo("ciclos_op", (n!=0) ? ciclos/n : 0);
+	agregarCampo("ns_op", (n!=0) ? os_CiclosANs(ciclos)/n : 0);
+	agregarCampo("op_s", (ciclos!=0) ? (uint64_t)n*SystemCoreClock/ciclos : 0);
+	agregar("}\n");
+	semihostingEscribir(linea);
+}
+
+// Despierta a las tareas de un benchmark y espera a que todas terminen
+static void correr(semaforo *inicio, uint8_t tareas)  {
+	for(uint8_t c=0;c<tareas;c++)
+		os_SemaforoGive(inicio);
+	for(uint8_t c=0;c<tareas;c++)
+		os_SemaforoTake(&semFin, portMax_DELAY);
+}
+
+static uint32_t cambiosContexto(tarea *task)  {
+	estadisticasTarea estadisticas;
+
+	os_getEstadisticasTarea(task, &estadisticas);
+	return estadisticas.cambiosContexto;
+}
+
+/*
+ * Push y Pop de la cola anterior al buffer circular: el dato se agrega al final y se saca del
+ * principio corriendo el resto del buffer byte a byte. Como entonces, ceden la CPU siempre y,
+ * si no pueden, bloquean la tarea y se reintentan. Se corrige el índice del Push, que entonces
+ * contaba elementos en lugar de bytes.
+ */
+static uintptr_t svcColaAnteriorPush(uintptr_t buffer, uintptr_t dato)  {
+	(void)buffer;
+	irqOff();
+	if(colaAnterior.contadorElementos<colaAnterior.cantElementosMax)  {
+		memcpy(&colaAnterior.dato[colaAnterior.contadorElementos*colaAnterior.longElemento],
+				(void*)dato, colaAnterior.longElemento);
+		colaAnterior.contadorElementos++;
+		os_EsperaDespertar(&colaAnterior.consumidores, ESPERA_OK);
+		irqOn();
+		os_Yield();
+		return pdTrue;
+	}
+
+	os_EsperaBloquear(&colaAnterior.productores, os_getTareaActual(), TICKS_ON);
+	irqOn();
+	os_Yield();
+	return pdFalse;
+}
+
+static uintptr_t svcColaAnteriorPop(uintptr_t buffer, uintptr_t dato)  {
+	(void)buffer;
+	irqOff();
+	if(colaAnterior.contadorElementos!=0)  {
+		memcpy((void*)dato, colaAnterior.dato, colaAnterior.longElemento);
+		colaAnterior.contadorElementos--;
+		for(uint16_t i=0;i<colaAnterior.contadorElementos*colaAnterior.longElemento;i++)
+			colaAnterior.dato[i]=colaAnterior.dato[i+colaAnterior.longElemento];
+		os_EsperaDespertar(&colaAnterior.productores, ESPERA_OK);
+		irqOn();
+		os_Yield();
+		return pdTrue;
+	}
+
+	os_EsperaBloquear(&colaAnterior.consumidores, os_getTareaActual(), TICKS_ON);
+	irqOn();
+	os_Yield();
+	return pdFalse;
+}
+
+/*
+ * Elección de la tarea siguiente anterior al mapa de prioridades, igual a la del kernel de
+ * entonces: por cada prioridad se cuentan las tareas READY recorriendo toda la lista, y en la
+ * primera que tiene alguna se sigue el round-robin desde la última elegida.
+ */
+static uint8_t recorridoBusqueda(uint8_t prioridadScan, estadoTarea estadoT)  {
+	uint8_t cantidad=0;
+
+	for(uint8_t id_tarea=0;id_tarea<cantRecorrido+1;id_tarea++)
+		if(listaRecorrido[id_tarea]->prioridad==prioridadScan &&
+				listaRecorrido[id_tarea]->estado==estadoT)
+			cantidad++;
+	return cantidad;
+}
+
+static uint8_t recorridoRoundRobin(prioridadTarea scanPrioridad, uint8_t id_tarea)  {
+	static prioridadTarea scanPrioridad_old=0;
+
+	if(scanPrioridad!=scanPrioridad_old || id_tarea>=cantRecorrido+1)
+		id_tarea=0;
+	while(true)  {
+		if(listaRecorrido[id_tarea]->prioridad==scanPrioridad &&
+				listaRecorrido[id_tarea]->estado==TAREA_READY)  {
+			tareaElegida=listaRecorrido[id_tarea];
+			id_tarea++;
+			break;
+		}
+		id_tarea++;
+		if(id_tarea>=cantRecorrido+1)
+			id_tarea=0;
+	}
+
+	scanPrioridad_old=scanPrioridad;
+	return id_tarea;
+}
+
+static void recorridoElegir(void)  {
+	static uint8_t id_tarea=0;
+
+	for(uint8_t scanPrioridad=0;scanPrioridad<=PRIORITY_COUNT;scanPrioridad++)
+		if(recorridoBusqueda(scanPrioridad, TAREA_READY))  {
+			id_tarea=recorridoRoundRobin((prioridadTarea)scanPrioridad, id_tarea);
+			break;
+		}
+}
+
+// Arma cantidad tareas READY de la prioridad de tareaSeleccion más la idle
+static void recorridoArmar(uint8_t cantidad)  {
+	for(uint8_t c=0;c<=cantidad;c++)  {
+		tareasRecorrido[c].prioridad=(c<cantidad) ? PRIORIDAD_2 : (prioridadTarea)PRIORITY_COUNT;
+		tareasRecorrido[c].estado=TAREA_READY;
+		listaRecorrido[c]=&tareasRecorrido[c];
+	}
+	cantRecorrido=cantidad;
+}
+
+static void tareaBench(void)  {
+	uint64_t inicio, ciclos;
+	uint32_t cambios;
+
+	largoLinea=0;
+	agregar("{\"bench\":\"info\"");
+	agregarCampo("reloj_hz", SystemCoreClock);
+	agregarCampo("tick_hz", MILISEC);
+	agregar("}\n");
+	semihostingEscribir(linea);
+
+	// Cambio de contexto: se cuentan los cambios reales de las dos tareas
+	cambios=cambiosContexto(&estadoTareaYield1)+cambiosContexto(&estadoTareaYield2);
+	inicio=os_getCiclos64();
+	correr(&semInicioYield, 2);
+	ciclos=os_getCiclos64()-inicio;
+	cambios=cambiosContexto(&estadoTareaYield1)+cambiosContexto(&estadoTareaYield2)-cambios;
+	informar("cambio_contexto", cambios, ciclos);
+
+	// Una tarea con FPU y una sin FPU de igual prioridad se alternan
+	cambios=cambiosContexto(&estadoTareaYield1)+cambiosContexto(&estadoTareaYield2)+
+			cambiosContexto(&estadoTareaFPU1)+cambiosContexto(&estadoTareaFPU2);
+	inicio=os_getCiclos64();
+	os_SemaforoGive(&semInicioYield);
+	correr(&semInicioFPU, 1);
+	os_SemaforoTake(&semFin, portMax_DELAY);
+	ciclos=os_getCiclos64()-inicio;
+	cambios=cambiosContexto(&estadoTareaYield1)+cambiosContexto(&estadoTareaYield2)+
+			cambiosContexto(&estadoTareaFPU1)+cambiosContexto(&estadoTareaFPU2)-cambios;
+	informar("cambio_contexto_fpu_mixto", cambios, ciclos);
+
+	cambios=cambiosContexto(&estadoTareaFPU1)+cambiosContexto(&estadoTareaFPU2);
+	inicio=os_getCiclos64();
+	correr(&semInicioFPU, 2);
+	ciclos=os_getCiclos64()-inicio;
+	cambios=cambiosContexto(&estadoTareaFPU1)+cambiosContexto(&estadoTareaFPU2)-cambios;
+	informar("cambio_contexto_fpu", cambios, ciclos);
+
+	inicio=os_getCiclos64();
+	correr(&semInicioPingPong, 2);
+	informar("semaforo_ping_pong", N_PING_PONG, os_getCiclos64()-inicio);
+
+	inicio=os_getCiclos64();
+	correr(&semInicioCola, 2);
+	informar("cola_throughput", N_COLA, os_getCiclos64()-inicio);
+
+	inicio=os_getCiclos64();
+	correr(&semInicioColaAnt, 2);
+	informar("cola_anterior_throughput", N_COLA, os_getCiclos64()-inicio);
+
+	correr(&semInicioGiro, 1);
+	informar("tick_isr", ticksHuecos, ciclosHuecos);
+
+	for(uint8_t s=0;s<sizeof(selecciones)/sizeof(selecciones[0]);s++)  {
+		yieldsSeleccion=N_SELECCION/selecciones[s].cantidad;
+		cambios=0;
+		for(uint8_t c=0;c<SELECCION_MAX;c++)
+			cambios-=cambiosContexto(&estadoTareaSeleccion[c]);
+		inicio=os_getCiclos64();
+		correr(&semInicioSeleccion, selecciones[s].cantidad);
+		ciclos=os_getCiclos64()-inicio;
+		for(uint8_t c=0;c<SELECCION_MAX;c++)
+			cambios+=cambiosContexto(&estadoTareaSeleccion[c]);
+		informar(selecciones[s].mapa, cambios, ciclos);
+
+		recorridoArmar(selecciones[s].cantidad);
+		inicio=os_getCiclos64();
+		for(uint32_t c=0;c<N_RECORRIDO;c++)
+			recorridoElegir();
+		informar(selecciones[s].recorrido, N_RECORRIDO, os_getCiclos64()-inicio);
+	}
+
+	semihostingEscribir("{\"bench\":\"fin\"}\n");
+	semihostingSalir(true);
+}
+
+static void tareaYield(void)  {
+	while(1)  {
+		os_SemaforoTake(&semInicioYield, portMax_DELAY);
+		for(uint32_t c=0;c<N_CAMBIOS;c++)
+			os_Yield();
+		os_SemaforoGive(&semFin);
+	}
+}
+
+// Usa la FPU en cada vuelta, por lo que siempre sale con contexto de FPU
+static void tareaYieldFPU(void)  {
+	volatile float acumulador=0.0f;
+
+	while(1)  {
+		os_SemaforoTake(&semInicioFPU, portMax_DELAY);
+		for(uint32_t c=0;c<N_CAMBIOS;c++)  {
+			acumulador=acumulador*0.5f+1.0f;
+			os_Yield();
+		}
+		os_SemaforoGive(&semFin);
+	}
+}
+
+static void tareaPing(void)  {
+	while(1)  {
+		os_SemaforoTake(&semInicioPingPong, portMax_DELAY);
+		for(uint32_t c=0;c<N_PING_PONG;c++)  {
+			os_SemaforoGive(&semPong);
+			os_SemaforoTake(&semPing, portMax_DELAY);
+		}
+		os_SemaforoGive(&semFin);
+	}
+}
+
+static void tareaPong(void)  {
+	while(1)  {
+		os_SemaforoTake(&semInicioPingPong, portMax_DELAY);
+		for(uint32_t c=0;c<N_PING_PONG;c++)  {
+			os_SemaforoTake(&semPong, portMax_DELAY);
+			os_SemaforoGive(&semPing);
+		}
+		os_SemaforoGive(&semFin);
+	}
+}
+
+static void tareaProductor(void)  {
+	while(1)  {
+		os_SemaforoTake(&semInicioCola, portMax_DELAY);
+		for(uint32_t c=0;c<N_COLA;c++)
+			os_ColaPush(&colaDatos, &c);
+		os_SemaforoGive(&semFin);
+	}
+}
+
+static void tareaConsumidor(void)  {
+	uint32_t dato;
+
+	while(1)  {
+		os_SemaforoTake(&semInicioCola, portMax_DELAY);
+		for(uint32_t c=0;c<N_COLA;c++)  {
+			os_ColaPop(&colaDatos, &dato);
+			if(dato!=c)  {
+				semihostingEscribir("{\"bench\":\"error\",\"motivo\":\"cola\"}\n");
+				semihostingSalir(false);
+			}
+		}
+		os_SemaforoGive(&semFin);
+	}
+}
+
+static void tareaSeleccion(void)  {
+	while(1)  {
+		os_SemaforoTake(&semInicioSeleccion, portMax_DELAY);
+		for(uint32_t c=0;c<yieldsSeleccion;c++)
+			os_Yield();
+		os_SemaforoGive(&semFin);
+	}
+}
+
+static void tareaProductorAnterior(void)  {
+	while(1)  {
+		os_SemaforoTake(&semInicioColaAnt, portMax_DELAY);
+		for(uint32_t c=0;c<N_COLA;c++)
+			while(os_LlamadaKernel(svcColaAnteriorPush, 0, (uintptr_t)&c)!=pdTrue);
+		os_SemaforoGive(&semFin);
+	}
+}
+
+static void tareaConsumidorAnterior(void)  {
+	uint32_t dato;
+
+	while(1)  {
+		os_SemaforoTake(&semInicioColaAnt, portMax_DELAY);
+		for(uint32_t c=0;c<N_COLA;c++)  {
+			while(os_LlamadaKernel(svcColaAnteriorPop, 0, (uintptr_t)&dato)!=pdTrue);
+			if(dato!=c)  {
+				semihostingEscribir("{\"bench\":\"error\",\"motivo\":\"cola_anterior\"}\n");
+				semihostingSalir(false);
+			}
+		}
+		os_SemaforoGive(&semFin);
+	}
+}
+
+/*
+ * Costo del tick: es la única tarea READY, por lo que SysTick_Handler no cambia de contexto.
+ * Primero se mide cuánto tarda una vuelta del lazo; una vuelta que tarda más de 4 veces eso
+ * fue interrumpida por el tick y su exceso es el costo de SysTick_Handler.
+ */
+static void tareaGiro(void)  {
+	uint64_t ultimo, ahora=0, ticksInicio;
+	uint32_t delta, umbral, vuelta;
+
+	while(1)  {
+		os_SemaforoTake(&semInicioGiro, portMax_DELAY);
+
+		// La calibración tiene el mismo cuerpo que el lazo medido
+		ultimo=os_getCiclos64();
+		for(uint32_t c=0;c<N_CALIBRACION;c++)  {
+			ahora=os_getCiclos64();
+			ticksInicio=os_getSytemTicks();
+		}
+		vuelta=(uint32_t)(ahora-ultimo)/N_CALIBRACION;
+		umbral=4*vuelta+2;
+
+		ticksHuecos=0;
+		ciclosHuecos=0;
+		ticksInicio=os_getSytemTicks();
+		ultimo=os_getCiclos64();
+		while(os_getSytemTicks()-ticksInicio < N_TICKS)  {
+			ahora=os_getCiclos64();
+			delta=(uint32_t)(ahora-ultimo);
+			if(delta>umbral)  {
+				ticksHuecos++;
+				ciclosHuecos+=delta-vuelta;
+			}
+			ultimo=ahora;
+		}
+
+		os_SemaforoGive(&semFin);
+	}
+}
+
+/*==================[external functions definition]==========================*/
+
+void errorHook(void *caller)  {
+	(void)caller;
+	largoLinea=0;
+	agregar("{\"bench\":\"error\"");
+	agregarCampo("codigo", (uint64_t)(-os_getError()));
+	agregar("}\n");
+	semihostingEscribir(linea);
+	semihostingSalir(false);
+}
+
+int main(void)  {
+	SysTick_Config(SystemCoreClock / MILISEC);		//systick=1ms
+
+	os_SemaforoInitContador(&semInicioYield, 2, 0);
+	os_SemaforoInitContador(&semInicioPingPong, 2, 0);
+	os_SemaforoInitContador(&semInicioCola, 2, 0);
+	os_SemaforoInitContador(&semInicioGiro, 1, 0);
+	os_SemaforoInitContador(&semInicioFPU, 2, 0);
+	os_SemaforoInitContador(&semInicioSeleccion, SELECCION_MAX, 0);
+	os_SemaforoInitContador(&semFin, SELECCION_MAX, 0);
+	os_SemaforoInit(&semPing);
+	os_SemaforoInit(&semPong);
+	os_ColaInit(&colaDatos, sizeof(uint32_t));
+	os_SemaforoInitContador(&semInicioColaAnt, 2, 0);
+	os_EsperaInit(&colaAnterior.productores);
+	os_EsperaInit(&colaAnterior.consumidores);
+	colaAnterior.longElemento=sizeof(uint32_t);
+	colaAnterior.cantElementosMax=LONG_COLA/sizeof(uint32_t);
+
+	os_InitTareaStack(tareaBench, &estadoTareaBench, PRIORIDAD_0, stackTareaBench,
+			sizeof(stackTareaBench));
+	os_InitTarea(tareaYield, &estadoTareaYield1, PRIORIDAD_2);
+	os_InitTarea(tareaYield, &estadoTareaYield2, PRIORIDAD_2);
+	os_InitTareaStack(tareaYieldFPU, &estadoTareaFPU1, PRIORIDAD_2, stackTareaFPU1,
+			sizeof(stackTareaFPU1));
+	os_InitTareaStack(tareaYieldFPU, &estadoTareaFPU2, PRIORIDAD_2, stackTareaFPU2,
+			sizeof(stackTareaFPU2));
+	os_setTareaFPU(&estadoTareaFPU1, true);
+	os_setTareaFPU(&estadoTareaFPU2, true);
+	os_InitTarea(tareaPing, &estadoTareaPing, PRIORIDAD_2);
+	os_InitTarea(tareaPong, &estadoTareaPong, PRIORIDAD_2);
+	os_InitTarea(tareaProductor, &estadoTareaProductor, PRIORIDAD_2);
+	os_InitTarea(tareaConsumidor, &estadoTareaConsumidor, PRIORIDAD_2);
+	os_InitTarea(tareaProductorAnterior, &estadoTareaProductorAnt, PRIORIDAD_2);
+	os_InitTarea(tareaConsumidorAnterior, &estadoTareaConsumidorAnt, PRIORIDAD_2);
+	os_InitTarea(tareaGiro, &estadoTareaGiro, PRIORIDAD_3);
+	for(uint8_t c=0;c<SELECCION_MAX;c++)
+		os_InitTarea(tareaSeleccion, &estadoTareaSeleccion[c], PRIORIDAD_2);
+
+	os_Init();
+
+	return 0;
+}
@@ -0,0 +1,36 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: semihosting.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Salida por semihosting (QEMU con -semihosting): texto a la consola del host
+ * y fin de la emulación con el resultado.
+ *
+ *===========================================================================*/
+
+#ifndef BENCH_QEMU_MPS2_SEMIHOSTING_H_
+#define BENCH_QEMU_MPS2_SEMIHOSTING_H_
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/********************************************************************************
+ * Definicion de las constantes
+ *******************************************************************************/
+#define SH_SYS_WRITE0				0x04		// Escribe un string terminado en cero
+#define SH_SYS_EXIT					0x18		// Termina la emulación
+#define SH_SALIDA_OK				0x20026		// ADP_Stopped_ApplicationExit
+#define SH_SALIDA_ERROR				0x20023		// ADP_Stopped_RunTimeErrorUnknown
+
+
+/*=============[Definición de prototipos]=======================*/
+void semihostingEscribir(const char *texto);
+void semihostingSalir(bool ok) __attribute__((noreturn));
+
+
+#endif /* BENCH_QEMU_MPS2_SEMIHOSTING_H_ */
@@ -0,0 +1,142 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: startup.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * Arranque de la mps2-an386 en QEMU: tabla de vectores, Reset_Handler (FPU,
+ * .data y .bss), handlers de fallas y semihosting.
+ * SVC_Handler y PendSV_Handler son los del kernel (PendSV_Handler.S) y
+ * SysTick_Handler el de MSE_OS_Core.c.
+ *
+ *===========================================================================*/
+
+#include "board.h"
+#include "semihosting.h"
+
+
+/*===================[Declaración de funciones locales]================================*/
+
+void Reset_Handler(void);
+static void fallaHandler(void);
+static uint32_t semihosting(uint32_t operacion, uint32_t argumento);
+
+extern int main(void);
+extern void SVC_Handler(void);
+extern void PendSV_Handler(void);
+extern void SysTick_Handler(void);
+
+
+/*==================[Definición de variables globales]=================================*/
+
+uint32_t SystemCoreClock=25000000;
+
+// Símbolos del linker script
+extern uint32_t __StackTop;
+extern uint32_t __data_load, __data_start, __data_end;
+extern uint32_t __bss_start, __bss_end;
+
+/*
+ * Tabla de vectores. PendSV_Handler recarga el MSP desde la primer entrada al lanzar la
+ * primer tarea, por eso VTOR debe apuntar a esta tabla (0x00000000 en la AN386).
+ */
+__attribute__((section(".vectores"), used))
+void (* const tablaVectores[16+32])(void) = {
+	(void (*)(void))&__StackTop,
+	Reset_Handler,
+	fallaHandler,				// NMI
+	fallaHandler,				// HardFault
+	fallaHandler,				// MemManage
+	fallaHandler,				// BusFault
+	fallaHandler,				// UsageFault
+	0, 0, 0, 0,
+	SVC_Handler,
+	fallaHandler,				// DebugMon
+	0,
+	PendSV_Handler,
+	SysTick_Handler,
+	[16 ... 16+31] = fallaHandler	// Interrupciones externas, no se usan
+};
+
+
+/*==================[Funciones de arranque]=================================*/
+
+/*************************************************************************************************
+	 *  @brief Handler del reset.
+     *
+     *  @details
+     *   Habilita la FPU (CP10 y CP11), copia .data desde la flash, borra .bss y llama a main.
+     *   Si main retorna se termina la emulación con error.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void Reset_Handler(void)  {
+	uint32_t *origen, *destino;
+
+	SCB->CPACR |= (0xFUL << 20);
+	__DSB();
+	__ISB();
+
+	for(origen=&__data_load, destino=&__data_start; destino<&__data_end; )
+		*destino++=*origen++;
+	for(destino=&__bss_start; destino<&__bss_end; )
+		*destino++=0;
+
+	main();
+	semihostingSalir(false);
+}
+
+/*************************************************************************************************
+	 *  @brief Handler de las fallas y de las interrupciones no usadas.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void fallaHandler(void)  {
+	semihostingEscribir("{\"bench\":\"falla\"}\n");
+	semihostingSalir(false);
+}
+
+/*==================[Semihosting]=================================*/
+
+/*************************************************************************************************
+	 *  @brief Escribe un texto en la consola del host.
+     *
+	 *  @param 		texto	String terminado en cero.
+	 *  @return     None.
+***************************************************************************************************/
+void semihostingEscribir(const char *texto)  {
+	semihosting(SH_SYS_WRITE0, (uint32_t)texto);
+}
+
+/*************************************************************************************************
+	 *  @brief Termina la emulación.
+     *
+     *  @details
+     *   QEMU termina con código 0 si ok es true y con 1 si no.
+     *
+	 *  @param 		ok		Resultado.
+	 *  @return     No retorna.
+***************************************************************************************************/
+void semihostingSalir(bool ok)  {
+	semihosting(SH_SYS_EXIT, ok ? SH_SALIDA_OK : SH_SALIDA_ERROR);
+	while(1)
+		__WFI();
+}
+
+/*************************************************************************************************
+	 *  @brief Llamada de semihosting (BKPT 0xAB).
+     *
+	 *  @param 		operacion	Número de operación (R0).
+	 *  @param 		argumento	Argumento (R1).
+	 *  @return     Resultado de la operación.
+***************************************************************************************************/
+static uint32_t semihosting(uint32_t operacion, uint32_t argumento)  {
+	register uint32_t r0 __asm("r0") = operacion;
+	register uint32_t r1 __asm("r1") = argumento;
+
+	__asm volatile("bkpt 0xAB" : "+r"(r0) : "r"(r1) : "memory");
+	return r0;
+}
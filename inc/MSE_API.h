@@ -22,7 +22,9 @@
 											// EL MAX TEÓRICO ES 0xFFFFFFFFFFFFFFFF
 											// se pone este valor para que no haga overflow
 
-#define LONG_COLA	64 					// Espacio de la cola en memoria
+#ifndef LONG_COLA
+#define LONG_COLA	64 					// Espacio propio de cada cola (múltiplo de 4)
+#endif
 
 /********************************************************************************
  * Definicion de la estructura para los semaforos
@@ -34,31 +36,52 @@ enum _estadoSemTake  {
 
 typedef enum _estadoSemTake statusSemTake;
 
-enum _estadoSem  {
-	LIBERADO,
-	TOMADO
+struct _semaforo {
+	listaEspera espera;			// Tareas esperando el semáforo, ordenadas por prioridad
+	uint32_t cuenta;			// Cantidad de veces que se puede tomar sin esperar
+	uint32_t cuentaMax;			// 1 para los semáforos binarios
 };
 
-typedef enum _estadoSem statusSem;
+typedef struct _semaforo semaforo;
 
-struct _semaforo {
-	tarea* tareaSemaforo;		// Tarea asociada al semáforo
-	uint64_t delaySemaforo;		// Puede ser portMax_DELAY, son cantidad de ticks
-	statusSem estadoSemaforo;
+/********************************************************************************
+ * Definicion de la estructura para los mutex
+ *******************************************************************************/
+struct _mutex {
+	listaEspera espera;			// Tareas esperando y tarea propietaria (espera.propietario)
+	uint16_t recursion;			// Cantidad de veces que lo tomó el propietario
+};
+
+typedef struct _mutex mutex;
 
+/********************************************************************************
+ * Definicion de la estructura para los grupos de eventos
+ *******************************************************************************/
+#define EVENTOS_ESPERAR_TODOS		0x01	// AND: se esperan todos los bits de la máscara
+#define EVENTOS_BORRAR_AL_SALIR		0x02	// Se borran los bits de la máscara al cumplirse
+
+struct _eventos {
+	listaEspera espera;			// Tareas esperando una combinación de bits
+	uint32_t bits;				// Eventos ocurridos
 };
 
-typedef struct _semaforo semaforo;
+typedef struct _eventos eventos;
+
 /********************************************************************************
  * Definicion de la estructura para las colas
  *******************************************************************************/
 struct _cola {
-	tarea* tareaIn;				// Puntero de la cola asociada a tareaIn
-	tarea* tareaOut;			// Puntero de la cola asociada a tareaOut
-	uint8_t dato[LONG_COLA];	// Es un array de punteros a datos
+	listaEspera productores;	// Tareas esperando lugar para ingresar un dato
+	listaEspera consumidores;	// Tareas esperando un dato
+	uint8_t *memoria;			// Buffer circular: dato u otro que da la aplicación
+	uint32_t dato[LONG_COLA/4];	// Buffer propio (os_ColaInit), alineado a palabra
+	uint16_t cabeza;			// Posición (en elementos) del próximo dato a sacar
+	uint16_t fin;				// Posición (en elementos) del próximo dato a ingresar
 	uint16_t cantElementosMax;
 	uint16_t contadorElementos;
 	uint16_t longElemento;
+	bool prestamoProductor;		// Hay un lugar prestado a un productor (os_ColaPrestar)
+	bool prestamoConsumidor;	// Hay un dato prestado a un consumidor (os_ColaRecibir)
 };
 
 typedef struct _cola cola;
@@ -67,12 +90,38 @@ typedef struct _cola cola;
 /*=============[Definición de prototipos para las Tareas]=======================*/
 
 void os_SemaforoInit(semaforo* sem); 		// Inicializa valores
+void os_SemaforoInitContador(semaforo* sem, uint32_t cuentaMax, uint32_t cuentaInicial);
 statusSemTake os_SemaforoTake(semaforo* sem,uint64_t delayTicks);
 void os_SemaforoGive(semaforo* sem);
+void os_SemaforoGiveFromISR(semaforo* sem);
+
+void os_MutexInit(mutex* mtx);							// Inicializa valores
+statusSemTake os_MutexTake(mutex* mtx,uint64_t delayTicks);
+statusSemTake os_MutexGive(mutex* mtx);
 
 void os_ColaInit(cola* buffer, uint16_t longDato); 		// Inicializa valores
+void os_ColaInitMemoria(cola* buffer, uint16_t longDato, void* memoria, uint16_t longMemoria);
 void os_ColaPush(cola* buffer,void* dato);				// Ingresa un dato
 void os_ColaPop(cola* buffer,void* dato);				// Saca un dato
+statusSemTake os_ColaPushTimeout(cola* buffer,void* dato,uint64_t delayTicks);
+statusSemTake os_ColaPopTimeout(cola* buffer,void* dato,uint64_t delayTicks);
+statusSemTake os_ColaPushFromISR(cola* buffer,void* dato);	// No espera
+statusSemTake os_ColaPopFromISR(cola* buffer,void* dato);	// No espera
+void* os_ColaPrestar(cola* buffer,uint64_t delayTicks);	// Pide un lugar para llenarlo (sin copia)
+void os_ColaConfirmar(cola* buffer);					// Ingresa el lugar prestado
+void* os_ColaRecibir(cola* buffer,uint64_t delayTicks);	// Recibe el primer dato (sin copia)
+void os_ColaDevolver(cola* buffer);						// Saca el dato recibido
+
+
+void os_EventosInit(eventos* ev);						// Grupos de eventos
+uint32_t os_EventosSet(eventos* ev, uint32_t bits);
+void os_EventosSetFromISR(eventos* ev, uint32_t bits);
+uint32_t os_EventosClear(eventos* ev, uint32_t bits);
+uint32_t os_EventosEsperar(eventos* ev, uint32_t mascara, uint8_t opciones, uint64_t delayTicks);
+
+void os_TareaNotificar(tarea* task, uint32_t bits);		// Notificaciones directas a tareas
+void os_TareaNotificarFromISR(tarea* task, uint32_t bits);
+uint32_t os_TareaNotificacionEsperar(uint64_t delayTicks);
 
 
 #endif /* MSE_API_H_ */
@@ -3,74 +3,80 @@
 #define ISO_I_2020_MSE_OS_INC_MSE_OS_CORE_H_
 
 #include <stdint.h>
-#include "board.h"
+#include "MSE_OS_Port.h"
 
 
 /************************************************************************************
  * 			Tamaño del stack predefinido para cada tarea expresado en bytes
  ***********************************************************************************/
 
-#define STACK_SIZE 256
+#ifndef STACK_SIZE
+#define STACK_SIZE 256					// Stack de las tareas creadas con os_InitTarea()
+#endif
 
-//----------------------------------------------------------------------------------
+#ifndef OS_CANT_STACKS_DEFAULT
+#define OS_CANT_STACKS_DEFAULT	MAX_TASK_COUNT	// Stacks de STACK_SIZE reservados para os_InitTarea()
+#endif
 
+#ifndef STACK_SIZE_IDLE
+#define STACK_SIZE_IDLE 192				// Stack de la idleTask
+#endif
 
+#define STACK_SIZE_MIN	OS_PORT_STACK_MIN		// Stack mínimo aceptado por os_InitTareaStack()
 
-/************************************************************************************
- * 	Posiciones dentro del stack de los registros que lo conforman
- ***********************************************************************************/
-
-#define XPSR			1
-#define PC_REG			2
-#define LR				3
-#define R12				4
-#define R3				5
-#define R2				6
-#define R1				7
-#define R0				8
-#define LR_PREV_VALUE	9
-#define R4				10
-#define R5				11
-#define R6				12
-#define R7				13
-#define R8				14
-#define R9				15
-#define R10 			16
-#define R11 			17
+#define STACK_PATRON	0xA5A5A5A5		// Relleno del stack para medir su uso máximo
+#define STACK_CANARIO	0xDEADBEEF		// Palabras de guarda en el fondo del stack
+#define STACK_GUARDAS	2				// Cantidad de palabras de guarda
 
 //----------------------------------------------------------------------------------
 
 
-/************************************************************************************
- * 			Valores necesarios para registros del stack frame inicial
- ***********************************************************************************/
-
-#define INIT_XPSR 	1 << 24				//xPSR.T = 1
-#define EXEC_RETURN	0xFFFFFFF9			//retornar a modo thread con MSP, FPU no utilizada
-
-//----------------------------------------------------------------------------------
-
 
 /************************************************************************************
  * 						Definiciones constantes del Sistema Operativo
  ***********************************************************************************/
-#define STACK_FRAME_SIZE			8	//
-#define FULL_STACKING_SIZE 			17	//16 core registers + valor previo de LR
-
-
+#ifndef MAX_TASK_COUNT
 #define MAX_TASK_COUNT				10	// Cantidad máxima de tareas para este OS
-										// internamente se le suma una tarea más
+#endif									// internamente se le suma una tarea más
 										// la idleTask
 
 #define MAX_PRIORITY				0	// Máxima prioridad que puede tener una tarea
 #define MIN_PRIORITY				3	// Mínima prioridad que puede tener una tarea
-#define PRIORITY_COUNT		(MIN_PRIORITY-MAX_PRIORITY)+1	//cantidad de prioridades asignables
+#define PRIORITY_COUNT		((MIN_PRIORITY-MAX_PRIORITY)+1)	//cantidad de prioridades asignables
 
 #define TICKS_ON					0xFFFFFFFF	// Valor máximo de ticks de bloqueo
 #define TICKS_OFF					0x00	    // Valor mínimo de ticks de bloqueo
+
+#ifndef OS_TICKLESS_IDLE
+#define OS_TICKLESS_IDLE			1			// 1: la idleTask detiene el SysTick mientras todas
+#endif											// las tareas están bloqueadas
+#define OS_TICKLESS_MIN_TICKS		2			// Mínimo de ticks libres para dormir sin tick
+
+#ifndef OS_CHEQUEO_FPU
+#define OS_CHEQUEO_FPU				0			// 1: error si una tarea no habilitada usa la FPU
+#endif
+
+#ifndef OS_CHEQUEO_STACK
+#define OS_CHEQUEO_STACK			0			// 1: se verifican las guardas del stack en cada
+#endif											// cambio de contexto
+
+#ifndef OS_CARGA_VENTANA_TICKS
+#define OS_CARGA_VENTANA_TICKS		1000		// Ticks en los que se promedia la carga de CPU
+#endif
+
 /*==================[Definición codigos de error y warning de OS]=================================*/
 #define ERR_OS_CANT_TAREAS		-1
 #define ERR_DELAY_FROM_ISR		-2
+#define ERR_OS_SVC_IRQ_OFF		-3		// Llamada al kernel desde una tarea con irqOff()
+#define ERR_OS_FPU_NO_HABILITADA	-4
+#define ERR_OS_STACK			-5
+#define ERR_OS_STACK_DESBORDE	-6
+#define ERR_OS_COLA_MEMORIA		-7		// os_ColaInitMemoria() sin lugar para un elemento
+#define ERR_OS_STREAM_CAPACIDAD	-8
+
+/*==================[Resultado de una espera en una listaEspera]=================================*/
+#define ESPERA_TIMEOUT			0		// Venció el timeout (mismo valor que pdFalse)
+#define ESPERA_OK				1		// La despertó otra tarea o una ISR (mismo valor que pdTrue)
 
 
 /*==================[Definición de datos externa]================================================*/
@@ -109,18 +115,63 @@ typedef enum _prioridad prioridadTarea;
  * Definición de la estructura de cada tarea
  *******************************************************************************/
 struct _tarea  {
-	uint32_t stack[STACK_SIZE/4];	// Longitud del Stack
-	uint32_t stack_pointer;			// Puntero al Stack
+	uint32_t *stack;				// Comienzo (dirección más baja) del stack de la tarea
+	uint32_t stack_size;			// Longitud del Stack en bytes
+	uintptr_t stack_pointer;		// Puntero al Stack (contexto guardado por el port)
 	void *entry_point;				// Puntero al inicio de la tarea
 	uint8_t id;						// Número que identifica la tarea
 	estadoTarea estado;             // Estado de la tarea
 	prioridadTarea prioridad;		// Prioridad de la tarea 0(mayor prioridad) al 3
 	uint32_t ticks_bloqueada;		// cantidad de ticks que la tarea debe
-									// permanecer bloqueada
+									// permanecer bloqueada. Estando en la lista de
+									// retardos es la diferencia con la tarea anterior
+	struct _tarea *anteriorReady;	// Tarea anterior en la lista READY de su prioridad
+	struct _tarea *siguienteReady;	// Tarea siguiente en la lista READY de su prioridad
+	struct _tarea *anteriorDelay;	// Tarea anterior en la lista de retardos
+	struct _tarea *siguienteDelay;	// Tarea siguiente en la lista de retardos
+	uint32_t vencimientoUs;			// Vencimiento en us de tareaDelayUs() (MSE_OS_TimerUs)
+	struct _tarea *siguienteUs;		// Tarea siguiente en la lista de retardos en us
+	bool fpuHabilitada;				// La tarea declaró que usa la FPU (os_setTareaFPU)
+	bool contextoFPU;				// El último contexto guardado incluye la FPU
+	uint32_t cambiosFPU;			// Cantidad de veces que se guardó con contexto de FPU
+	struct _listaEspera *esperando;	// Lista de espera en la que está bloqueada (o NULL)
+	struct _tarea *siguienteEspera;	// Tarea siguiente en esa lista de espera
+	uint32_t resultadoEspera;		// ESPERA_OK o ESPERA_TIMEOUT
+	void *datoEspera;				// Dato que entrega quien despierta a la tarea
+	uint32_t notificacion;			// Bits de notificación pendientes (os_TareaNotificar)
+	bool esperaNotificacion;		// Está bloqueada en os_TareaNotificacionEsperar()
+	uint8_t prioridadBase;			// Prioridad asignada, sin herencia de los mutex
+	uint8_t mutexTomados;			// Cantidad de mutex que tiene tomados
+	uint64_t ciclosEjecucion;		// Ciclos de CPU usados, sin contar las interrupciones
+	uint32_t cambiosContexto;		// Veces que entró a ejecutarse
+	uint32_t expropiaciones;		// Veces que salió de ejecución sin bloquearse
 };
 
 typedef struct _tarea tarea;
 
+/********************************************************************************
+ * Estadísticas de uso de CPU de una tarea (os_getEstadisticasTarea)
+ *******************************************************************************/
+struct _estadisticasTarea  {
+	uint64_t ciclos;				// Ciclos de CPU usados, incluido el tramo en curso
+	uint32_t cambiosContexto;
+	uint32_t expropiaciones;
+};
+
+typedef struct _estadisticasTarea estadisticasTarea;
+
+/********************************************************************************
+ * Lista de tareas bloqueadas esperando un objeto del OS (mutex, semáforo, etc.)
+ * Está ordenada por prioridad, y FIFO entre tareas de igual prioridad.
+ *******************************************************************************/
+struct _listaEspera  {
+	tarea *primera;					// Tarea de mayor prioridad que espera
+	tarea *propietario;				// Tarea que hereda la prioridad de las que esperan
+									// (solo en los mutex, NULL en el resto)
+};
+
+typedef struct _listaEspera listaEspera;
+
 /********************************************************************************
  * Definición de los estados posibles del OS
  *******************************************************************************/
@@ -144,20 +195,34 @@ struct _osControl  {
 	uint8_t cantidad_Tareas;					//cantidad de tareas definidas por el usuario
 	estadoOS estado_sistema;					//Informacion sobre el estado del OS
 	bool cambioContextoNecesario;
+	bool schedulingPendiente;					//una ISR pidió un scheduling mientras se hacía otro
 	tarea *tarea_actual;						//definicion de puntero para tarea actual
 	tarea *tarea_siguiente;						//definicion de puntero para tarea siguiente
 	uint8_t prioridadMin_Tarea;					//Prioridad mínima de las tarea definida por el usuario
 	uint8_t prioridadMax_Tarea;					//Prioridad mínima de las tarea definida por el usuario
 
+	uint32_t mapaReady;							//bit (31-prioridad) en 1 si hay tareas READY en esa prioridad
+	tarea *primeraReady[PRIORITY_COUNT+1];		//cabeza de la lista FIFO READY de cada prioridad + idleTask
+	tarea *ultimaReady[PRIORITY_COUNT+1];		//cola de la lista FIFO READY de cada prioridad + idleTask
+	tarea *primeraDelay;						//lista de tareas bloqueadas con timeout, ordenada por
+												//vencimiento y con los ticks relativos (delta)
+
 	bool banderaISR;						   //esta bandera se utiliza para la atencion a interrupciones
 };
 
 typedef struct _osControl osControl;
 
 
+/********************************************************************************
+ * Función del kernel que se ejecuta a través de os_LlamadaKernel() (SVC)
+ *******************************************************************************/
+typedef uintptr_t (*servicioKernel)(uintptr_t arg0, uintptr_t arg1);
+
+
 /*==================[definición de prototipos]=================================*/
 void os_Init(void);				// Inicia el Sistema Operativo
-void os_InitTarea(void *entryPoint, tarea *task, uint8_t prioridad);
+void os_InitTarea(void *entryPoint, tarea *task, prioridadTarea prioridad);
+void os_InitTareaStack(void *entryPoint, tarea *task, prioridadTarea prioridad, uint32_t *stack, uint32_t tamanio);
 void tareaDelay(uint32_t );
 
 // Recupera el valor de reloj del sistema
@@ -166,8 +231,14 @@ uint64_t os_getSytemTicks(void);
 void os_setError(int32_t err, void* caller);
 // Setear una prioridad de una tarea ya creada
 void os_setTareaPrioridad(tarea *task, uint8_t prioridad);
+// Cambia la prioridad efectiva de una tarea en cualquier estado (herencia de prioridad)
+void os_setTareaPrioridadEfectiva(tarea *task, uint8_t prioridad);
 // Setear los ticks de bloqueo de una tarea
 void os_setTicksTarea (tarea *task, uint32_t ticks_de_bloqueo);
+// Declara si una tarea usa la FPU (solo informativo salvo con OS_CHEQUEO_FPU)
+void os_setTareaFPU(tarea *task, bool habilitada);
+// Descarta el contexto de FPU de la tarea actual
+void os_TareaLiberarFPU(void);
 // Setear los ticks de bloqueo de una tarea
 void os_setTareaEstado(tarea *task, estadoTarea estado);
 // Configuro  el estado del sistema.
@@ -181,6 +252,27 @@ int32_t os_getError(void);
 int8_t os_getTareas(void);
 // Recupera la tarea Actual
 tarea* os_getTareaActual(void);
+// Recupera si la tarea tenía contexto de FPU la última vez que se la sacó de ejecución
+bool os_getTareaContextoFPU(tarea *task);
+// Recupera la máxima cantidad de bytes de stack que usó una tarea hasta el momento
+uint32_t os_getTareaStackMaximo(tarea *task);
+// Uso de CPU: ciclos, cambios de contexto y expropiaciones de una tarea
+void os_getEstadisticasTarea(tarea *task, estadisticasTarea *estadisticas);
+// Recupera la tarea idle, para consultar sus estadísticas
+tarea* os_getTareaIdle(void);
+// Carga de CPU en % de la última ventana de OS_CARGA_VENTANA_TICKS
+uint8_t os_getCargaCPU(void);
+// Ciclos de CPU usados por las interrupciones instaladas con os_InstalarIRQ()
+uint64_t os_getCiclosIRQ(void);
+// Contador de ciclos de CPU (DWT, o SysTick si el DWT no cuenta)
+uint32_t os_getCiclos(void);
+// Tiempo desde el arranque con resolución de un ciclo, sin deshabilitar interrupciones
+uint64_t os_getCiclos64(void);
+uint64_t os_getTiempoNs(void);
+// Conversiones a partir de SystemCoreClock
+uint64_t os_CiclosANs(uint64_t ciclos);
+uint64_t os_CiclosAUs(uint64_t ciclos);
+uint64_t os_NsACiclos(uint64_t ns);
 // Recupera la cantidad de tareas que se encuentran en un ESTADO con una
 // PRIORIDAD determinada.
 int8_t os_getTareasPrioridadEstado(uint8_t prioridadScan, estadoTarea estadoT);
@@ -193,13 +285,35 @@ int8_t os_getPrioridadMin(void);
 
 
 bool os_getFlagISR(void);
+// Desde una ISR: pide un scheduling al salir si la tarea despertada es más prioritaria
+void os_SolicitarCambioISR(tarea *task);
+// Después de despertar una tarea: cede la CPU solo si la despertada es más prioritaria
+void os_SolicitarCambio(tarea *task);
 
 // Fuerza un schedulering
 void os_Yield(void);
+// Ejecuta una función del kernel en modo handler (SVC), la implementa el port
+uintptr_t os_LlamadaKernel(servicioKernel servicio, uintptr_t arg0, uintptr_t arg1);
+// Duerme hasta el próximo vencimiento sin interrupciones de SysTick (desde idleTask)
+void os_IdleSinTick(void);
+
+// Listas de espera de los objetos del OS. Se llaman dentro del kernel con irqOff()
+void os_EsperaInit(listaEspera *lista);
+void os_EsperaBloquear(listaEspera *lista, tarea *task, uint32_t ticks);
+tarea* os_EsperaDespertar(listaEspera *lista, uint32_t resultado);
 
-// Para trabajar secciones críticas del código
+// Para trabajar secciones críticas del código (anidables, enmascaran hasta OS_BASEPRI_KERNEL)
 void irqOn(void);
 void irqOff(void);
+// Secciones críticas con el estado explícito, para usar desde una ISR (las implementa el port)
+uint32_t irqOffGuardar(void);
+void irqRestaurar(uint32_t estado);
+// Suma el tiempo de una interrupción (desde os_IRQHandler)
+void os_SumarCiclosIRQ(uint32_t ciclos);
+
+// Entradas al kernel desde el port: cambio de contexto y tick del sistema
+uintptr_t getContextoSiguiente(uintptr_t sp_actual);
+void SysTick_Handler(void);
 
 
 
@@ -0,0 +1,57 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_Pool.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Este módulo declara los pools de bloques de memoria de tamaño fijo del S.O.
+ *
+ *===========================================================================*/
+
+#ifndef MSE_OS_INC_MSE_OS_POOL_H_
+#define MSE_OS_INC_MSE_OS_POOL_H_
+
+
+#include "MSE_OS_Core.h"
+#include "MSE_API.h"
+
+
+/********************************************************************************
+ * Definicion de las constantes
+ *******************************************************************************/
+
+// Tamaño real de un bloque: múltiplo del tamaño de un puntero y con lugar para el enlace
+// de la lista libre (4 bytes en el Cortex, 8 en una PC de 64 bits)
+#define OS_POOL_BLOQUE(tam)		((((tam)<sizeof(void*) ? sizeof(void*) : (tam))+sizeof(void*)-1) \
+								 & ~(sizeof(void*)-1))
+
+// Declara la memoria de un pool de cant bloques de tam bytes, alineada a puntero
+#define OS_POOL_MEMORIA(nombre,tam,cant)	uintptr_t nombre[OS_POOL_BLOQUE(tam)/sizeof(uintptr_t)*(cant)]
+
+
+/********************************************************************************
+ * Definicion de la estructura para los pools
+ *******************************************************************************/
+struct _pool {
+	void *libre;				// Primer bloque libre, cada bloque libre guarda en
+								// su primer puntero la dirección del siguiente
+	listaEspera espera;			// Tareas esperando un bloque
+	uint16_t tamBloque;			// Tamaño de cada bloque en bytes
+	uint16_t cantBloques;		// Cantidad total de bloques
+	uint16_t cantLibres;		// Cantidad de bloques libres
+};
+
+typedef struct _pool pool;
+
+
+/*=============[Definición de prototipos para las Tareas]=======================*/
+void os_PoolInit(pool* p, void* memoria, uint16_t tamBloque, uint16_t cantBloques);
+void* os_PoolAlloc(pool* p);								// No espera, se puede usar en ISR
+void* os_PoolAllocTimeout(pool* p, uint64_t delayTicks);	// Solo desde tareas
+void os_PoolFree(pool* p, void* bloque);					// Se puede usar en ISR
+uint16_t os_PoolLibres(pool* p);
+
+
+#endif /* MSE_OS_INC_MSE_OS_POOL_H_ */
@@ -0,0 +1,72 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_Port.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Este módulo declara la capa de port del S.O.: lo que depende del procesador
+ * (cambio de contexto, secciones críticas, fuente del tick, contador de
+ * ciclos y despacho de interrupciones). El resto del kernel (scheduler,
+ * semáforos, colas, etc.) solo usa estas funciones y compila igual en la
+ * EDU-CIAA (Cortex-M4), en una PC con Linux (OS_PORT_POSIX) y con tiempo
+ * virtual para las pruebas del scheduler (OS_PORT_VIRTUAL).
+ *
+ *===========================================================================*/
+
+#ifndef MSE_OS_INC_MSE_OS_PORT_H_
+#define MSE_OS_INC_MSE_OS_PORT_H_
+
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Cada port define las constantes propias del procesador:
+ *   OS_PORT_STACK_MIN		Stack mínimo en bytes para el contexto inicial de una tarea.
+ *   OS_TICKLESS_IDLE		Si soporta dormir sin tick (solo si no lo definió la aplicación).
+ *   __CLZ, __RBIT, __DMB	Intrínsecos que usa el kernel.
+ */
+#if defined(OS_PORT_POSIX)
+#include "MSE_OS_PortPosix.h"
+#elif defined(OS_PORT_VIRTUAL)
+#include "MSE_OS_PortVirtual.h"
+#else
+#include "MSE_OS_PortCM4.h"
+#endif
+
+
+/*==================[definición de prototipos]=================================*/
+
+// Prioridades de las excepciones del kernel, contador de ciclos y FPU (desde os_Init)
+void os_PortInit(uint32_t cicloInicial);
+// Arma el contexto inicial de una tarea en su stack y devuelve su stack_pointer
+uintptr_t os_PortInitContexto(uint32_t *stack, uint32_t *tope, void *entryPoint, void *retorno);
+// Prepara el primer cambio de contexto (no hay contexto saliente que guardar)
+void os_PortArranque(void);
+// Pide el cambio a control_OS.tarea_siguiente (PendSV en el Cortex)
+void os_PortCambioContexto(void);
+// true si el contexto guardado en sp incluye registros de la FPU
+bool os_PortContextoFPU(uintptr_t sp);
+// La tarea actual deja de tener contexto de FPU
+void os_PortLiberarFPU(void);
+
+// Deshabilita / habilita todas las interrupciones, incluso las que despiertan al procesador
+void os_PortIrqDeshabilitar(void);
+void os_PortIrqHabilitar(void);
+// Duerme hasta la próxima interrupción
+void os_PortEsperarIrq(void);
+// Duerme sin tick hasta ticks ticks; devuelve los ticks completos que no contó SysTick_Handler
+uint32_t os_PortDormirTicks(uint32_t ticks);
+
+// Ciclos de la fuente del tick en un tick
+uint32_t os_PortCiclosPorTick(void);
+// Lee el contador de ciclos libre de 32 bits; false si el port no tiene
+bool os_PortCiclos(uint32_t *ciclos);
+// Ciclos transcurridos del tick en curso; pendiente=1 si el tick ya venció sin ser atendido
+uint32_t os_PortCiclosEnTick(uint32_t *pendiente);
+
+
+#endif /* MSE_OS_INC_MSE_OS_PORT_H_ */
@@ -0,0 +1,93 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_PortCM4.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Este módulo declara las constantes del port del S.O. para el Cortex-M4 de
+ * la EDU-CIAA-NXP: el stack frame de las tareas y el umbral de BASEPRI de las
+ * secciones críticas del kernel.
+ *
+ *===========================================================================*/
+
+#ifndef MSE_OS_INC_MSE_OS_PORTCM4_H_
+#define MSE_OS_INC_MSE_OS_PORTCM4_H_
+
+
+// Las constantes también las usa PendSV_Handler.S, que no puede incluir los headers de C
+#ifndef __ASSEMBLER__
+#include "board.h"
+#endif
+
+
+/************************************************************************************
+ * 	Posiciones dentro del stack de los registros que lo conforman
+ ***********************************************************************************/
+
+#define XPSR			1
+#define PC_REG			2
+#define LR				3
+#define R12				4
+#define R3				5
+#define R2				6
+#define R1				7
+#define R0				8
+#define LR_PREV_VALUE	9
+#define R4				10
+#define R5				11
+#define R6				12
+#define R7				13
+#define R8				14
+#define R9				15
+#define R10 			16
+#define R11 			17
+
+//----------------------------------------------------------------------------------
+
+
+/************************************************************************************
+ * 			Valores necesarios para registros del stack frame inicial
+ ***********************************************************************************/
+
+#define INIT_XPSR 	1 << 24				//xPSR.T = 1
+#define EXEC_RETURN	0xFFFFFFFD			//retornar a modo thread con PSP, FPU no utilizada
+#define EXEC_RETURN_FPU_Msk	0x10		//EXEC_RETURN[4]=0 si el stack frame incluye la FPU
+
+//----------------------------------------------------------------------------------
+
+
+/************************************************************************************
+ * 						Definiciones constantes del port
+ ***********************************************************************************/
+#define STACK_FRAME_SIZE			8	//
+#define FULL_STACKING_SIZE 			17	//16 core registers + valor previo de LR
+
+#define FPU_STACKING_SIZE			34	//S0-S15, FPSCR y reservado (hardware) + S16-S31 (PendSV)
+										//que agrega el contexto de una tarea que usa la FPU
+
+#define SVC_FRAME_R0				0	// Posiciones en el stack frame que apila el SVC
+#define SVC_FRAME_R1				1
+#define SVC_FRAME_R12				4
+
+#define OS_PORT_STACK_MIN	((FULL_STACKING_SIZE+8)*4)	// Stack mínimo aceptado por os_InitTareaStack()
+
+/*
+ * Umbral de las secciones críticas del kernel (prioridad del NVIC, 0 es la más alta). irqOff()
+ * enmascara con BASEPRI solo las interrupciones de prioridad numérica mayor o igual a este
+ * valor; las de prioridad más alta no se demoran nunca pero no pueden usar la API del OS.
+ * PendSV_Handler.S toma OS_BASEPRI_KERNEL de este mismo header. Como el assembler no ve
+ * __NVIC_PRIO_BITS del CMSIS, los bits de prioridad se repiten en OS_PORT_PRIO_BITS y
+ * MSE_OS_PortCM4.c verifica que coincidan.
+ */
+#ifndef OS_IRQ_PRIORIDAD_KERNEL
+#define OS_IRQ_PRIORIDAD_KERNEL		2
+#endif
+#ifndef OS_PORT_PRIO_BITS
+#define OS_PORT_PRIO_BITS			3	// Bits de prioridad del NVIC (LPC4337 y mps2-an386)
+#endif
+#define OS_BASEPRI_KERNEL			(OS_IRQ_PRIORIDAD_KERNEL << (8-OS_PORT_PRIO_BITS))
+
+
+#endif /* MSE_OS_INC_MSE_OS_PORTCM4_H_ */
@@ -0,0 +1,46 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_Stream.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Este módulo declara los stream buffers del S.O.: buffers de bytes con un
+ * único productor (típicamente una ISR) y un único consumidor (una tarea).
+ *
+ *===========================================================================*/
+
+#ifndef MSE_OS_INC_MSE_OS_STREAM_H_
+#define MSE_OS_INC_MSE_OS_STREAM_H_
+
+
+#include "MSE_OS_Core.h"
+#include "MSE_API.h"
+
+
+/********************************************************************************
+ * Definicion de la estructura para los stream buffers
+ *******************************************************************************/
+struct _stream {
+	uint8_t *memoria;				// Buffer circular de capacidad potencia de 2
+	uint32_t mascara;				// capacidad-1
+	volatile uint32_t escritura;	// Índice libre, solo lo modifica el productor
+	volatile uint32_t lectura;		// Índice del próximo byte, solo lo modifica el consumidor
+	uint32_t nivelDisparo;			// Bytes con los que se despierta al consumidor
+	volatile uint32_t esperados;	// Bytes que espera el consumidor bloqueado
+	tarea * volatile consumidor;	// Tarea bloqueada esperando datos, o NULL
+};
+
+typedef struct _stream stream;
+
+
+/*=============[Definición de prototipos para las Tareas]=======================*/
+void os_StreamInit(stream* s, uint8_t* memoria, uint32_t capacidad, uint32_t nivelDisparo);
+void os_StreamSetDisparo(stream* s, uint32_t nivelDisparo);
+uint32_t os_StreamEscribir(stream* s, const void* datos, uint32_t cantidad);	// Productor (ISR)
+uint32_t os_StreamLeer(stream* s, void* datos, uint32_t cantidad, uint64_t delayTicks);
+uint32_t os_StreamDisponibles(stream* s);
+
+
+#endif /* MSE_OS_INC_MSE_OS_STREAM_H_ */
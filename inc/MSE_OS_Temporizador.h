@@ -0,0 +1,67 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_Temporizador.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Este módulo declara los temporizadores por software del S.O. (one-shot y
+ * periódicos), atendidos por una tarea del S.O.
+ *
+ *===========================================================================*/
+
+#ifndef MSE_OS_INC_MSE_OS_TEMPORIZADOR_H_
+#define MSE_OS_INC_MSE_OS_TEMPORIZADOR_H_
+
+
+#include "MSE_OS_Core.h"
+#include "MSE_API.h"
+
+
+/********************************************************************************
+ * Definicion de las constantes
+ *******************************************************************************/
+#define TEMP_BITS_RANURA		5							// 32 ranuras por nivel
+#define TEMP_RANURAS			(1 << TEMP_BITS_RANURA)
+#define TEMP_NIVELES			4							// Alcance 2^20 ticks (~17 min)
+
+// Stack de la tarea en bytes, nunca menor al mínimo del port (los ports de PC piden más)
+#ifndef OS_TEMPORIZADOR_STACK
+#define OS_TEMPORIZADOR_STACK	((OS_PORT_STACK_MIN > 512) ? OS_PORT_STACK_MIN : 512)
+#endif
+
+
+/********************************************************************************
+ * Definicion de la estructura para los temporizadores
+ *******************************************************************************/
+typedef void (*funcionTemporizador)(void *argumento);
+
+struct _temporizador {
+	funcionTemporizador funcion;			// Se ejecuta en la tarea de temporizadores
+	void *argumento;
+	uint32_t periodo;						// En ticks
+	uint32_t vencimiento;					// Tick absoluto del próximo vencimiento
+	bool periodico;
+	bool activo;
+	uint8_t nivel;							// Posición en la rueda
+	uint8_t ranura;
+	struct _temporizador *anterior;			// Lista doble de la ranura
+	struct _temporizador *siguiente;
+};
+
+typedef struct _temporizador temporizador;
+
+
+/*=============[Definición de prototipos para las Tareas]=======================*/
+void os_TemporizadorInit(prioridadTarea prioridad);		// Crea la tarea, antes de os_Init()
+void os_TemporizadorCrear(temporizador* t, funcionTemporizador funcion, void* argumento,
+						  uint32_t periodo, bool periodico);
+void os_TemporizadorIniciar(temporizador* t);			// Desde tarea o ISR
+void os_TemporizadorDetener(temporizador* t);
+void os_TemporizadorReiniciar(temporizador* t);
+void os_TemporizadorCambiarPeriodo(temporizador* t, uint32_t periodo);
+bool os_TemporizadorActivo(temporizador* t);
+
+
+#endif /* MSE_OS_INC_MSE_OS_TEMPORIZADOR_H_ */
@@ -0,0 +1,42 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_TimerUs.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Este módulo declara la base de tiempo de alta resolución del S.O., que usa
+ * uno de los TIMER de la EDU-CIAA-NXP para retardos en microsegundos.
+ *
+ *===========================================================================*/
+
+#ifndef MSE_OS_INC_MSE_OS_TIMERUS_H_
+#define MSE_OS_INC_MSE_OS_TIMERUS_H_
+
+
+#include "MSE_OS_Core.h"
+#ifndef OS_PORT_VIRTUAL
+#include "MSE_OS_IRQ.h"				// En el port virtual las interrupciones las declara el port
+#endif
+#include "board.h"					// En el port virtual, un TIMER0 sobre el tiempo virtual
+
+
+/********************************************************************************
+ * Definicion de las constantes
+ *******************************************************************************/
+#define OS_TIMER_US				LPC_TIMER0		// Timer libre de 32 bits usado como base
+#define OS_TIMER_US_IRQ			TIMER0_IRQn		// Su interrupción (pasa por os_IRQHandler)
+#define OS_TIMER_US_CLK			CLK_MX_TIMER0	// Su reloj
+#define OS_TIMER_US_MATCH		0				// Registro de match usado como one-shot
+
+#define OS_US_POR_SEGUNDO		1000000
+
+
+/*=============[Definición de prototipos para las Tareas]=======================*/
+void os_TimerUsInit(void);				// Configura el timer, antes de os_Init()
+uint32_t os_getTiempoUs(void);			// Tiempo libre en us (da la vuelta cada ~71 min)
+void tareaDelayUs(uint32_t us);			// Bloquea la tarea actual us microsegundos
+
+
+#endif /* MSE_OS_INC_MSE_OS_TIMERUS_H_ */
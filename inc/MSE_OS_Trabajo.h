@@ -0,0 +1,58 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_Trabajo.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Este módulo declara la cola de trabajos diferidos del S.O.: las ISR encolan
+ * funciones que luego ejecutan tareas del S.O. (workers).
+ *
+ *===========================================================================*/
+
+#ifndef MSE_OS_INC_MSE_OS_TRABAJO_H_
+#define MSE_OS_INC_MSE_OS_TRABAJO_H_
+
+
+#include "MSE_OS_Core.h"
+#include "MSE_API.h"
+
+
+/********************************************************************************
+ * Definicion de las constantes
+ *******************************************************************************/
+#ifndef OS_TRABAJO_CANT
+#define OS_TRABAJO_CANT			16		// Trabajos pendientes como máximo (potencia de 2)
+#endif
+
+#ifndef OS_TRABAJO_WORKERS
+#define OS_TRABAJO_WORKERS		1		// Cantidad de tareas que ejecutan los trabajos
+#endif
+
+// Stack de cada worker en bytes, nunca menor al mínimo del port (los ports de PC piden más)
+#ifndef OS_TRABAJO_STACK
+#define OS_TRABAJO_STACK		((OS_PORT_STACK_MIN > 512) ? OS_PORT_STACK_MIN : 512)
+#endif
+
+
+/********************************************************************************
+ * Definicion de los tipos para los trabajos
+ *******************************************************************************/
+typedef void (*funcionTrabajo)(void *argumento);
+
+struct _itemTrabajo {
+	funcionTrabajo funcion;		// Función a ejecutar en el worker
+	void *argumento;			// Argumento que recibe
+};
+
+typedef struct _itemTrabajo itemTrabajo;
+
+
+/*=============[Definición de prototipos para las Tareas]=======================*/
+void os_TrabajoInit(prioridadTarea prioridad);				// Crea los workers, antes de os_Init()
+bool os_TrabajoEncolar(funcionTrabajo funcion, void *argumento);	// Desde ISR o tarea
+uint32_t os_TrabajoPerdidos(void);							// Trabajos descartados por cola llena
+
+
+#endif /* MSE_OS_INC_MSE_OS_TRABAJO_H_ */
@@ -0,0 +1,89 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_Traza.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Este módulo declara la traza binaria del kernel: registros de 8 bytes con
+ * marca de tiempo en un buffer circular en RAM. Con OS_TRAZA en 0 los puntos
+ * de traza no generan código.
+ *
+ *===========================================================================*/
+
+#ifndef MSE_OS_INC_MSE_OS_TRAZA_H_
+#define MSE_OS_INC_MSE_OS_TRAZA_H_
+
+
+#include "MSE_OS_Core.h"
+
+
+/********************************************************************************
+ * Definicion de las constantes
+ *******************************************************************************/
+#ifndef OS_TRAZA
+#define OS_TRAZA					0			// 1: se registran los eventos del kernel
+#endif
+
+#ifndef OS_TRAZA_CANT_REGISTROS
+#define OS_TRAZA_CANT_REGISTROS		512			// Debe ser potencia de 2
+#endif
+
+#define OS_TRAZA_MAGICO				0x415A5254	// "TRZA", lo busca tools/traza_a_json.py
+#define OS_TRAZA_SIN_TAREA			0xFF
+
+/********************************************************************************
+ * Eventos de la traza. Los valores los usa el decodificador, no cambiarlos.
+ *******************************************************************************/
+enum _eventoTraza  {
+	TRAZA_CAMBIO_CONTEXTO=1,		// tarea: entrante, dato: saliente
+	TRAZA_TICK,						// tarea: actual, dato: systemTicks (16 bits bajos)
+	TRAZA_IRQ_ENTRA,				// tarea: interrumpida, dato: número de IRQ
+	TRAZA_IRQ_SALE,
+	TRAZA_SEMAFORO_BLOQUEA,			// tarea: la que se bloquea o despierta, dato: objeto
+	TRAZA_SEMAFORO_DESBLOQUEA,
+	TRAZA_COLA_BLOQUEA,
+	TRAZA_COLA_DESBLOQUEA
+};
+
+typedef enum _eventoTraza eventoTraza;
+
+/********************************************************************************
+ * Definicion de la estructura de la traza. Se vuelca entera desde el debugger:
+ *   (gdb) dump binary value traza.bin os_traza
+ *******************************************************************************/
+struct _registroTraza  {
+	uint32_t tiempo;				// os_getCiclos()
+	uint8_t evento;
+	uint8_t tarea;					// id de la tarea u OS_TRAZA_SIN_TAREA
+	uint16_t dato;
+};
+
+typedef struct _registroTraza registroTraza;
+
+struct _traza  {
+	uint32_t magico;
+	uint32_t cantRegistros;
+	uint32_t frecuencia;			// Hz del contador de tiempo
+	volatile uint32_t indice;		// Registros escritos desde el inicio (no se enmascara)
+	registroTraza registro[OS_TRAZA_CANT_REGISTROS];
+};
+
+typedef struct _traza traza;
+
+
+/*=============[Definición de prototipos]=======================================*/
+#if OS_TRAZA
+extern traza os_traza;
+
+void os_TrazaInit(void);
+void os_TrazaRegistrar(eventoTraza evento, const tarea *task, uint32_t dato);
+
+#define OS_TRAZA_EVENTO(evento,task,dato)	os_TrazaRegistrar((evento),(task),(uint32_t)(uintptr_t)(dato))
+#else
+#define OS_TRAZA_EVENTO(evento,task,dato)	((void)0)
+#endif
+
+
+#endif /* MSE_OS_INC_MSE_OS_TRAZA_H_ */
@@ -0,0 +1,581 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_PortPosix.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * En este módulo se encuentra el port del S.O. para una PC con Linux.
+ *
+ * Equivalencias con el port del Cortex-M4:
+ *  - Tareas: cada una es un ucontext_t guardado en el tope de su propio stack;
+ *    stack_pointer apunta a ese ucontext_t. El cambio de contexto es un
+ *    swapcontext().
+ *  - Modo handler: los manejadores de señales y os_LlamadaKernel() (el SVC)
+ *    marcan enHandler. Un cambio de contexto pedido en modo handler se hace
+ *    recién al salir, como PendSV.
+ *  - Secciones críticas: se bloquean las señales del tick y de las
+ *    interrupciones (equivale a BASEPRI).
+ *  - SysTick: un timer POSIX que envía SIGALRM al hilo del kernel.
+ *  - Interrupciones: bits pendientes y SIGUSR1 (os_PortDispararIRQ()).
+ *  - Contador de ciclos: CLOCK_MONOTONIC en nanosegundos.
+ *
+ *===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include "MSE_OS_Core.h"
+#include "MSE_OS_Traza.h"
+
+#if defined(__SANITIZE_ADDRESS__)
+#define OS_PORT_ASAN	1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define OS_PORT_ASAN	1
+#endif
+#endif
+
+#ifdef OS_PORT_ASAN
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id	_sigev_un._tid		// glibc anteriores a 2.35
+#endif
+
+
+/*===================[Declaración de funciones locales]================================*/
+
+static void arranqueTarea(void);
+static void cambiarContexto(void);
+static void manejadorTick(int senial);
+static void manejadorIRQ(int senial);
+static void despacharIRQ(uint32_t irq);
+static uint64_t relojNs(void);
+
+
+/*==================[Definición de variables globales]=================================*/
+
+uint32_t SystemCoreClock=1000000000;
+
+static sigset_t senialesKernel;				// SIGALRM (tick) y SIGUSR1 (interrupciones)
+static pthread_t hiloKernel;				// Hilo donde corren las tareas
+static timer_t timerTick;
+static volatile sig_atomic_t enHandler;		// Modo handler: señal o llamada al kernel
+static volatile sig_atomic_t cambioPendiente;	// Equivale a PendSV pendiente
+static volatile bool iniciado;				// os_PortInit() ya fijó hiloKernel
+static uint64_t inicioNs;					// CLOCK_MONOTONIC cuando el contador valía cero
+static void (*retornoTarea)(void);			// Función a la que salta una tarea que retorna
+
+static void (*isrUsuario[OS_PORT_CANT_IRQ])(void);
+static volatile uint32_t irqPendientes;
+
+
+/*==================[Funciones del port]=================================*/
+
+/*************************************************************************************************
+	 *  @brief Inicializa el host para el OS.
+     *
+     *  @details
+     *   Instala los manejadores del tick y de las interrupciones, que se ejecutan con ambas
+     *   señales bloqueadas (no se anidan, como SysTick y PendSV en el Cortex), y arranca el
+     *   timer del tick dirigido al hilo que llama a os_Init().
+     *
+	 *  @param 		cicloInicial	Valor inicial del contador de ciclos.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortInit(uint32_t cicloInicial)  {
+	struct sigaction accion;
+	struct sigevent evento;
+	struct itimerspec periodo;
+
+	inicioNs=relojNs()-cicloInicial;
+	hiloKernel=pthread_self();
+
+	sigemptyset(&senialesKernel);
+	sigaddset(&senialesKernel, SIGALRM);
+	sigaddset(&senialesKernel, SIGUSR1);
+
+	accion.sa_mask=senialesKernel;
+	accion.sa_flags=SA_RESTART;
+	accion.sa_handler=manejadorTick;
+	sigaction(SIGALRM, &accion, NULL);
+	accion.sa_handler=manejadorIRQ;
+	sigaction(SIGUSR1, &accion, NULL);
+
+	evento.sigev_notify=SIGEV_THREAD_ID;
+	evento.sigev_signo=SIGALRM;
+	evento.sigev_value.sival_ptr=NULL;
+	evento.sigev_notify_thread_id=(pid_t)syscall(SYS_gettid);
+	if(timer_create(CLOCK_MONOTONIC, &evento, &timerTick)!=0)  {
+		perror("os_PortInit: timer_create");
+		exit(EXIT_FAILURE);
+	}
+
+	iniciado=true;
+	if(irqPendientes!=0)
+		pthread_kill(hiloKernel, SIGUSR1);
+
+	periodo.it_interval.tv_sec=0;
+	periodo.it_interval.tv_nsec=OS_PORT_TICK_US*1000L;
+	periodo.it_value=periodo.it_interval;
+	timer_settime(timerTick, 0, &periodo, NULL);
+}
+
+/*************************************************************************************************
+	 *  @brief Arma el contexto inicial de una tarea.
+     *
+     *  @details
+     *   El ucontext_t se guarda en el tope del stack (alineado a 16 bytes) y la tarea usa el
+     *   resto, por encima de las palabras de guarda. Arranca en arranqueTarea() con todas las
+     *   señales habilitadas.
+     *
+	 *  @param 		stack		Fondo del stack.
+	 *  @param 		tope		Tope del stack.
+	 *  @param 		entryPoint	Dirección de la tarea (se toma de la tarea actual al arrancar).
+	 *  @param 		retorno		Función a la que salta la tarea si retorna.
+	 *  @return     La dirección del ucontext_t de la tarea.
+***************************************************************************************************/
+uintptr_t os_PortInitContexto(uint32_t *stack, uint32_t *tope, void *entryPoint, void *retorno)  {
+	ucontext_t *contexto;
+
+	(void)entryPoint;
+
+	contexto=(ucontext_t*)(((uintptr_t)tope - sizeof(ucontext_t)) & ~(uintptr_t)0x0F);
+	getcontext(contexto);
+	contexto->uc_stack.ss_sp=stack+STACK_GUARDAS;
+	contexto->uc_stack.ss_size=(uintptr_t)contexto - (uintptr_t)(stack+STACK_GUARDAS);
+	contexto->uc_link=NULL;
+	sigemptyset(&contexto->uc_sigmask);
+	makecontext(contexto, arranqueTarea, 0);
+
+	retornoTarea=(void (*)(void))retorno;
+	return (uintptr_t)contexto;
+}
+
+/*************************************************************************************************
+	 *  @brief Prepara el arranque de la primer tarea.
+     *
+     *  @details
+     *   No hay nada que preparar: sin tarea actual cambiarContexto() no guarda el contexto del
+     *   main, que se abandona.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortArranque(void)  {
+	cambioPendiente=0;
+}
+
+/*************************************************************************************************
+	 *  @brief Pide un cambio de contexto.
+     *
+     *  @details
+     *   En modo handler queda pendiente hasta que termine la señal o la llamada al kernel,
+     *   como PendSV. Fuera de él (el arranque desde os_Init()) se hace en el momento.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortCambioContexto(void)  {
+	uint32_t estado;
+
+	cambioPendiente=1;
+	if(enHandler)
+		return;
+
+	estado=irqOffGuardar();
+	cambiarContexto();
+	irqRestaurar(estado);
+}
+
+/*************************************************************************************************
+	 *  @brief Indica si un contexto guardado incluye la FPU.
+     *
+     *  @details
+     *   El ucontext_t siempre guarda los registros de punto flotante del host.
+     *
+	 *  @param 		sp		No se usa.
+	 *  @return     false.
+***************************************************************************************************/
+bool os_PortContextoFPU(uintptr_t sp)  {
+	(void)sp;
+	return false;
+}
+
+/*************************************************************************************************
+	 *  @brief Descarta el contexto de FPU de la tarea actual (no hace nada en el host).
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortLiberarFPU(void)  {
+}
+
+/*************************************************************************************************
+	 *  @brief Ejecuta una función del kernel en modo handler.
+     *
+     *  @details
+     *   Equivale al SVC: la función corre con las señales bloqueadas y marcada como modo
+     *   handler, por lo que un scheduling que pida se hace al terminar, antes de volver a la
+     *   tarea. Desde una señal se llama directamente. Como en el Cortex, desde una sección
+     *   crítica no se puede entrar al kernel (ERR_OS_SVC_IRQ_OFF).
+     *
+	 *  @param 		servicio	Función del kernel a ejecutar.
+	 *  @param 		arg0, arg1	Argumentos de la función.
+	 *  @return     El valor que devuelve la función.
+***************************************************************************************************/
+uintptr_t os_LlamadaKernel(servicioKernel servicio, uintptr_t arg0, uintptr_t arg1)  {
+	uintptr_t resultado;
+	uint32_t estado;
+
+	if(enHandler)
+		return servicio(arg0, arg1);
+
+	estado=irqOffGuardar();
+	if(estado!=0)  {
+		os_setError(ERR_OS_SVC_IRQ_OFF, servicio);
+		return 0;
+	}
+	enHandler=1;
+	resultado=servicio(arg0, arg1);
+	enHandler=0;
+	cambiarContexto();
+	irqRestaurar(estado);
+
+	return resultado;
+}
+
+/*************************************************************************************************
+	 *  @brief Bloquea las señales del kernel guardando el estado anterior.
+     *
+	 *  @param 		none.
+	 *  @return     1 si ya estaban bloqueadas, si no 0.
+***************************************************************************************************/
+uint32_t irqOffGuardar(void) {
+	sigset_t anterior;
+
+	pthread_sigmask(SIG_BLOCK, &senialesKernel, &anterior);
+	return sigismember(&anterior, SIGALRM) ? 1 : 0;
+}
+
+/*************************************************************************************************
+	 *  @brief Restaura el estado de las señales guardado por irqOffGuardar().
+     *
+	 *  @param 		estado.
+	 *  @return     None.
+***************************************************************************************************/
+void irqRestaurar(uint32_t estado) {
+	if(estado==0)
+		pthread_sigmask(SIG_UNBLOCK, &senialesKernel, NULL);
+}
+
+/*************************************************************************************************
+	 *  @brief Bloquea las señales del kernel.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortIrqDeshabilitar(void)  {
+	pthread_sigmask(SIG_BLOCK, &senialesKernel, NULL);
+}
+
+/*************************************************************************************************
+	 *  @brief Desbloquea las señales del kernel.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortIrqHabilitar(void)  {
+	pthread_sigmask(SIG_UNBLOCK, &senialesKernel, NULL);
+}
+
+/*************************************************************************************************
+	 *  @brief Duerme el hilo hasta la próxima señal.
+     *
+     *  @details
+     *   sigsuspend() habilita las señales y espera en forma atómica, por lo que no se pierde
+     *   una señal que llegue justo antes de dormir (como __WFI con PRIMASK).
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortEsperarIrq(void)  {
+	sigset_t vacio;
+
+	sigemptyset(&vacio);
+	sigsuspend(&vacio);
+}
+
+/*************************************************************************************************
+	 *  @brief Duerme sin tick (el port no suprime el tick).
+     *
+     *  @details
+     *   Se espera la próxima señal y el tick se sigue contando normalmente.
+     *
+	 *  @param 		ticks	No se usa.
+	 *  @return     0.
+***************************************************************************************************/
+uint32_t os_PortDormirTicks(uint32_t ticks)  {
+	(void)ticks;
+	os_PortEsperarIrq();
+	return 0;
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve los ciclos (ns) de un tick.
+     *
+	 *  @param 		None.
+	 *  @return     Ciclos por tick.
+***************************************************************************************************/
+uint32_t os_PortCiclosPorTick(void)  {
+	return (uint32_t)((uint64_t)SystemCoreClock*OS_PORT_TICK_US/1000000);
+}
+
+/*************************************************************************************************
+	 *  @brief Lee el contador de ciclos (ns de CLOCK_MONOTONIC).
+     *
+	 *  @param 		ciclos	Donde se dejan los 32 bits bajos del contador.
+	 *  @return     true.
+***************************************************************************************************/
+bool os_PortCiclos(uint32_t *ciclos)  {
+	*ciclos=(uint32_t)(relojNs()-inicioNs);
+	return true;
+}
+
+/*************************************************************************************************
+	 *  @brief Ciclos transcurridos del tick en curso.
+     *
+     *  @details
+     *   No se usa: os_PortCiclos() siempre cuenta.
+     *
+	 *  @param 		pendiente	Siempre 0.
+	 *  @return     0.
+***************************************************************************************************/
+uint32_t os_PortCiclosEnTick(uint32_t *pendiente)  {
+	*pendiente=0;
+	return 0;
+}
+
+/*************************************************************************************************
+	 *  @brief Instala una interrupción simulada.
+     *
+	 *  @param 		irq, usr_isr
+	 *  @return     true o false.
+***************************************************************************************************/
+bool os_InstalarIRQ(uint32_t irq, void* usr_isr)  {
+	if(irq>=OS_PORT_CANT_IRQ || isrUsuario[irq]!=NULL)
+		return false;
+
+	isrUsuario[irq]=(void (*)(void))usr_isr;
+	return true;
+}
+
+/*************************************************************************************************
+	 *  @brief Desinstala una interrupción simulada.
+     *
+	 *  @param 		irq
+	 *  @return     true o false.
+***************************************************************************************************/
+bool os_RemoverIRQ(uint32_t irq)  {
+	if(irq>=OS_PORT_CANT_IRQ || isrUsuario[irq]==NULL)
+		return false;
+
+	isrUsuario[irq]=NULL;
+	__atomic_fetch_and(&irqPendientes, ~(1UL << irq), __ATOMIC_SEQ_CST);
+	return true;
+}
+
+/*************************************************************************************************
+	 *  @brief Pone pendiente una interrupción simulada.
+     *
+     *  @details
+     *   Se puede llamar desde cualquier hilo del proceso (un periférico simulado) o desde una
+     *   tarea. Varias llamadas antes de que se atienda cuentan como una, como en el NVIC.
+     *   Antes de os_Init() la interrupción solo queda pendiente.
+     *
+	 *  @param 		irq
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortDispararIRQ(uint32_t irq)  {
+	if(irq>=OS_PORT_CANT_IRQ)
+		return;
+
+	__atomic_fetch_or(&irqPendientes, 1UL << irq, __ATOMIC_SEQ_CST);
+	if(iniciado)
+		pthread_kill(hiloKernel, SIGUSR1);
+}
+
+/*================[Funciones internas del port]==========================*/
+
+/*************************************************************************************************
+	 *  @brief Hace el cambio de contexto pendiente.
+     *
+     *  @details
+     *   Equivale a PendSV_Handler. Se llama con las señales bloqueadas, fuera del modo handler.
+     *   La tarea saliente queda dentro de swapcontext() y sigue desde ahí cuando vuelve a ser
+     *   elegida. Con ASan se le avisa del cambio de stack.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void cambiarContexto(void)  {
+	tarea *actual;
+	ucontext_t *saliente, *entrante;
+#ifdef OS_PORT_ASAN
+	void *pilaFalsa=NULL;				// Estado de ASan de la tarea saliente, en su stack
+#endif
+
+	while(cambioPendiente)  {
+		cambioPendiente=0;
+
+		actual=os_getTareaActual();
+		saliente=(actual!=NULL) ? (ucontext_t*)actual->stack_pointer : NULL;
+		entrante=(ucontext_t*)getContextoSiguiente((uintptr_t)saliente);
+		if(entrante==saliente)
+			continue;
+
+#ifdef OS_PORT_ASAN
+		__sanitizer_start_switch_fiber((saliente!=NULL) ? &pilaFalsa : NULL,
+				entrante->uc_stack.ss_sp, entrante->uc_stack.ss_size);
+#endif
+		if(saliente==NULL)
+			setcontext(entrante);
+		swapcontext(saliente, entrante);
+#ifdef OS_PORT_ASAN
+		__sanitizer_finish_switch_fiber(pilaFalsa, NULL, NULL);
+#endif
+	}
+}
+
+/*************************************************************************************************
+	 *  @brief Punto de entrada de todas las tareas.
+     *
+     *  @details
+     *   makecontext() solo pasa argumentos int, por lo que la tarea a ejecutar se toma de la
+     *   tarea actual.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void arranqueTarea(void)  {
+	void (*tareaUsuario)(void);
+
+#ifdef OS_PORT_ASAN
+	__sanitizer_finish_switch_fiber(NULL, NULL, NULL);
+#endif
+
+	tareaUsuario=(void (*)(void))os_getTareaActual()->entry_point;
+	tareaUsuario();
+	retornoTarea();
+
+	while(1)
+		os_PortEsperarIrq();
+}
+
+/*************************************************************************************************
+	 *  @brief Manejador de la señal del tick.
+     *
+	 *  @param 		senial	SIGALRM.
+	 *  @return     None.
+***************************************************************************************************/
+static void manejadorTick(int senial)  {
+	int errnoPrevio=errno;
+
+	(void)senial;
+
+	enHandler=1;
+	SysTick_Handler();
+	enHandler=0;
+	cambiarContexto();
+
+	errno=errnoPrevio;
+}
+
+/*************************************************************************************************
+	 *  @brief Manejador de la señal de las interrupciones simuladas.
+     *
+     *  @details
+     *   Atiende todas las interrupciones pendientes, de la de menor número a la de mayor. Si
+     *   alguna pidió un scheduling (os_setFlagISR()) se hace una sola vez, al terminar.
+     *
+	 *  @param 		senial	SIGUSR1.
+	 *  @return     None.
+***************************************************************************************************/
+static void manejadorIRQ(int senial)  {
+	int errnoPrevio=errno;
+	uint32_t pendientes;
+
+	(void)senial;
+
+	enHandler=1;
+	while((pendientes=__atomic_exchange_n(&irqPendientes, 0, __ATOMIC_SEQ_CST))!=0)  {
+		while(pendientes!=0)  {
+			despacharIRQ((uint32_t)__builtin_ctz(pendientes));
+			pendientes&=pendientes-1;
+		}
+	}
+
+	if(os_getFlagISR())  {
+		os_setFlagISR(false);
+		os_Yield();
+	}
+	enHandler=0;
+	cambiarContexto();
+
+	errno=errnoPrevio;
+}
+
+/*************************************************************************************************
+	 *  @brief Llama a la función de usuario de una interrupción.
+     *
+     *  @details
+     *   Igual que os_IRQHandler en el Cortex: marca el sistema en OS_IRQ_RUN, registra la
+     *   traza y suma los ciclos de la interrupción con os_SumarCiclosIRQ().
+     *
+	 *  @param 		irq
+	 *  @return     None.
+***************************************************************************************************/
+static void despacharIRQ(uint32_t irq)  {
+	estadoOS estadoPrevio_OS;
+	void (*funcion_usuario)(void);
+	uint32_t inicio;
+
+	funcion_usuario=isrUsuario[irq];
+	if(funcion_usuario==NULL)
+		return;
+
+	estadoPrevio_OS=os_getEstadoSistema();
+	os_setEstadoSistema(OS_IRQ_RUN);
+	inicio=os_getCiclos();
+	OS_TRAZA_EVENTO(TRAZA_IRQ_ENTRA, os_getTareaActual(), irq);
+
+	funcion_usuario();
+
+	OS_TRAZA_EVENTO(TRAZA_IRQ_SALE, os_getTareaActual(), irq);
+	os_SumarCiclosIRQ(os_getCiclos()-inicio);
+	os_setEstadoSistema(estadoPrevio_OS);
+}
+
+/*************************************************************************************************
+	 *  @brief Lee CLOCK_MONOTONIC en nanosegundos.
+     *
+	 *  @param 		None.
+	 *  @return     Nanosegundos.
+***************************************************************************************************/
+static uint64_t relojNs(void)  {
+	struct timespec ahora;
+
+	clock_gettime(CLOCK_MONOTONIC, &ahora);
+	return (uint64_t)ahora.tv_sec*1000000000ULL + (uint64_t)ahora.tv_nsec;
+}
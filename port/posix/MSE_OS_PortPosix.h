@@ -0,0 +1,89 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_PortPosix.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Este módulo declara el port del S.O. para una PC con Linux. Las tareas son
+ * contextos de ucontext dentro de un único hilo, el tick es una señal de un
+ * timer POSIX y las interrupciones son señales que se disparan con
+ * os_PortDispararIRQ() desde cualquier hilo. Sirve para correr el kernel sin
+ * modificar con perf y con los sanitizers (ASan, UBSan).
+ * Los "ciclos" del port son nanosegundos (SystemCoreClock vale 1 GHz).
+ *
+ *===========================================================================*/
+
+#ifndef MSE_OS_PORT_POSIX_MSE_OS_PORTPOSIX_H_
+#define MSE_OS_PORT_POSIX_MSE_OS_PORTPOSIX_H_
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/********************************************************************************
+ * Definicion de las constantes
+ *******************************************************************************/
+#ifndef OS_TICKLESS_IDLE
+#define OS_TICKLESS_IDLE			0			// El port no suprime el tick
+#endif
+
+/*
+ * Los stacks de las tareas alojan el ucontext_t y los frames de las señales del host, que
+ * son mucho más grandes que en el Cortex (más aún con ASan).
+ */
+#ifndef STACK_SIZE
+#define STACK_SIZE					65536
+#endif
+#ifndef STACK_SIZE_IDLE
+#define STACK_SIZE_IDLE				65536
+#endif
+#define OS_PORT_STACK_MIN			16384
+
+#ifndef OS_PORT_TICK_US
+#define OS_PORT_TICK_US				1000		// Período del tick en us
+#endif
+
+#define OS_PORT_CANT_IRQ			32			// Interrupciones simuladas (0 a 31)
+
+
+/********************************************************************************
+ * Intrínsecos del Cortex que usa el kernel
+ *******************************************************************************/
+static inline uint32_t __CLZ(uint32_t valor)  {
+	return (valor!=0) ? (uint32_t)__builtin_clz(valor) : 32;
+}
+
+static inline uint32_t __RBIT(uint32_t valor)  {
+	uint32_t invertido=0;
+
+	for(uint8_t c=0;c<32;c++)  {
+		invertido=(invertido << 1) | (valor & 1);
+		valor >>= 1;
+	}
+	return invertido;
+}
+
+#define __DMB()		__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __DSB()		__atomic_thread_fence(__ATOMIC_SEQ_CST)
+#define __ISB()		__atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define __NOP()		((void)0)
+
+
+/********************************************************************************
+ * Definicion de las variables externas
+ *******************************************************************************/
+extern uint32_t SystemCoreClock;				// 1 GHz: un ciclo es un nanosegundo
+
+
+/*=============[Definición de prototipos para las Tareas]=======================*/
+// Interrupciones simuladas: se atienden con las mismas reglas que os_IRQHandler
+bool os_InstalarIRQ(uint32_t irq, void* usr_isr);
+bool os_RemoverIRQ(uint32_t irq);
+// Pone pendiente una interrupción simulada; se puede llamar desde cualquier hilo
+void os_PortDispararIRQ(uint32_t irq);
+
+
+#endif /* MSE_OS_PORT_POSIX_MSE_OS_PORTPOSIX_H_ */
@@ -0,0 +1,161 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: main.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * Ejemplo del S.O. corriendo en una PC con Linux (port POSIX).
+ * Usa el mismo scheduler, semáforos y colas que en la EDU-CIAA:
+ *  - tareaPing y tareaPong se pasan un semáforo (cambios de contexto).
+ *  - tareaProductor le manda datos a tareaConsumidor por una cola.
+ *  - Un hilo del host simula un periférico que interrumpe cada 2 ms; la ISR
+ *    libera un semáforo con os_SemaforoGiveFromISR().
+ *  - tareaReporte muestra las cuentas y la carga de CPU cada segundo y
+ *    termina el proceso luego de SEGUNDOS reportes, con error si algo no
+ *    avanzó.
+ *
+ *===========================================================================*/
+
+/*==================[inclusions]=============================================*/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "MSE_OS_Core.h"
+#include "MSE_API.h"
+
+/*==================[Macros and definitions]=================================*/
+
+#define SEGUNDOS			3			// Reportes antes de terminar
+#define IRQ_PERIFERICO		0			// Interrupción simulada del periférico
+#define PERIODO_IRQ_US		2000
+
+/*==================[internal data definition]===============================*/
+
+static tarea estadoTareaPing, estadoTareaPong, estadoTareaProductor;
+static tarea estadoTareaConsumidor, estadoTareaIRQ, estadoTareaReporte;
+
+static semaforo semPing, semPong, semIRQ;
+static cola colaDatos;
+
+static volatile uint32_t cuentaPingPong, cuentaCola, cuentaIRQ, erroresCola;
+
+/*==================[internal functions definition]==========================*/
+
+static void tareaPing(void)  {
+	while(1)  {
+		os_SemaforoGive(&semPong);
+		os_SemaforoTake(&semPing, portMax_DELAY);
+		cuentaPingPong++;
+	}
+}
+
+static void tareaPong(void)  {
+	while(1)  {
+		os_SemaforoTake(&semPong, portMax_DELAY);
+		os_SemaforoGive(&semPing);
+	}
+}
+
+static void tareaProductor(void)  {
+	uint32_t dato=0;
+
+	while(1)  {
+		os_ColaPush(&colaDatos, &dato);
+		dato++;
+	}
+}
+
+static void tareaConsumidor(void)  {
+	uint32_t dato, esperado=0;
+
+	while(1)  {
+		os_ColaPop(&colaDatos, &dato);
+		if(dato!=esperado)
+			erroresCola++;
+		esperado=dato+1;
+		cuentaCola++;
+	}
+}
+
+static void tareaIRQ(void)  {
+	while(1)  {
+		os_SemaforoTake(&semIRQ, portMax_DELAY);
+		cuentaIRQ++;
+	}
+}
+
+static void tareaReporte(void)  {
+	uint32_t previoPingPong=0, previoCola=0, previoIRQ=0;
+	estadisticasTarea estadisticas;
+
+	for(uint8_t segundo=1;segundo<=SEGUNDOS;segundo++)  {
+		tareaDelay(1000);
+
+		printf("[%u s] ping-pong %u/s  cola %u/s  irq %u/s  carga %u%%\n", segundo,
+				cuentaPingPong-previoPingPong, cuentaCola-previoCola, cuentaIRQ-previoIRQ,
+				os_getCargaCPU());
+		if(cuentaPingPong==previoPingPong || cuentaCola==previoCola || cuentaIRQ==previoIRQ ||
+				erroresCola!=0)  {
+			printf("ERROR: el sistema no avanza (errores en la cola: %u)\n", erroresCola);
+			exit(EXIT_FAILURE);
+		}
+		previoPingPong=cuentaPingPong;
+		previoCola=cuentaCola;
+		previoIRQ=cuentaIRQ;
+	}
+
+	os_getEstadisticasTarea(&estadoTareaPing, &estadisticas);
+	printf("tareaPing: %llu ns, %u cambios de contexto, %u expropiaciones\n",
+			(unsigned long long)os_CiclosANs(estadisticas.ciclos), estadisticas.cambiosContexto,
+			estadisticas.expropiaciones);
+	printf("OK\n");
+	exit(EXIT_SUCCESS);
+}
+
+static void isrPeriferico(void)  {
+	os_SemaforoGiveFromISR(&semIRQ);
+}
+
+// Periférico simulado: un hilo del host que dispara la interrupción periódicamente
+static void* hiloPeriferico(void *arg)  {
+	struct timespec periodo={0, PERIODO_IRQ_US*1000L};
+
+	(void)arg;
+
+	while(1)  {
+		nanosleep(&periodo, NULL);
+		os_PortDispararIRQ(IRQ_PERIFERICO);
+	}
+	return NULL;
+}
+
+/*==================[external functions definition]==========================*/
+
+int main(void)  {
+	pthread_t hilo;
+
+	os_SemaforoInit(&semPing);
+	os_SemaforoInit(&semPong);
+	os_SemaforoInit(&semIRQ);
+	os_ColaInit(&colaDatos, sizeof(uint32_t));
+
+	os_InitTarea(tareaPing, &estadoTareaPing, PRIORIDAD_2);
+	os_InitTarea(tareaPong, &estadoTareaPong, PRIORIDAD_2);
+	os_InitTarea(tareaProductor, &estadoTareaProductor, PRIORIDAD_2);
+	os_InitTarea(tareaConsumidor, &estadoTareaConsumidor, PRIORIDAD_2);
+	os_InitTarea(tareaIRQ, &estadoTareaIRQ, PRIORIDAD_0);
+	os_InitTarea(tareaReporte, &estadoTareaReporte, PRIORIDAD_1);
+
+	os_InstalarIRQ(IRQ_PERIFERICO, isrPeriferico);
+
+	// El tick y las interrupciones se envían siempre al hilo de las tareas
+	pthread_create(&hilo, NULL, hiloPeriferico, NULL);
+
+	os_Init();
+
+	return 0;
+}
@@ -0,0 +1,885 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_PortVirtual.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * En este módulo se encuentra el port del S.O. con tiempo virtual.
+ *
+ * Las tareas y el modo handler son como en el port POSIX (ucontext_t en el
+ * tope del stack, cambio de contexto diferido al salir del handler), pero
+ * todo corre en el hilo de la aplicación y nada depende del reloj real:
+ *  - Reloj: ahoraNs, que solo avanza en os_VirtualTrabajar() (una tarea usa
+ *    la CPU) y cuando la idle espera (salta al próximo evento).
+ *  - SysTick: vence cada OS_PORT_TICK_US de tiempo virtual. En la idle se
+ *    suprime como en el Cortex (os_PortDormirTicks()).
+ *  - Interrupciones: bits pendientes, puestos por la lista de eventos
+ *    programados o por os_PortDispararIRQ(). Si en el mismo instante vencen
+ *    interrupciones y el tick se atienden primero las interrupciones, que en
+ *    el Cortex tienen mayor prioridad. Las que quedan pendientes al terminar
+ *    un handler se atienden antes del cambio de contexto, como antes de
+ *    PendSV, que tiene la menor prioridad.
+ *  - Secciones críticas: una bandera que posterga la atención de lo pendiente
+ *    hasta que se vuelven a habilitar (equivale a BASEPRI).
+ *  - Aplicación: os_VirtualCorrer() pasa al S.O. y vuelve cuando el reloj
+ *    llega al límite del tramo. La tarea que estaba corriendo queda en pausa
+ *    en contextoPausa hasta el tramo siguiente.
+ *
+ *===========================================================================*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ucontext.h>
+
+#include "MSE_OS_Core.h"
+#include "MSE_OS_Traza.h"
+
+#if defined(__SANITIZE_ADDRESS__)
+#define OS_PORT_ASAN	1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define OS_PORT_ASAN	1
+#endif
+#endif
+
+#ifdef OS_PORT_ASAN
+#include <sanitizer/common_interface_defs.h>
+#endif
+
+
+/*==================[Definición de datos internos]=================================*/
+
+typedef struct  {
+	uint64_t tiempoNs;
+	uint32_t irq;
+} eventoVirtual;
+
+
+/*===================[Declaración de funciones locales]================================*/
+
+static void arranqueOS(void);
+static void arranqueTarea(void);
+static void cambiarContexto(void);
+static void registrarDecision(tarea *saliente);
+static void atenderPendientes(void);
+static void atenderIRQ(void);
+static void atenderIRQAntesDePendSV(void);
+static void despacharIRQ(uint32_t irq);
+static void marcarVencidos(void);
+static uint64_t proximoEvento(void);
+static uint64_t proximaIRQ(void);
+static void pausarSiLimite(void);
+static void pausar(void);
+
+
+/*==================[Definición de variables globales]=================================*/
+
+uint32_t SystemCoreClock=1000000000;
+
+static uint64_t ahoraNs;					// Reloj virtual
+static uint64_t limiteNs;					// Fin del tramo de os_VirtualCorrer() en curso
+static uint64_t proximoTickNs;
+static uint64_t periodoTickNs;
+
+static bool bloqueadas=true;				// Sección crítica (hasta que arranca la primer tarea)
+static bool enHandler;						// Modo handler: tick, interrupción o llamada al kernel
+static bool enAplicacion=true;				// Corre la aplicación, fuera de os_VirtualCorrer()
+static bool cambioPendiente;				// Equivale a PendSV pendiente
+static bool tickPendiente;
+static uint32_t irqPendientes;
+static void (*isrUsuario[OS_PORT_CANT_IRQ])(void);
+static void (*retornoTarea)(void);			// Función a la que salta una tarea que retorna
+
+static eventoVirtual eventos[OS_VIRTUAL_MAX_EVENTOS];	// Ordenados por tiempo
+static uint32_t primerEvento, cantEventos;				// Sin atender: [primerEvento, cantEventos)
+
+static decisionVirtual decisiones[OS_VIRTUAL_MAX_DECISIONES];
+static uint32_t cantDecisiones;
+
+static bool arrancado;						// os_Init() ya corrió
+static ucontext_t contextoAplicacion;
+static ucontext_t contextoPausa;			// Tarea que corría al terminar el tramo
+static ucontext_t contextoArranque;			// Contexto propio para os_Init()
+static uint32_t stackArranque[STACK_SIZE/4] __attribute__((aligned(16)));
+
+#ifdef OS_PORT_ASAN
+static const void *aplicacionInferior;		// Stack de la aplicación, para avisarle a ASan
+static size_t aplicacionTamanio;
+static const void *pausaInferior;			// Stack de la tarea en pausa
+static size_t pausaTamanio;
+#endif
+
+
+/*==================[Funciones del port]=================================*/
+
+/*************************************************************************************************
+	 *  @brief Inicializa el reloj virtual para el OS.
+     *
+     *  @details
+     *   El contador de ciclos es el propio reloj virtual, por lo que no hace falta alinearlo con
+     *   cicloInicial. El primer tick vence un período después del arranque.
+     *
+	 *  @param 		cicloInicial	No se usa.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortInit(uint32_t cicloInicial)  {
+	(void)cicloInicial;
+	periodoTickNs=os_PortCiclosPorTick();
+	proximoTickNs=ahoraNs+periodoTickNs;
+}
+
+/*************************************************************************************************
+	 *  @brief Arma el contexto inicial de una tarea.
+     *
+     *  @details
+     *   Igual que en el port POSIX: el ucontext_t se guarda en el tope del stack y la tarea usa
+     *   el resto, por encima de las palabras de guarda. Arranca en arranqueTarea().
+     *
+	 *  @param 		stack		Fondo del stack.
+	 *  @param 		tope		Tope del stack.
+	 *  @param 		entryPoint	Dirección de la tarea (se toma de la tarea actual al arrancar).
+	 *  @param 		retorno		Función a la que salta la tarea si retorna.
+	 *  @return     La dirección del ucontext_t de la tarea.
+***************************************************************************************************/
+uintptr_t os_PortInitContexto(uint32_t *stack, uint32_t *tope, void *entryPoint, void *retorno)  {
+	ucontext_t *contexto;
+
+	(void)entryPoint;
+
+	contexto=(ucontext_t*)(((uintptr_t)tope - sizeof(ucontext_t)) & ~(uintptr_t)0x0F);
+	getcontext(contexto);
+	contexto->uc_stack.ss_sp=stack+STACK_GUARDAS;
+	contexto->uc_stack.ss_size=(uintptr_t)contexto - (uintptr_t)(stack+STACK_GUARDAS);
+	contexto->uc_link=NULL;
+	makecontext(contexto, arranqueTarea, 0);
+
+	retornoTarea=(void (*)(void))retorno;
+	return (uintptr_t)contexto;
+}
+
+/*************************************************************************************************
+	 *  @brief Prepara el arranque de la primer tarea.
+     *
+     *  @details
+     *   os_Init() corre en contextoArranque, que se abandona al lanzar la primer tarea.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortArranque(void)  {
+	cambioPendiente=false;
+}
+
+/*************************************************************************************************
+	 *  @brief Pide un cambio de contexto.
+     *
+     *  @details
+     *   En modo handler queda pendiente hasta que termine, como PendSV. Fuera de él (el
+     *   arranque desde os_Init()) se hace en el momento.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortCambioContexto(void)  {
+	uint32_t estado;
+
+	cambioPendiente=true;
+	if(enHandler)
+		return;
+
+	estado=irqOffGuardar();
+	cambiarContexto();
+	irqRestaurar(estado);
+}
+
+/*************************************************************************************************
+	 *  @brief Indica si un contexto guardado incluye la FPU.
+     *
+	 *  @param 		sp		No se usa.
+	 *  @return     false.
+***************************************************************************************************/
+bool os_PortContextoFPU(uintptr_t sp)  {
+	(void)sp;
+	return false;
+}
+
+/*************************************************************************************************
+	 *  @brief Descarta el contexto de FPU de la tarea actual (no hace nada en el host).
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortLiberarFPU(void)  {
+}
+
+/*************************************************************************************************
+	 *  @brief Ejecuta una función del kernel en modo handler.
+     *
+     *  @details
+     *   Equivale al SVC: el scheduling que pida la función se hace al terminar, y al salir de
+     *   la sección crítica se atiende lo que venció mientras tanto. Como en el Cortex, desde
+     *   una sección crítica de una tarea no se puede entrar al kernel (ERR_OS_SVC_IRQ_OFF); la
+     *   aplicación, fuera de os_VirtualCorrer(), sí puede.
+     *
+	 *  @param 		servicio	Función del kernel a ejecutar.
+	 *  @param 		arg0, arg1	Argumentos de la función.
+	 *  @return     El valor que devuelve la función.
+***************************************************************************************************/
+uintptr_t os_LlamadaKernel(servicioKernel servicio, uintptr_t arg0, uintptr_t arg1)  {
+	uintptr_t resultado;
+	uint32_t estado;
+
+	if(enHandler)
+		return servicio(arg0, arg1);
+
+	if(bloqueadas && !enAplicacion)  {
+		os_setError(ERR_OS_SVC_IRQ_OFF, servicio);
+		return 0;
+	}
+
+	estado=irqOffGuardar();
+	enHandler=true;
+	resultado=servicio(arg0, arg1);
+	if(estado==0)
+		atenderIRQAntesDePendSV();
+	enHandler=false;
+	cambiarContexto();
+	irqRestaurar(estado);
+
+	return resultado;
+}
+
+/*************************************************************************************************
+	 *  @brief Entra en sección crítica guardando el estado anterior.
+     *
+	 *  @param 		none.
+	 *  @return     1 si ya estaba en sección crítica, si no 0.
+***************************************************************************************************/
+uint32_t irqOffGuardar(void) {
+	uint32_t estado=bloqueadas ? 1 : 0;
+
+	bloqueadas=true;
+	return estado;
+}
+
+/*************************************************************************************************
+	 *  @brief Restaura el estado guardado por irqOffGuardar().
+     *
+     *  @details
+     *   Al salir de la sección crítica se atiende lo que quedó pendiente, como en el Cortex al
+     *   bajar BASEPRI.
+     *
+	 *  @param 		estado.
+	 *  @return     None.
+***************************************************************************************************/
+void irqRestaurar(uint32_t estado) {
+	if(estado==0)  {
+		bloqueadas=false;
+		atenderPendientes();
+	}
+}
+
+/*************************************************************************************************
+	 *  @brief Deshabilita las interrupciones virtuales.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortIrqDeshabilitar(void)  {
+	bloqueadas=true;
+}
+
+/*************************************************************************************************
+	 *  @brief Habilita las interrupciones virtuales y atiende las pendientes.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortIrqHabilitar(void)  {
+	bloqueadas=false;
+	atenderPendientes();
+}
+
+/*************************************************************************************************
+	 *  @brief Espera la próxima interrupción.
+     *
+     *  @details
+     *   Si no hay nada pendiente el reloj salta al próximo evento (o al fin del tramo). Como
+     *   __WFI, despierta aunque las interrupciones estén deshabilitadas, y en ese caso se
+     *   atienden recién al habilitarlas.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortEsperarIrq(void)  {
+	pausarSiLimite();
+	if(irqPendientes==0 && !tickPendiente)  {
+		ahoraNs=(proximoEvento()<limiteNs) ? proximoEvento() : limiteNs;
+		marcarVencidos();
+	}
+	atenderPendientes();
+}
+
+/*************************************************************************************************
+	 *  @brief Duerme sin tick.
+     *
+     *  @details
+     *   Igual que en el Cortex: se duerme hasta el final del tick en curso más ticks-1 ticks y
+     *   ese último tick lo cuenta SysTick_Handler. Si antes vence una interrupción (o el fin del
+     *   tramo) se cuentan los ticks completos transcurridos y el tick siguiente vence en el
+     *   mismo instante que si no se hubiese suprimido.
+     *   Cada llamada duerme como máximo un segundo, para que el contador de ciclos de 32 bits
+     *   no dé la vuelta entre dos ticks.
+     *
+	 *  @param 		ticks	Ticks hasta el próximo vencimiento.
+	 *  @return     Ticks completos transcurridos que no atenderá SysTick_Handler.
+***************************************************************************************************/
+uint32_t os_PortDormirTicks(uint32_t ticks)  {
+	uint64_t ultimoTick, objetivo, despertar;
+	uint32_t ticksMax, completos;
+
+	pausarSiLimite();
+	if(irqPendientes!=0 || tickPendiente)
+		return 0;
+
+	ticksMax=(periodoTickNs<SystemCoreClock) ? (uint32_t)(SystemCoreClock/periodoTickNs) : 1;
+	if(ticks>ticksMax)
+		ticks=ticksMax;
+
+	ultimoTick=proximoTickNs-periodoTickNs;
+	objetivo=ultimoTick+(uint64_t)ticks*periodoTickNs;
+	// El tick está suprimido: solo despiertan antes una interrupción o el fin del tramo
+	despertar=(proximaIRQ()<limiteNs) ? proximaIRQ() : limiteNs;
+	ahoraNs=(objetivo<despertar) ? objetivo : despertar;
+
+	if(ahoraNs==objetivo)  {
+		// Venció la cuenta: el último tick queda pendiente para SysTick_Handler
+		completos=ticks-1;
+		proximoTickNs=objetivo;
+	}
+	else  {
+		completos=(uint32_t)((ahoraNs-ultimoTick)/periodoTickNs);
+		proximoTickNs=ultimoTick+(uint64_t)(completos+1)*periodoTickNs;
+	}
+	marcarVencidos();
+
+	return completos;
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve los ciclos (ns) de un tick.
+     *
+	 *  @param 		None.
+	 *  @return     Ciclos por tick.
+***************************************************************************************************/
+uint32_t os_PortCiclosPorTick(void)  {
+	return (uint32_t)((uint64_t)SystemCoreClock*OS_PORT_TICK_US/1000000);
+}
+
+/*************************************************************************************************
+	 *  @brief Lee el contador de ciclos (el reloj virtual en ns).
+     *
+	 *  @param 		ciclos	Donde se dejan los 32 bits bajos del contador.
+	 *  @return     true.
+***************************************************************************************************/
+bool os_PortCiclos(uint32_t *ciclos)  {
+	*ciclos=(uint32_t)ahoraNs;
+	return true;
+}
+
+/*************************************************************************************************
+	 *  @brief Ciclos transcurridos del tick en curso.
+     *
+     *  @details
+     *   No se usa: os_PortCiclos() siempre cuenta.
+     *
+	 *  @param 		pendiente	Siempre 0.
+	 *  @return     0.
+***************************************************************************************************/
+uint32_t os_PortCiclosEnTick(uint32_t *pendiente)  {
+	*pendiente=0;
+	return 0;
+}
+
+/*************************************************************************************************
+	 *  @brief Instala una interrupción simulada.
+     *
+	 *  @param 		irq, usr_isr
+	 *  @return     true o false.
+***************************************************************************************************/
+bool os_InstalarIRQ(uint32_t irq, void* usr_isr)  {
+	if(irq>=OS_PORT_CANT_IRQ || isrUsuario[irq]!=NULL)
+		return false;
+
+	isrUsuario[irq]=(void (*)(void))usr_isr;
+	return true;
+}
+
+/*************************************************************************************************
+	 *  @brief Desinstala una interrupción simulada.
+     *
+	 *  @param 		irq
+	 *  @return     true o false.
+***************************************************************************************************/
+bool os_RemoverIRQ(uint32_t irq)  {
+	if(irq>=OS_PORT_CANT_IRQ || isrUsuario[irq]==NULL)
+		return false;
+
+	isrUsuario[irq]=NULL;
+	irqPendientes&=~(1UL << irq);
+	return true;
+}
+
+/*************************************************************************************************
+	 *  @brief Pone pendiente una interrupción simulada en el instante actual.
+     *
+     *  @details
+     *   Desde una tarea fuera de sección crítica se atiende en el momento. Desde la aplicación
+     *   (entre tramos) se atiende al empezar el tramo siguiente.
+     *
+	 *  @param 		irq
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortDispararIRQ(uint32_t irq)  {
+	if(irq>=OS_PORT_CANT_IRQ)
+		return;
+
+	irqPendientes|=1UL << irq;
+	atenderPendientes();
+}
+
+/*==================[Funciones del tiempo virtual]=================================*/
+
+/*************************************************************************************************
+	 *  @brief Corre el S.O. durante un tramo de tiempo virtual.
+     *
+     *  @details
+     *   La primera vez arranca el S.O. con os_Init() en contextoArranque; las siguientes sigue
+     *   la tarea que quedó en pausa. Vuelve cuando el reloj llega al final del tramo o cuando
+     *   una tarea llama a os_VirtualDetener(). Las tareas, colas, etc. se crean antes, como
+     *   antes de os_Init().
+     *
+	 *  @param 		ns		Duración del tramo.
+	 *  @return     None.
+***************************************************************************************************/
+void os_VirtualCorrer(uint64_t ns)  {
+	ucontext_t *destino;
+#ifdef OS_PORT_ASAN
+	void *pilaFalsa=NULL;
+#endif
+
+	limiteNs=ahoraNs+ns;
+
+	if(!arrancado)  {
+		arrancado=true;
+		getcontext(&contextoArranque);
+		contextoArranque.uc_stack.ss_sp=stackArranque;
+		contextoArranque.uc_stack.ss_size=sizeof(stackArranque);
+		contextoArranque.uc_link=NULL;
+		makecontext(&contextoArranque, arranqueOS, 0);
+		destino=&contextoArranque;
+	}
+	else
+		destino=&contextoPausa;
+
+#ifdef OS_PORT_ASAN
+	if(destino==&contextoArranque)
+		__sanitizer_start_switch_fiber(&pilaFalsa, stackArranque, sizeof(stackArranque));
+	else
+		__sanitizer_start_switch_fiber(&pilaFalsa, pausaInferior, pausaTamanio);
+#endif
+	enAplicacion=false;
+	swapcontext(&contextoAplicacion, destino);
+	enAplicacion=true;
+#ifdef OS_PORT_ASAN
+	__sanitizer_finish_switch_fiber(pilaFalsa, NULL, NULL);
+#endif
+}
+
+/*************************************************************************************************
+	 *  @brief Termina el tramo en curso de os_VirtualCorrer().
+     *
+     *  @details
+     *   La tarea que la llama queda en pausa y sigue desde acá en el tramo siguiente.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_VirtualDetener(void)  {
+	limiteNs=ahoraNs;
+	pausarSiLimite();
+}
+
+/*************************************************************************************************
+	 *  @brief La tarea actual usa la CPU durante un tiempo virtual.
+     *
+     *  @details
+     *   Es la única forma de que el tiempo avance mientras corre una tarea: el código de las
+     *   tareas no consume tiempo virtual. Los eventos que vencen en el medio se atienden en su
+     *   instante exacto y pueden expropiar a la tarea, que completa el resto del trabajo cuando
+     *   vuelve a correr. En sección crítica el tiempo avanza pero lo que vence queda pendiente.
+     *
+	 *  @param 		ns		Tiempo de CPU.
+	 *  @return     None.
+***************************************************************************************************/
+void os_VirtualTrabajar(uint64_t ns)  {
+	uint64_t paso;
+
+	do  {
+		pausarSiLimite();
+		paso=((proximoEvento()<limiteNs) ? proximoEvento() : limiteNs)-ahoraNs;
+		if(paso>ns)
+			paso=ns;
+		ahoraNs+=paso;
+		ns-=paso;
+		marcarVencidos();
+		atenderPendientes();
+	} while(ns!=0);
+}
+
+/*************************************************************************************************
+	 *  @brief Agrega una interrupción a la lista de eventos.
+     *
+     *  @details
+     *   Se puede llamar desde la aplicación o desde las tareas. Un instante que ya pasó se toma
+     *   como el actual. Interrupciones en el mismo instante se atienden de la de menor número
+     *   a la de mayor.
+     *
+	 *  @param 		tiempoNs	Instante de la interrupción.
+	 *  @param 		irq			Interrupción simulada.
+	 *  @return     false si irq no es válida o la lista está llena.
+***************************************************************************************************/
+bool os_VirtualProgramarIRQ(uint64_t tiempoNs, uint32_t irq)  {
+	uint32_t c;
+
+	if(irq>=OS_PORT_CANT_IRQ)
+		return false;
+
+	// Se descartan los eventos ya atendidos del principio de la lista
+	if(cantEventos==OS_VIRTUAL_MAX_EVENTOS && primerEvento!=0)  {
+		for(c=primerEvento;c<cantEventos;c++)
+			eventos[c-primerEvento]=eventos[c];
+		cantEventos-=primerEvento;
+		primerEvento=0;
+	}
+	if(cantEventos==OS_VIRTUAL_MAX_EVENTOS)
+		return false;
+
+	if(tiempoNs<ahoraNs)
+		tiempoNs=ahoraNs;
+
+	// Inserción ordenada, después de los eventos del mismo instante
+	for(c=cantEventos;c>primerEvento && eventos[c-1].tiempoNs>tiempoNs;c--)
+		eventos[c]=eventos[c-1];
+	eventos[c].tiempoNs=tiempoNs;
+	eventos[c].irq=irq;
+	cantEventos++;
+
+	return true;
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve el registro de cambios de contexto.
+     *
+     *  @details
+     *   Se guardan los primeros OS_VIRTUAL_MAX_DECISIONES cambios desde el arranque o desde
+     *   os_VirtualBorrarDecisiones(); el total sigue contando.
+     *
+	 *  @param 		registro	Donde se deja el comienzo del registro.
+	 *  @return     Cantidad total de cambios de contexto.
+***************************************************************************************************/
+uint32_t os_VirtualDecisiones(const decisionVirtual **registro)  {
+	*registro=decisiones;
+	return cantDecisiones;
+}
+
+/*************************************************************************************************
+	 *  @brief Vacía el registro de cambios de contexto.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_VirtualBorrarDecisiones(void)  {
+	cantDecisiones=0;
+}
+
+/*================[Funciones internas del port]==========================*/
+
+/*************************************************************************************************
+	 *  @brief Hace el cambio de contexto pendiente.
+     *
+     *  @details
+     *   Equivale a PendSV_Handler, igual que en el port POSIX, y además registra el cambio.
+     *   Se llama en sección crítica, fuera del modo handler.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void cambiarContexto(void)  {
+	tarea *actual;
+	ucontext_t *saliente, *entrante;
+#ifdef OS_PORT_ASAN
+	void *pilaFalsa=NULL;
+#endif
+
+	while(cambioPendiente)  {
+		cambioPendiente=false;
+
+		actual=os_getTareaActual();
+		saliente=(actual!=NULL) ? (ucontext_t*)actual->stack_pointer : NULL;
+		entrante=(ucontext_t*)getContextoSiguiente((uintptr_t)saliente);
+		if(entrante==saliente)
+			continue;
+		registrarDecision(actual);
+
+#ifdef OS_PORT_ASAN
+		__sanitizer_start_switch_fiber((saliente!=NULL) ? &pilaFalsa : NULL,
+				entrante->uc_stack.ss_sp, entrante->uc_stack.ss_size);
+#endif
+		if(saliente==NULL)
+			setcontext(entrante);
+		swapcontext(saliente, entrante);
+#ifdef OS_PORT_ASAN
+		__sanitizer_finish_switch_fiber(pilaFalsa, NULL, NULL);
+#endif
+	}
+}
+
+/*************************************************************************************************
+	 *  @brief Guarda un cambio de contexto en el registro.
+     *
+	 *  @param 		saliente	Tarea que deja la CPU (NULL en el arranque).
+	 *  @return     None.
+***************************************************************************************************/
+static void registrarDecision(tarea *saliente)  {
+	decisionVirtual *decision;
+
+	if(cantDecisiones<OS_VIRTUAL_MAX_DECISIONES)  {
+		decision=&decisiones[cantDecisiones];
+		decision->tiempoNs=ahoraNs;
+		decision->saliente=(saliente!=NULL) ? saliente->id : OS_VIRTUAL_SIN_TAREA;
+		decision->entrante=os_getTareaActual()->id;
+	}
+	if(cantDecisiones<UINT32_MAX)
+		cantDecisiones++;
+}
+
+/*************************************************************************************************
+	 *  @brief Punto de entrada de contextoArranque.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void arranqueOS(void)  {
+#ifdef OS_PORT_ASAN
+	__sanitizer_finish_switch_fiber(NULL, &aplicacionInferior, &aplicacionTamanio);
+#endif
+
+	os_Init();
+}
+
+/*************************************************************************************************
+	 *  @brief Punto de entrada de todas las tareas.
+     *
+     *  @details
+     *   La tarea arranca fuera de sección crítica, como con el EXC_RETURN inicial en el Cortex.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void arranqueTarea(void)  {
+	void (*tareaUsuario)(void);
+
+#ifdef OS_PORT_ASAN
+	__sanitizer_finish_switch_fiber(NULL, NULL, NULL);
+#endif
+
+	bloqueadas=false;
+	atenderPendientes();
+
+	tareaUsuario=(void (*)(void))os_getTareaActual()->entry_point;
+	tareaUsuario();
+	retornoTarea();
+
+	while(1)
+		os_PortEsperarIrq();
+}
+
+/*************************************************************************************************
+	 *  @brief Atiende las interrupciones y el tick pendientes.
+     *
+     *  @details
+     *   Solo desde una tarea fuera de sección crítica y fuera del modo handler. Primero las
+     *   interrupciones y después el tick; cada atención puede cambiar de contexto y la tarea
+     *   sigue con lo que quede pendiente cuando vuelve a correr.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void atenderPendientes(void)  {
+	while(!bloqueadas && !enHandler && !enAplicacion && (irqPendientes!=0 || tickPendiente))  {
+		bloqueadas=true;
+		enHandler=true;
+		if(irqPendientes!=0)
+			atenderIRQ();
+		else  {
+			tickPendiente=false;
+			SysTick_Handler();
+		}
+		atenderIRQAntesDePendSV();
+		enHandler=false;
+		cambiarContexto();
+		bloqueadas=false;
+	}
+}
+
+/*************************************************************************************************
+	 *  @brief Atiende todas las interrupciones pendientes.
+     *
+     *  @details
+     *   Como el manejador de interrupciones del port POSIX: de la de menor número a la de
+     *   mayor, y un único scheduling al final si alguna lo pidió (os_setFlagISR()).
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void atenderIRQ(void)  {
+	uint32_t pendientes;
+
+	while((pendientes=irqPendientes)!=0)  {
+		irqPendientes=0;
+		while(pendientes!=0)  {
+			despacharIRQ((uint32_t)__builtin_ctz(pendientes));
+			pendientes&=pendientes-1;
+		}
+	}
+
+	if(os_getFlagISR())  {
+		os_setFlagISR(false);
+		os_Yield();
+	}
+}
+
+/*************************************************************************************************
+	 *  @brief Atiende las interrupciones que quedaron pendientes durante un handler.
+     *
+     *  @details
+     *   Se llama al terminar el handler, antes de cambiarContexto(): en el Cortex PendSV tiene
+     *   la menor prioridad y estas interrupciones se ejecutan entre la elección del scheduler y
+     *   el cambio de contexto.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void atenderIRQAntesDePendSV(void)  {
+	while(irqPendientes!=0)
+		atenderIRQ();
+}
+
+/*************************************************************************************************
+	 *  @brief Llama a la función de usuario de una interrupción.
+     *
+     *  @details
+     *   Igual que os_IRQHandler en el Cortex: marca el sistema en OS_IRQ_RUN, registra la
+     *   traza y suma los ciclos de la interrupción con os_SumarCiclosIRQ().
+     *
+	 *  @param 		irq
+	 *  @return     None.
+***************************************************************************************************/
+static void despacharIRQ(uint32_t irq)  {
+	estadoOS estadoPrevio_OS;
+	void (*funcion_usuario)(void);
+	uint32_t inicio;
+
+	funcion_usuario=isrUsuario[irq];
+	if(funcion_usuario==NULL)
+		return;
+
+	estadoPrevio_OS=os_getEstadoSistema();
+	os_setEstadoSistema(OS_IRQ_RUN);
+	inicio=os_getCiclos();
+	OS_TRAZA_EVENTO(TRAZA_IRQ_ENTRA, os_getTareaActual(), irq);
+
+	funcion_usuario();
+
+	OS_TRAZA_EVENTO(TRAZA_IRQ_SALE, os_getTareaActual(), irq);
+	os_SumarCiclosIRQ(os_getCiclos()-inicio);
+	os_setEstadoSistema(estadoPrevio_OS);
+}
+
+/*************************************************************************************************
+	 *  @brief Pone pendiente lo que venció hasta el instante actual.
+     *
+     *  @details
+     *   Varios ticks vencidos sin atender cuentan como uno, como en el SysTick.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void marcarVencidos(void)  {
+	while(primerEvento<cantEventos && eventos[primerEvento].tiempoNs<=ahoraNs)
+		irqPendientes|=1UL << eventos[primerEvento++].irq;
+
+	if(proximoTickNs<=ahoraNs)  {
+		tickPendiente=true;
+		while(proximoTickNs<=ahoraNs)
+			proximoTickNs+=periodoTickNs;
+	}
+}
+
+/*************************************************************************************************
+	 *  @brief Instante del próximo tick o interrupción programada.
+     *
+	 *  @param 		None.
+	 *  @return     Tiempo en ns.
+***************************************************************************************************/
+static uint64_t proximoEvento(void)  {
+	if(primerEvento<cantEventos && eventos[primerEvento].tiempoNs<proximoTickNs)
+		return eventos[primerEvento].tiempoNs;
+	return proximoTickNs;
+}
+
+/*************************************************************************************************
+	 *  @brief Instante de la próxima interrupción programada.
+     *
+	 *  @param 		None.
+	 *  @return     Tiempo en ns, o UINT64_MAX si no hay ninguna.
+***************************************************************************************************/
+static uint64_t proximaIRQ(void)  {
+	return (primerEvento<cantEventos) ? eventos[primerEvento].tiempoNs : UINT64_MAX;
+}
+
+/*************************************************************************************************
+	 *  @brief Si el reloj llegó al final del tramo vuelve a la aplicación.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void pausarSiLimite(void)  {
+	while(ahoraNs>=limiteNs)
+		pausar();
+}
+
+/*************************************************************************************************
+	 *  @brief Deja la tarea actual en pausa y vuelve a os_VirtualCorrer().
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void pausar(void)  {
+#ifdef OS_PORT_ASAN
+	void *pilaFalsa=NULL;
+	ucontext_t *contexto=(ucontext_t*)os_getTareaActual()->stack_pointer;
+
+	pausaInferior=contexto->uc_stack.ss_sp;
+	pausaTamanio=contexto->uc_stack.ss_size;
+	__sanitizer_start_switch_fiber(&pilaFalsa, aplicacionInferior, aplicacionTamanio);
+#endif
+	swapcontext(&contextoPausa, &contextoAplicacion);
+#ifdef OS_PORT_ASAN
+	__sanitizer_finish_switch_fiber(pilaFalsa, NULL, NULL);
+#endif
+}
@@ -0,0 +1,123 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_PortVirtual.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Este módulo declara el port del S.O. con tiempo virtual, para probar el
+ * scheduler en una PC en forma determinista. Las tareas son contextos de
+ * ucontext en un único hilo, como en el port POSIX, pero no hay señales ni
+ * reloj real:
+ *  - El tiempo solo avanza cuando una tarea declara que trabaja
+ *    (os_VirtualTrabajar()) o cuando todas duermen, en cuyo caso salta al
+ *    próximo evento.
+ *  - El tick y las interrupciones salen del reloj virtual y de una lista de
+ *    eventos programada (os_VirtualProgramarIRQ()).
+ *  - Cada cambio de contexto queda registrado con su instante, para comparar
+ *    la secuencia exacta de tareas.
+ * La aplicación corre el S.O. de a tramos con os_VirtualCorrer() y entre
+ * tramos revisa el registro y el estado de las tareas. Con el tick
+ * suprimido en la idle, horas de tiempo simulado corren en milisegundos.
+ * Los "ciclos" del port son nanosegundos (SystemCoreClock vale 1 GHz).
+ *
+ *===========================================================================*/
+
+#ifndef MSE_OS_PORT_VIRTUAL_MSE_OS_PORTVIRTUAL_H_
+#define MSE_OS_PORT_VIRTUAL_MSE_OS_PORTVIRTUAL_H_
+
+
+#include <stdint.h>
+#include <stdbool.h>
+
+
+/********************************************************************************
+ * Definicion de las constantes
+ *******************************************************************************/
+// Los stacks alojan el ucontext_t, como en el port POSIX (más aún con ASan)
+#ifndef STACK_SIZE
+#define STACK_SIZE					65536
+#endif
+#ifndef STACK_SIZE_IDLE
+#define STACK_SIZE_IDLE				65536
+#endif
+#define OS_PORT_STACK_MIN			16384
+
+#ifndef OS_PORT_TICK_US
+#define OS_PORT_TICK_US				1000		// Período del tick en us
+#endif
+
+#define OS_PORT_CANT_IRQ			32			// Interrupciones simuladas (0 a 31)
+
+#ifndef OS_VIRTUAL_MAX_EVENTOS
+#define OS_VIRTUAL_MAX_EVENTOS		256			// Interrupciones programadas sin atender
+#endif
+#ifndef OS_VIRTUAL_MAX_DECISIONES
+#define OS_VIRTUAL_MAX_DECISIONES	4096		// Cambios de contexto que se guardan
+#endif
+
+#define OS_VIRTUAL_SIN_TAREA		0xFF		// Tarea saliente del primer cambio de contexto
+
+
+/********************************************************************************
+ * Intrínsecos del Cortex que usa el kernel
+ *******************************************************************************/
+static inline uint32_t __CLZ(uint32_t valor)  {
+	return (valor!=0) ? (uint32_t)__builtin_clz(valor) : 32;
+}
+
+static inline uint32_t __RBIT(uint32_t valor)  {
+	uint32_t invertido=0;
+
+	for(uint8_t c=0;c<32;c++)  {
+		invertido=(invertido << 1) | (valor & 1);
+		valor >>= 1;
+	}
+	return invertido;
+}
+
+#define __DMB()		__atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define __DSB()		__atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define __ISB()		__atomic_signal_fence(__ATOMIC_SEQ_CST)
+#define __NOP()		((void)0)
+
+
+/********************************************************************************
+ * Definicion de los tipos de datos
+ *******************************************************************************/
+// Un cambio de contexto: en tiempoNs la CPU pasó de la tarea saliente a la entrante (ids)
+typedef struct  {
+	uint64_t tiempoNs;
+	uint8_t saliente;				// id de la tarea u OS_VIRTUAL_SIN_TAREA
+	uint8_t entrante;
+} decisionVirtual;
+
+
+/********************************************************************************
+ * Definicion de las variables externas
+ *******************************************************************************/
+extern uint32_t SystemCoreClock;				// 1 GHz: un ciclo es un nanosegundo
+
+
+/*=============[Definición de prototipos para las Tareas]=======================*/
+// Interrupciones simuladas: se atienden con las mismas reglas que os_IRQHandler
+bool os_InstalarIRQ(uint32_t irq, void* usr_isr);
+bool os_RemoverIRQ(uint32_t irq);
+// Pone pendiente una interrupción simulada en el instante actual
+void os_PortDispararIRQ(uint32_t irq);
+
+// Corre el S.O. (la primera vez lo arranca con os_Init()) durante ns de tiempo virtual
+void os_VirtualCorrer(uint64_t ns);
+// Termina el tramo en curso de os_VirtualCorrer() (desde una tarea)
+void os_VirtualDetener(void);
+// La tarea actual usa la CPU durante ns de tiempo virtual; puede ser expropiada en el medio
+void os_VirtualTrabajar(uint64_t ns);
+// Agrega a la lista de eventos la interrupción irq en el instante tiempoNs
+bool os_VirtualProgramarIRQ(uint64_t tiempoNs, uint32_t irq);
+// Registro de cambios de contexto: devuelve el total y en registro los primeros guardados
+uint32_t os_VirtualDecisiones(const decisionVirtual **registro);
+void os_VirtualBorrarDecisiones(void);
+
+
+#endif /* MSE_OS_PORT_VIRTUAL_MSE_OS_PORTVIRTUAL_H_ */
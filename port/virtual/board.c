@@ -0,0 +1,132 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: board.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * TIMER0 del LPC4337 sobre el reloj virtual, para MSE_OS_TimerUs.c (ver
+ * board.h). Solo se simula lo que usa el S.O.: el contador libre a 1 MHz y
+ * la interrupción por match sin reset ni stop.
+ *
+ *===========================================================================*/
+
+#include "board.h"
+#include "MSE_OS_Core.h"
+
+
+/*==================[Definición de variables globales]=================================*/
+
+LPC_TIMER_T timerVirtual0;
+
+
+/*************************************************************************************************
+	 *  @brief Microsegundos del reloj virtual.
+     *
+	 *  @param 		None.
+	 *  @return     Los us transcurridos, truncados a 32 bits.
+***************************************************************************************************/
+static uint32_t ahoraUs(void)  {
+	return (uint32_t)(os_getTiempoNs()/1000);
+}
+
+/*************************************************************************************************
+	 *  @brief Frecuencia de un reloj del LPC4337.
+     *
+	 *  @param 		clk		No se usa: todos los relojes van a 204 MHz.
+	 *  @return     204000000.
+***************************************************************************************************/
+uint32_t Chip_Clock_GetRate(uint32_t clk)  {
+	(void)clk;
+	return 204000000;
+}
+
+/*************************************************************************************************
+	 *  @brief Configuración del timer que no hace falta simular.
+     *
+     *  @details
+     *   El contador siempre está habilitado, cuenta a 1 MHz y el match siempre interrumpe.
+***************************************************************************************************/
+void Chip_TIMER_Init(LPC_TIMER_T *timer)  {
+	(void)timer;
+}
+
+void Chip_TIMER_PrescaleSet(LPC_TIMER_T *timer, uint32_t prescaler)  {
+	(void)timer;
+	(void)prescaler;
+}
+
+void Chip_TIMER_MatchEnableInt(LPC_TIMER_T *timer, int8_t match)  {
+	(void)timer;
+	(void)match;
+}
+
+void Chip_TIMER_ClearMatch(LPC_TIMER_T *timer, int8_t match)  {
+	(void)timer;
+	(void)match;
+}
+
+void Chip_TIMER_Enable(LPC_TIMER_T *timer)  {
+	(void)timer;
+}
+
+/*************************************************************************************************
+	 *  @brief Pone el contador en cero.
+     *
+	 *  @param 		timer
+	 *  @return     None.
+***************************************************************************************************/
+void Chip_TIMER_Reset(LPC_TIMER_T *timer)  {
+	timer->desfasajeUs=-ahoraUs();
+}
+
+/*************************************************************************************************
+	 *  @brief Valor del contador.
+     *
+	 *  @param 		timer
+	 *  @return     El contador libre en us.
+***************************************************************************************************/
+uint32_t Chip_TIMER_ReadCount(LPC_TIMER_T *timer)  {
+	return ahoraUs()+timer->desfasajeUs;
+}
+
+/*************************************************************************************************
+	 *  @brief Carga un registro de match.
+     *
+     *  @details
+     *   Programa TIMER0_IRQn para el instante en que el contador pasa a valer el valor cargado.
+     *   Si ya vale eso, como el match solo interrumpe al cambiar el contador, la interrupción
+     *   llega en la vuelta siguiente. Con demoraMatchUs el contador avanza esa cantidad una vez,
+     *   antes de que el match tome el valor, como si la escritura hubiera tardado.
+     *
+	 *  @param 		timer, match, valor
+	 *  @return     None.
+***************************************************************************************************/
+void Chip_TIMER_SetMatch(LPC_TIMER_T *timer, int8_t match, uint32_t valor)  {
+	uint64_t faltanUs, tiempoNs;
+
+	timer->desfasajeUs+=timer->demoraMatchUs;
+	timer->demoraMatchUs=0;
+
+	timer->MR[match]=valor;
+	faltanUs=(uint32_t)(valor-Chip_TIMER_ReadCount(timer));
+	if(faltanUs==0)
+		faltanUs=1ULL << 32;
+	tiempoNs=(os_getTiempoNs()/1000 + faltanUs)*1000;
+
+	// Un match reprogramado al mismo valor no agrega otra interrupción
+	if(tiempoNs!=timer->eventoNs)  {
+		os_VirtualProgramarIRQ(tiempoNs, TIMER0_IRQn);
+		timer->eventoNs=tiempoNs;
+	}
+}
+
+/*************************************************************************************************
+	 *  @brief Pone pendiente una interrupción.
+     *
+	 *  @param 		irq
+	 *  @return     None.
+***************************************************************************************************/
+void NVIC_SetPendingIRQ(uint32_t irq)  {
+	os_PortDispararIRQ(irq);
+}
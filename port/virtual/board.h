@@ -0,0 +1,66 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: board.h
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ *
+ * Este módulo reemplaza, en el port con tiempo virtual, las funciones de la
+ * LPCOpen que usa MSE_OS_TimerUs.c. TIMER0 es un contador libre de 32 bits
+ * que sale del reloj virtual (cuenta los us desde Chip_TIMER_Reset()) y el
+ * match genera la interrupción TIMER0_IRQn en el instante en que el contador
+ * llega al valor cargado, como en el LPC4337.
+ * Para las pruebas se puede desfasar el contador (para que dé la vuelta) y
+ * simular que el contador avanza mientras se programa el match.
+ *
+ *===========================================================================*/
+
+#ifndef MSE_OS_PORT_VIRTUAL_BOARD_H_
+#define MSE_OS_PORT_VIRTUAL_BOARD_H_
+
+
+#include <stdint.h>
+
+
+/********************************************************************************
+ * Definicion de las constantes
+ *******************************************************************************/
+#define TIMER0_IRQn				12				// Mismo número que en el LPC4337
+#define CLK_MX_TIMER0			0
+#define OS_VIRTUAL_CANT_MATCH	4
+
+#define LPC_TIMER0				(&timerVirtual0)
+
+
+/********************************************************************************
+ * Definicion de los tipos de datos
+ *******************************************************************************/
+typedef struct  {
+	uint32_t desfasajeUs;			// El contador vale los us del reloj virtual más este valor
+	uint32_t demoraMatchUs;			// Lo que avanza el contador al programar el próximo match
+	uint32_t MR[OS_VIRTUAL_CANT_MATCH];
+	uint64_t eventoNs;				// Última interrupción programada en la lista de eventos
+} LPC_TIMER_T;
+
+
+/********************************************************************************
+ * Definicion de las variables externas
+ *******************************************************************************/
+extern LPC_TIMER_T timerVirtual0;
+
+
+/*=============[Definición de prototipos para las Tareas]=======================*/
+uint32_t Chip_Clock_GetRate(uint32_t clk);
+void Chip_TIMER_Init(LPC_TIMER_T *timer);
+void Chip_TIMER_Reset(LPC_TIMER_T *timer);
+void Chip_TIMER_PrescaleSet(LPC_TIMER_T *timer, uint32_t prescaler);
+void Chip_TIMER_MatchEnableInt(LPC_TIMER_T *timer, int8_t match);
+void Chip_TIMER_ClearMatch(LPC_TIMER_T *timer, int8_t match);
+void Chip_TIMER_Enable(LPC_TIMER_T *timer);
+void Chip_TIMER_SetMatch(LPC_TIMER_T *timer, int8_t match, uint32_t valor);
+uint32_t Chip_TIMER_ReadCount(LPC_TIMER_T *timer);
+void NVIC_SetPendingIRQ(uint32_t irq);
+
+
+#endif /* MSE_OS_PORT_VIRTUAL_BOARD_H_ */
@@ -0,0 +1,34 @@
+#!/usr/bin/env python3
+# =============================================================================
+# Author: Pablo Daniel Folino  <pfolino@gmail.com>
+# Date: 2021/08/14
+# Archivo: linea_traza.py
+# Version: 1
+# =============================================================================
+# Descripción:
+#  Decodifica un volcado de os_traza con tools/traza_a_json.py y escribe en una
+#  línea los tramos de ejecución de cada tarea como "tarea:inicio+duracion"
+#  (en us, ordenados por inicio), para que el escenario traza del port virtual
+#  compare la línea de tiempo que generaría el JSON.
+#      python3 linea_traza.py traza.bin
+# =============================================================================
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "tools"))
+import traza_a_json  # noqa: E402
+
+
+def main():
+    with open(sys.argv[1], "rb") as archivo:
+        frecuencia, registros = traza_a_json.leer_registros(archivo.read())
+
+    eventos = traza_a_json.generar_eventos(traza_a_json.a_microsegundos(registros, frecuencia), {})
+    tramos = sorted((e["ts"], e["tid"], e["dur"]) for e in eventos
+                    if e["ph"] == "X" and e["tid"] != traza_a_json.TID_IRQ)
+    print(" ".join("%d:%d+%d" % (tid, round(ts), round(dur)) for ts, tid, dur in tramos))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,763 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: main.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * Escenarios del scheduler con tiempo virtual (port virtual). Cada escenario
+ * corre en un proceso propio, porque el S.O. no se puede reiniciar, y
+ * compara la secuencia exacta de cambios de contexto con la esperada:
+ *  - round_robin: dos tareas de igual prioridad que nunca se bloquean se
+ *    turnan en cada tick, también a lo largo de dos tramos.
+ *  - timeout: una interrupción programada a mitad de un tick libera un
+ *    semáforo y expropia a la tarea de fondo en ese instante; la segunda
+ *    espera vence por timeout en el tick exacto.
+ *  - horas: una tarea periódica durante dos horas de tiempo simulado, con el
+ *    tick suprimido en la idle.
+ *  - timer_us: cuatro tareas con retardos en us desordenados y dos de igual
+ *    vencimiento, con el contador de us dando la vuelta en el medio; se
+ *    despiertan en orden de vencimiento y las iguales en orden FIFO. Después
+ *    el contador pasa el vencimiento mientras se programa el match, y la
+ *    tarea se despierta en el momento en lugar de esperar la vuelta.
+ *  - irq_en_scheduling: una interrupción entre la elección del scheduler del
+ *    tick y el cambio de contexto despierta una tarea más prioritaria, que
+ *    debe correr en ese mismo instante y no en el tick siguiente.
+ *  - give_igual_prioridad: liberar un semáforo que espera una tarea de igual
+ *    prioridad no cede la CPU; la despertada corre en el próximo tick.
+ *  - temporizador_cascade: un temporizador que vence justo en una vuelta del
+ *    nivel 0 de la rueda (tick múltiplo de 32) se atiende en ese tick.
+ *  - temporizador_lejano: un temporizador que vence en el nivel 2 de la rueda;
+ *    la tarea de temporizadores solo se despierta en los dos cascades y en el
+ *    vencimiento, no en cada vuelta del nivel 0.
+ *  - inversion_prioridad: una tarea baja toma un mutex, una alta lo pide y
+ *    una media quiere la CPU; la alta espera solo lo que le falta a la baja
+ *    para liberar el mutex, no lo que trabaja la media.
+ *  - deriva_tickless: una tarea que duerme de a 1 s con el tick suprimido y
+ *    interrupciones a destiempo que despiertan antes la idle; el reloj del
+ *    sistema no debe derivar respecto del tiempo.
+ *  - pool: bloques de 4 bytes en una PC de 64 bits; cada bloque libre guarda
+ *    un puntero, por lo que el bloque real ocupa un puntero completo.
+ *  - traza: dos tareas en round robin que empiezan justo antes de que el
+ *    contador de ciclos de 32 bits dé la vuelta, con una traza de 64
+ *    registros que también da la vuelta; el volcado se decodifica con
+ *    tools/traza_a_json.py (linea_traza.py) y se compara la línea de tiempo
+ *    de cada tarea.
+ *  - carga_cpu: una tarea que trabaja 250 us por tick e interrupciones que
+ *    trabajan 250 us cada 25 ms, durante una ventana de la carga de CPU de
+ *    5 s (más de 2^32 ns); se comparan la carga y los contadores de uso.
+ *  - cola_memoria: una cola sobre memoria de la aplicación más grande que
+ *    LONG_COLA; entran todos sus elementos y salen en orden. Una memoria más
+ *    chica que un elemento, o elementos de 0 bytes, dan ERR_OS_COLA_MEMORIA.
+ *  - svc_irq_off: una tarea que llama al kernel con irqOff() recibe
+ *    ERR_OS_SVC_IRQ_OFF y sigue, en lugar de escalar a HardFault como en el
+ *    Cortex.
+ * La secuencia se escribe como "instante_us:SE", con S la tarea saliente y E
+ * la entrante ('A' la de id 0, 'i' la idle y '-' ninguna).
+ *
+ *===========================================================================*/
+
+/*==================[inclusions]=============================================*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "MSE_OS_Core.h"
+#include "MSE_API.h"
+#include "MSE_OS_Temporizador.h"
+#include "MSE_OS_Pool.h"
+#include "MSE_OS_Traza.h"
+#include "MSE_OS_TimerUs.h"
+
+/*==================[Macros and definitions]=================================*/
+
+#define US					1000ULL					// ns
+#define MS					1000000ULL
+#define HORA				(3600ULL*1000*MS)
+
+#define IRQ_SEMAFORO		0
+#define TICK_IRQ			3						// Tick en el que tickHook dispara la IRQ
+#define SECCION_CRITICA		(3*MS)					// Tarea baja con el mutex tomado
+#define TRABAJO_MEDIA		(10*MS)
+
+#define US_HASTA_VUELTA		150						// Lo que le falta al contador de us
+#define DEMORA_MATCH		80						// us que avanza el contador al programar
+#define RETARDO_DEMORADO	50
+
+#define IRQ_DERIVA			1
+#define DERIVA_VUELTAS		10						// Esperas de 1 s
+#define DERIVA_IRQS			72						// Una cada 137,421 ms
+#define POOL_TAM			4						// Menor que un puntero en 64 bits
+#define POOL_CANT			8
+#define TRAZA_INICIO		4290					// ms; los ns en 32 bits dan la vuelta en 4294,967 ms
+#define IRQ_CARGA			2
+#define TRABAJO_CARGA		(250*US)				// Por tick en la tarea y por interrupción
+#define PERIODO_IRQ_CARGA	(25*MS)
+#define IRQS_CARGA			(OS_CARGA_VENTANA_TICKS/25)
+#define COLA_CANT			(LONG_COLA/4 + 24)		// Más de lo que entra en el buffer propio
+
+/*==================[internal data definition]===============================*/
+
+static tarea estadoTareaA, estadoTareaB;
+
+static semaforo sem;
+static statusSemTake resultado[2];
+static uint64_t instante[2];
+static uint32_t vueltas;
+static bool irqEnTick;						// tickHook dispara IRQ_SEMAFORO en TICK_IRQ
+
+static tarea estadoTareaC, estadoTareaD;
+static const uint32_t retardoUs[]={300, 100, 300, 200};		// Por id de tarea
+static temporizador temp;
+static mutex mtx;
+static uint32_t irqsDeriva, irqsDesfasadas;
+static pool poolChico;
+static OS_POOL_MEMORIA(memoriaPool, POOL_TAM, POOL_CANT);
+static cola colaGrande;
+static uint32_t memoriaCola[COLA_CANT];
+
+static int32_t errorEsperado;				// errorHook cuenta este error en lugar de terminar
+static uint32_t erroresEsperados;
+static char secuencia[1024];
+
+/*==================[internal functions definition]==========================*/
+
+static char letra(uint8_t id)  {
+	if(id==OS_VIRTUAL_SIN_TAREA)
+		return '-';
+	if(id==os_getTareaIdle()->id)
+		return 'i';
+	return (char)('A'+id);
+}
+
+// Arma la secuencia de los cambios de contexto registrados en [desde, hasta)
+static const char* leerSecuencia(uint32_t desde, uint32_t hasta)  {
+	const decisionVirtual *registro;
+	uint32_t cantidad;
+	size_t largo=0;
+
+	cantidad=os_VirtualDecisiones(&registro);
+	if(cantidad>OS_VIRTUAL_MAX_DECISIONES)
+		cantidad=OS_VIRTUAL_MAX_DECISIONES;
+	if(cantidad>hasta)
+		cantidad=hasta;
+
+	secuencia[0]='\0';
+	for(uint32_t c=desde;c<cantidad && largo<sizeof(secuencia)-32;c++)
+		largo+=(size_t)snprintf(&secuencia[largo], sizeof(secuencia)-largo, "%s%llu:%c%c",
+				(c!=desde) ? " " : "", (unsigned long long)(registro[c].tiempoNs/US),
+				letra(registro[c].saliente), letra(registro[c].entrante));
+	return secuencia;
+}
+
+static bool comparar(const char *nombre, const char *obtenido, const char *esperado)  {
+	if(strcmp(obtenido, esperado)==0)
+		return true;
+
+	printf("  %s\n    esperado: %s\n    obtenido: %s\n", nombre, esperado, obtenido);
+	return false;
+}
+
+static bool compararNumero(const char *nombre, uint64_t obtenido, uint64_t esperado)  {
+	if(obtenido==esperado)
+		return true;
+
+	printf("  %s: esperado %llu, obtenido %llu\n", nombre, (unsigned long long)esperado,
+			(unsigned long long)obtenido);
+	return false;
+}
+
+static uint64_t ciclosTarea(tarea *task)  {
+	estadisticasTarea estadisticas;
+
+	os_getEstadisticasTarea(task, &estadisticas);
+	return estadisticas.ciclos;
+}
+
+/*------------------[round_robin]--------------------------------------------*/
+
+static void tareaGiro(void)  {
+	while(1)
+		os_VirtualTrabajar(2500*US);
+}
+
+static bool escenarioRoundRobin(void)  {
+	bool ok;
+
+	os_InitTarea(tareaGiro, &estadoTareaA, PRIORIDAD_1);
+	os_InitTarea(tareaGiro, &estadoTareaB, PRIORIDAD_1);
+
+	os_VirtualCorrer(5*MS);
+	ok=comparar("tramo 1", leerSecuencia(0, UINT32_MAX),
+			"0:-A 1000:AB 2000:BA 3000:AB 4000:BA 5000:AB");
+
+	os_VirtualCorrer(2*MS);
+	ok&=comparar("tramo 2", leerSecuencia(6, UINT32_MAX), "6000:BA 7000:AB");
+
+	ok&=compararNumero("CPU de A", ciclosTarea(&estadoTareaA), 4*MS);
+	ok&=compararNumero("CPU de B", ciclosTarea(&estadoTareaB), 3*MS);
+	return ok;
+}
+
+/*------------------[timeout]------------------------------------------------*/
+
+static void tareaEspera(void)  {
+	for(uint8_t c=0;c<2;c++)  {
+		resultado[c]=os_SemaforoTake(&sem, 3);
+		instante[c]=os_getTiempoNs();
+	}
+	os_VirtualDetener();
+
+	while(1)
+		tareaDelay(1000);
+}
+
+static void tareaFondo(void)  {
+	while(1)
+		os_VirtualTrabajar(10*MS);
+}
+
+static void isrSemaforo(void)  {
+	os_SemaforoGiveFromISR(&sem);
+}
+
+static bool escenarioTimeout(void)  {
+	bool ok;
+
+	os_SemaforoInit(&sem);
+	os_InitTarea(tareaEspera, &estadoTareaA, PRIORIDAD_0);
+	os_InitTarea(tareaFondo, &estadoTareaB, PRIORIDAD_2);
+	os_InstalarIRQ(IRQ_SEMAFORO, isrSemaforo);
+	os_VirtualProgramarIRQ(1500*US, IRQ_SEMAFORO);
+
+	os_VirtualCorrer(1*HORA);
+	ok=comparar("secuencia", leerSecuencia(0, UINT32_MAX),
+			"0:-A 0:AB 1500:BA 1500:AB 4000:BA");
+	ok&=compararNumero("primer Take", resultado[0], pdTrue);
+	ok&=compararNumero("instante del primer Take", instante[0], 1500*US);
+	ok&=compararNumero("segundo Take", resultado[1], pdFalse);
+	ok&=compararNumero("instante del timeout", instante[1], 4*MS);
+	return ok;
+}
+
+/*------------------[horas]--------------------------------------------------*/
+
+static void tareaPeriodica(void)  {
+	while(1)  {
+		os_VirtualTrabajar(50*US);
+		vueltas++;
+		tareaDelay(100);
+	}
+}
+
+static bool escenarioHoras(void)  {
+	struct timespec inicio, fin;
+	const decisionVirtual *registro;
+	uint32_t decisiones;
+	bool ok;
+
+	os_InitTarea(tareaPeriodica, &estadoTareaA, PRIORIDAD_1);
+
+	clock_gettime(CLOCK_MONOTONIC, &inicio);
+	os_VirtualCorrer(2*HORA);
+	clock_gettime(CLOCK_MONOTONIC, &fin);
+
+	decisiones=os_VirtualDecisiones(&registro);
+	printf("  2 h simuladas en %ld ms, %u cambios de contexto\n",
+			(long)((fin.tv_sec-inicio.tv_sec)*1000 + (fin.tv_nsec-inicio.tv_nsec)/1000000),
+			decisiones);
+
+	ok=comparar("primeros", leerSecuencia(0, 4), "0:-A 50:Ai 100000:iA 100050:Ai");
+	ok&=compararNumero("cambios de contexto", decisiones, 1+2*72000);
+	ok&=compararNumero("vueltas", vueltas, 72000);
+	ok&=compararNumero("ticks", os_getSytemTicks(), 7200000);
+	ok&=compararNumero("tiempo", os_getTiempoNs(), 2*HORA);
+	ok&=compararNumero("CPU de la tarea", ciclosTarea(&estadoTareaA), 72000*50*US);
+	return ok;
+}
+
+/*------------------[timer_us]-----------------------------------------------*/
+
+// Anota la tarea, el instante en us y cuántos us contó el timer durante el retardo
+static void anotarRetardo(uint32_t us)  {
+	uint32_t inicio=os_getTiempoUs();
+	size_t largo;
+
+	tareaDelayUs(us);
+	largo=strlen(secuencia);
+	snprintf(&secuencia[largo], sizeof(secuencia)-largo, "%s%c%llu/%u", (largo!=0) ? " " : "",
+			letra(os_getTareaActual()->id), (unsigned long long)(os_getTiempoNs()/US),
+			os_getTiempoUs()-inicio);
+}
+
+static void tareaRetardoUs(void)  {
+	anotarRetardo(retardoUs[os_getTareaActual()->id]);
+
+	// La última en despertar prueba el vencimiento que pasa mientras se programa el match
+	if(os_getTareaActual()==&estadoTareaC)  {
+		LPC_TIMER0->demoraMatchUs=DEMORA_MATCH;
+		anotarRetardo(RETARDO_DEMORADO);
+	}
+	while(1)
+		tareaDelay(1000);
+}
+
+static bool escenarioTimerUs(void)  {
+	os_TimerUsInit();
+	LPC_TIMER0->desfasajeUs=-US_HASTA_VUELTA;
+	os_InitTarea(tareaRetardoUs, &estadoTareaA, PRIORIDAD_1);
+	os_InitTarea(tareaRetardoUs, &estadoTareaB, PRIORIDAD_1);
+	os_InitTarea(tareaRetardoUs, &estadoTareaC, PRIORIDAD_1);
+	os_InitTarea(tareaRetardoUs, &estadoTareaD, PRIORIDAD_1);
+
+	secuencia[0]='\0';
+	os_VirtualCorrer(2*MS);
+	return comparar("despertares", secuencia, "B100/100 D200/200 A300/300 C300/300 C300/80");
+}
+
+/*------------------[irq_en_scheduling]--------------------------------------*/
+
+static void tareaDespertada(void)  {
+	os_SemaforoTake(&sem, portMax_DELAY);
+	instante[0]=os_getTiempoNs();
+	os_VirtualDetener();
+
+	while(1)
+		tareaDelay(1000);
+}
+
+static bool escenarioIrqEnScheduling(void)  {
+	bool ok;
+
+	os_SemaforoInit(&sem);
+	os_InitTarea(tareaDespertada, &estadoTareaA, PRIORIDAD_0);
+	os_InitTarea(tareaGiro, &estadoTareaB, PRIORIDAD_2);
+	os_InitTarea(tareaGiro, &estadoTareaC, PRIORIDAD_2);
+	os_InstalarIRQ(IRQ_SEMAFORO, isrSemaforo);
+	irqEnTick=true;
+
+	os_VirtualCorrer(1*HORA);
+	ok=comparar("secuencia", leerSecuencia(0, UINT32_MAX),
+			"0:-A 0:AB 1000:BC 2000:CB 3000:BA");
+	ok&=compararNumero("instante", instante[0], TICK_IRQ*MS);
+	return ok;
+}
+
+/*------------------[give_igual_prioridad]-----------------------------------*/
+
+static void tareaTomaSemaforo(void)  {
+	os_SemaforoTake(&sem, portMax_DELAY);
+	instante[0]=os_getTiempoNs();
+	os_VirtualDetener();
+
+	while(1)
+		tareaDelay(1000);
+}
+
+static void tareaDaSemaforo(void)  {
+	os_VirtualTrabajar(200*US);
+	os_SemaforoGive(&sem);
+	instante[1]=os_getTiempoNs();
+	while(1)
+		os_VirtualTrabajar(10*MS);
+}
+
+static bool escenarioGiveIgualPrioridad(void)  {
+	bool ok;
+
+	os_SemaforoInit(&sem);
+	os_InitTarea(tareaTomaSemaforo, &estadoTareaA, PRIORIDAD_1);
+	os_InitTarea(tareaDaSemaforo, &estadoTareaB, PRIORIDAD_1);
+
+	os_VirtualCorrer(1*HORA);
+	ok=comparar("secuencia", leerSecuencia(0, UINT32_MAX), "0:-A 0:AB 1000:BA");
+	ok&=compararNumero("Give sin ceder", instante[1], 200*US);
+	ok&=compararNumero("Take", instante[0], 1*MS);
+	return ok;
+}
+
+/*------------------[temporizador_cascade]-----------------------------------*/
+
+#define TICK_INICIO			5
+#define PERIODO_CASCADE		59						// Vence en el tick 64, una vuelta del nivel 0
+#define PERIODO_LEJANO		20000					// Vence en el tick 20005, en el nivel 2
+
+static void vencimientoTemp(void *argumento)  {
+	(void)argumento;
+	instante[1]=os_getSytemTicks();
+	os_VirtualDetener();
+}
+
+static void tareaTemp(void)  {
+	tareaDelay(TICK_INICIO);
+	instante[0]=os_getSytemTicks();
+	os_TemporizadorIniciar(&temp);
+
+	while(1)
+		tareaDelay(1000);
+}
+
+static bool escenarioTemporizadorCascade(void)  {
+	bool ok;
+
+	os_TemporizadorInit(PRIORIDAD_0);
+	os_TemporizadorCrear(&temp, vencimientoTemp, NULL, PERIODO_CASCADE, false);
+	os_InitTarea(tareaTemp, &estadoTareaA, PRIORIDAD_1);
+
+	os_VirtualCorrer(1*HORA);
+	ok=compararNumero("tick de inicio", instante[0], TICK_INICIO);
+	ok&=compararNumero("tick de vencimiento", instante[1], TICK_INICIO+PERIODO_CASCADE);
+	return ok;
+}
+
+/*------------------[temporizador_lejano]------------------------------------*/
+
+static bool escenarioTemporizadorLejano(void)  {
+	const decisionVirtual *registro;
+	uint32_t cantidad, despertares=0;
+	bool ok;
+
+	os_TemporizadorInit(PRIORIDAD_0);
+	os_TemporizadorCrear(&temp, vencimientoTemp, NULL, PERIODO_LEJANO, false);
+	os_InitTarea(tareaTemp, &estadoTareaA, PRIORIDAD_1);
+
+	os_VirtualCorrer(1*HORA);
+	ok=compararNumero("tick de vencimiento", instante[1], TICK_INICIO+PERIODO_LEJANO);
+
+	// La tarea de temporizadores es la primera creada: arranque, aviso de inicio, cascades
+	// en los ticks 19456 (nivel 2) y 20000 (nivel 1), y vencimiento
+	cantidad=os_VirtualDecisiones(&registro);
+	for(uint32_t c=0;c<cantidad && c<OS_VIRTUAL_MAX_DECISIONES;c++)
+		if(registro[c].entrante==0)
+			despertares++;
+	ok&=compararNumero("despertares de la tarea", despertares, 5);
+	return ok;
+}
+
+/*------------------[inversion_prioridad]------------------------------------*/
+
+static void tareaAlta(void)  {
+	tareaDelay(1);
+	resultado[0]=os_MutexTake(&mtx, portMax_DELAY);
+	instante[0]=os_getTiempoNs();
+	os_MutexGive(&mtx);
+	os_VirtualDetener();
+
+	while(1)
+		tareaDelay(1000);
+}
+
+static void tareaMedia(void)  {
+	tareaDelay(1);
+	while(1)
+		os_VirtualTrabajar(TRABAJO_MEDIA);
+}
+
+static void tareaBaja(void)  {
+	os_MutexTake(&mtx, portMax_DELAY);
+	os_VirtualTrabajar(SECCION_CRITICA);
+	os_MutexGive(&mtx);
+
+	while(1)
+		tareaDelay(1000);
+}
+
+static bool escenarioInversionPrioridad(void)  {
+	bool ok;
+
+	os_MutexInit(&mtx);
+	os_InitTarea(tareaAlta, &estadoTareaA, PRIORIDAD_0);
+	os_InitTarea(tareaMedia, &estadoTareaB, PRIORIDAD_1);
+	os_InitTarea(tareaBaja, &estadoTareaC, PRIORIDAD_2);
+
+	// En 1 ms la alta pide el mutex y la baja, con la prioridad heredada, termina antes que la media
+	os_VirtualCorrer(1*HORA);
+	ok=comparar("secuencia", leerSecuencia(0, UINT32_MAX),
+			"0:-A 0:AB 0:BC 1000:CA 1000:AC 3000:CA");
+	ok&=compararNumero("Take de la alta", resultado[0], pdTrue);
+	ok&=compararNumero("espera de la alta", instante[0], SECCION_CRITICA);
+	return ok;
+}
+
+/*------------------[deriva_tickless]----------------------------------------*/
+
+static void tareaDeriva(void)  {
+	for(uint32_t c=1;c<=DERIVA_VUELTAS;c++)  {
+		tareaDelay(1000);
+		if(os_getSytemTicks()!=c*1000 || os_getTiempoNs()!=c*1000*MS)
+			irqsDesfasadas++;
+	}
+	os_VirtualDetener();
+
+	while(1)
+		tareaDelay(1000);
+}
+
+// Despierta la idle en medio de un tick; los ticks ya contados deben coincidir con el tiempo
+static void isrDeriva(void)  {
+	irqsDeriva++;
+	if(os_getSytemTicks()!=os_getTiempoNs()/MS)
+		irqsDesfasadas++;
+}
+
+static bool escenarioDerivaTickless(void)  {
+	const decisionVirtual *registro;
+	bool ok;
+
+	os_InitTarea(tareaDeriva, &estadoTareaA, PRIORIDAD_1);
+	os_InstalarIRQ(IRQ_DERIVA, isrDeriva);
+	for(uint32_t c=1;c<=DERIVA_IRQS;c++)
+		os_VirtualProgramarIRQ(c*137*MS+c*421*US, IRQ_DERIVA);
+
+	os_VirtualCorrer(1*HORA);
+	ok=compararNumero("interrupciones", irqsDeriva, DERIVA_IRQS);
+	ok&=compararNumero("desfasajes", irqsDesfasadas, 0);
+	ok&=compararNumero("ticks", os_getSytemTicks(), DERIVA_VUELTAS*1000);
+	ok&=compararNumero("tiempo", os_getTiempoNs(), DERIVA_VUELTAS*1000*MS);
+	// Las interrupciones no despiertan tareas: solo cambia de contexto la tarea que duerme
+	ok&=compararNumero("cambios de contexto", os_VirtualDecisiones(&registro),
+			1+2*DERIVA_VUELTAS);
+	return ok;
+}
+
+/*------------------[pool]---------------------------------------------------*/
+
+static bool escenarioPool(void)  {
+	void *bloques[POOL_CANT];
+	bool ok=true;
+
+	os_PoolInit(&poolChico, memoriaPool, POOL_TAM, POOL_CANT);
+	ok&=compararNumero("tamaño del bloque", poolChico.tamBloque, sizeof(void*));
+
+	// Se llenan todos, para que un enlace pisado se note al volver a recorrer la lista
+	for(uint8_t c=0;c<POOL_CANT;c++)  {
+		bloques[c]=os_PoolAlloc(&poolChico);
+		ok&=compararNumero("alineación", (uintptr_t)bloques[c] % sizeof(void*), 0);
+		memset(bloques[c], 0xA5, POOL_TAM);
+	}
+	ok&=compararNumero("pool agotado", (uintptr_t)os_PoolAlloc(&poolChico), 0);
+
+	for(uint8_t c=0;c<POOL_CANT;c++)
+		os_PoolFree(&poolChico, bloques[c]);
+	ok&=compararNumero("libres", os_PoolLibres(&poolChico), POOL_CANT);
+
+	for(uint8_t c=0;c<POOL_CANT;c++)
+		ok&=compararNumero("bloque devuelto", (uintptr_t)os_PoolAlloc(&poolChico) != 0, 1);
+	return ok;
+}
+
+/*------------------[traza]--------------------------------------------------*/
+
+static void tareaTraza(void)  {
+	tareaDelay(TRAZA_INICIO);
+	while(1)
+		os_VirtualTrabajar(2500*US);
+}
+
+// Vuelca os_traza y devuelve la línea de tiempo que arma linea_traza.py con el decodificador
+static const char* decodificarTraza(void)  {
+	char volcado[]="/tmp/traza_virtual_XXXXXX", comando[256];
+	FILE *salida;
+	int archivo;
+
+	secuencia[0]='\0';
+	archivo=mkstemp(volcado);
+	if(archivo<0)
+		return secuencia;
+	if(write(archivo, &os_traza, sizeof(os_traza))==(ssize_t)sizeof(os_traza))  {
+		snprintf(comando, sizeof(comando), "python3 %s/linea_traza.py %s", DIR_PORT, volcado);
+		salida=popen(comando, "r");
+		if(salida!=NULL)  {
+			if(fgets(secuencia, sizeof(secuencia), salida)==NULL)
+				secuencia[0]='\0';
+			pclose(salida);
+		}
+	}
+	close(archivo);
+	unlink(volcado);
+
+	secuencia[strcspn(secuencia, "\n")]='\0';
+	return secuencia;
+}
+
+static bool escenarioTraza(void)  {
+	bool ok;
+
+	os_InitTarea(tareaTraza, &estadoTareaA, PRIORIDAD_1);
+	os_InitTarea(tareaTraza, &estadoTareaB, PRIORIDAD_1);
+
+	// Con 2 registros por tick (el tick y el cambio de contexto) quedan los últimos 32 ms,
+	// desde el tick 4283, y los tiempos son relativos al primero de ellos
+	os_VirtualCorrer((TRAZA_INICIO+34)*MS);
+	ok=compararNumero("la traza dio la vuelta", os_traza.indice>OS_TRAZA_CANT_REGISTROS, true);
+	ok&=comparar("línea de tiempo", decodificarTraza(),
+			"1:0+1000 0:1000+1000 1:2000+1000 0:3000+1000 1:4000+1000 0:5000+1000 1:6000+1000 "
+			"0:7000+1000 1:8000+1000 0:9000+1000 1:10000+1000 0:11000+1000 1:12000+1000 "
+			"0:13000+1000 1:14000+1000 0:15000+1000 1:16000+1000 0:17000+1000 1:18000+1000 "
+			"0:19000+1000 1:20000+1000 0:21000+1000 1:22000+1000 0:23000+1000 1:24000+1000 "
+			"0:25000+1000 1:26000+1000 0:27000+1000 1:28000+1000 0:29000+1000 1:30000+1000 "
+			"0:31000+0");
+	return ok;
+}
+
+/*------------------[carga_cpu]----------------------------------------------*/
+
+static void tareaCarga(void)  {
+	while(1)  {
+		os_VirtualTrabajar(TRABAJO_CARGA);
+		tareaDelay(1);
+	}
+}
+
+static void isrCarga(void)  {
+	os_VirtualTrabajar(TRABAJO_CARGA);
+}
+
+static bool escenarioCargaCPU(void)  {
+	estadisticasTarea estadisticas;
+	bool ok;
+
+	os_InitTarea(tareaCarga, &estadoTareaA, PRIORIDAD_1);
+	os_InstalarIRQ(IRQ_CARGA, isrCarga);
+	// A mitad de tick, cuando la tarea ya se bloqueó
+	for(uint32_t c=0;c<IRQS_CARGA;c++)
+		os_VirtualProgramarIRQ(c*PERIODO_IRQ_CARGA+500*US, IRQ_CARGA);
+
+	// Termina con la ventana cerrada en el tick 5000 y la tarea de nuevo bloqueada
+	os_VirtualCorrer(OS_CARGA_VENTANA_TICKS*MS+TRABAJO_CARGA);
+
+	// La idle corre 750 us por tick menos lo que usan las interrupciones: 74 %
+	ok=compararNumero("carga", os_getCargaCPU(), 26);
+	ok&=compararNumero("ciclos de las interrupciones", os_getCiclosIRQ(), IRQS_CARGA*TRABAJO_CARGA);
+
+	os_getEstadisticasTarea(&estadoTareaA, &estadisticas);
+	ok&=compararNumero("CPU de la tarea", estadisticas.ciclos, (OS_CARGA_VENTANA_TICKS+1)*TRABAJO_CARGA);
+	ok&=compararNumero("entradas de la tarea", estadisticas.cambiosContexto, OS_CARGA_VENTANA_TICKS+1);
+	ok&=compararNumero("expropiaciones de la tarea", estadisticas.expropiaciones, 0);
+
+	// La tarea expropia a la idle en cada tick
+	os_getEstadisticasTarea(os_getTareaIdle(), &estadisticas);
+	ok&=compararNumero("CPU de la idle", estadisticas.ciclos,
+			OS_CARGA_VENTANA_TICKS*(1*MS-TRABAJO_CARGA) - IRQS_CARGA*TRABAJO_CARGA);
+	ok&=compararNumero("entradas de la idle", estadisticas.cambiosContexto, OS_CARGA_VENTANA_TICKS+1);
+	ok&=compararNumero("expropiaciones de la idle", estadisticas.expropiaciones, OS_CARGA_VENTANA_TICKS);
+	return ok;
+}
+
+/*------------------[cola_memoria]-------------------------------------------*/
+
+static bool escenarioColaMemoria(void)  {
+	uint32_t valor;
+	bool ok=true;
+
+	os_ColaInitMemoria(&colaGrande, sizeof(uint32_t), memoriaCola, sizeof(memoriaCola));
+	ok&=compararNumero("elementos", colaGrande.cantElementosMax, COLA_CANT);
+
+	for(uint32_t c=0;c<COLA_CANT;c++)
+		ok&=compararNumero("push", os_ColaPushFromISR(&colaGrande, &c), pdTrue);
+	valor=COLA_CANT;
+	ok&=compararNumero("cola llena", os_ColaPushFromISR(&colaGrande, &valor), pdFalse);
+
+	for(uint32_t c=0;c<COLA_CANT;c++)  {
+		ok&=compararNumero("pop", os_ColaPopFromISR(&colaGrande, &valor), pdTrue);
+		ok&=compararNumero("orden", valor, c);
+	}
+	ok&=compararNumero("cola vacía", os_ColaPopFromISR(&colaGrande, &valor), pdFalse);
+
+	errorEsperado=ERR_OS_COLA_MEMORIA;
+	os_ColaInitMemoria(&colaGrande, sizeof(uint64_t), memoriaCola, sizeof(uint32_t));
+	os_ColaInitMemoria(&colaGrande, 0, memoriaCola, sizeof(memoriaCola));
+	ok&=compararNumero("memorias rechazadas", erroresEsperados, 2);
+	return ok;
+}
+
+/*------------------[svc_irq_off]--------------------------------------------*/
+
+static void tareaIrqOff(void)  {
+	irqOff();
+	tareaDelay(1);					// Informa el error y vuelve sin bloquear la tarea
+	irqOn();
+	instante[0]=os_getTiempoNs();
+	os_VirtualDetener();
+}
+
+static bool escenarioSvcIrqOff(void)  {
+	bool ok;
+
+	errorEsperado=ERR_OS_SVC_IRQ_OFF;
+	os_InitTarea(tareaIrqOff, &estadoTareaA, PRIORIDAD_1);
+
+	os_VirtualCorrer(5*MS);
+	ok=compararNumero("errores", erroresEsperados, 1);
+	ok&=compararNumero("instante", instante[0], 0);
+	return ok;
+}
+
+/*==================[external functions definition]==========================*/
+
+// Corre dentro de SysTick_Handler, después del scheduler y antes del cambio de contexto
+void tickHook(void)  {
+	if(irqEnTick && os_getSytemTicks()==TICK_IRQ)
+		os_PortDispararIRQ(IRQ_SEMAFORO);
+}
+
+void errorHook(void *caller)  {
+	(void)caller;
+	if(errorEsperado!=0 && os_getError()==errorEsperado)  {
+		erroresEsperados++;
+		return;
+	}
+	printf("  error del S.O. %d\n", os_getError());
+	exit(EXIT_FAILURE);
+}
+
+int main(void)  {
+	static const struct  {
+		const char *nombre;
+		bool (*escenario)(void);
+	} escenarios[]={
+		{"round_robin", escenarioRoundRobin},
+		{"timeout", escenarioTimeout},
+		{"horas", escenarioHoras},
+		{"timer_us", escenarioTimerUs},
+		{"irq_en_scheduling", escenarioIrqEnScheduling},
+		{"give_igual_prioridad", escenarioGiveIgualPrioridad},
+		{"temporizador_cascade", escenarioTemporizadorCascade},
+		{"temporizador_lejano", escenarioTemporizadorLejano},
+		{"inversion_prioridad", escenarioInversionPrioridad},
+		{"deriva_tickless", escenarioDerivaTickless},
+		{"pool", escenarioPool},
+		{"traza", escenarioTraza},
+		{"carga_cpu", escenarioCargaCPU},
+		{"cola_memoria", escenarioColaMemoria},
+		{"svc_irq_off", escenarioSvcIrqOff},
+	};
+	int estado, fallas=0;
+	pid_t hijo;
+
+	for(size_t c=0;c<sizeof(escenarios)/sizeof(escenarios[0]);c++)  {
+		printf("%s\n", escenarios[c].nombre);
+		fflush(stdout);
+
+		hijo=fork();
+		if(hijo==0)
+			exit(escenarios[c].escenario() ? EXIT_SUCCESS : EXIT_FAILURE);
+
+		waitpid(hijo, &estado, 0);
+		if(!WIFEXITED(estado) || WEXITSTATUS(estado)!=EXIT_SUCCESS)  {
+			printf("  FALLA\n");
+			fallas++;
+		}
+	}
+
+	if(fallas!=0)  {
+		printf("ERROR: %d escenarios fallaron\n", fallas);
+		return EXIT_FAILURE;
+	}
+	printf("OK\n");
+	return EXIT_SUCCESS;
+}
@@ -8,30 +8,116 @@
  * En este módulo se encuentran las funciones de manejo de semáforos binarios y de
  * colas.
  *
- * Semáforos: son semáforos binarios, se los debe declarar la estructura del semáforo
- * en el main.c, usanto el tipo de datos "semaforo". Se los debe inicializar usando la
- * función os_SemaforoInit(), y se los toma y libera usando las funciones os_SemaforoTake()
- * y os_SemaforoGive(). Coando se inicializa el semáforo se encuentra TOMADO.
+ * Semáforos: se los debe declarar la estructura del semáforo en el main.c, usanto el
+ * tipo de datos "semaforo". Se los debe inicializar usando la función os_SemaforoInit()
+ * (binario) u os_SemaforoInitContador() (contador), y se los toma y libera usando las
+ * funciones os_SemaforoTake() y os_SemaforoGive(). Coando se inicializa un semáforo binario
+ * se encuentra TOMADO. Un os_SemaforoGive() sin tareas esperando queda registrado en la
+ * cuenta del semáforo, hasta cuentaMax.
  * La función os_SemaforoTake() posee un parámetro de delayTicks)que especifica la
  * cantidad de ticks del sistema que espera para poder tomar el mismo. Esta funciún
  * devuelve pdFalse si no lo pudo tomar, o pdTrue en caso contrario.
+ * Varias tareas pueden esperar el mismo semáforo, cada una con su timeout. Se despierta
+ * primero la de mayor prioridad, y entre las de igual prioridad la que espera hace más.
  *
  * Colas : se las debe declarar en el main.c con el tipo de dato "cola". Es una cola
  * tipo FIFO de una longitud especificada por la constante LONG_COLA, definida en el
- * MSE_API.h. Siempre se extrae el primer elemento  de la cola(usando la función
- * os_ColaPop) es el que se encuentra en la posición cero. Si la cola se encuentra vacía
- * se bloquea la tarea hasta que aparezca un elemnto. Al extraer un elemento de la cola
- * se produce un shft de los datos de la misma  hacia el inicio de la cola y actualiza
- * la cantidad de elementos que posee.
- * Cada vez que se agrega un  elemento(usando la función os_ColaPush)se lo coloca en la
- * última posición, si la cola se encuentra se bloquea la tarea, hasta que se pueda
- *  agregar un nuevo dato.
- *  Esta cola está diseñada para que solamente una tarea ingrese datos en la misma,
- *  y otra única tarea comsuma datos.
+ * MSE_API.h, o sobre una memoria propia de la aplicación si se la inicializa con
+ * os_ColaInitMemoria(), lo que permite colas de distinto tamaño sin agrandar todas. Está
+ * implementada como un buffer circular: os_ColaPop extrae el elemento de la
+ * posición cabeza y os_ColaPush lo agrega en la posición fin, ambas en tiempo constante.
+ * Si la cola se encuentra vacía os_ColaPop bloquea la tarea hasta que aparezca un
+ * elemnto, y si se encuentra llena os_ColaPush la bloquea hasta que se pueda agregar un
+ * nuevo dato. os_ColaPushTimeout() y os_ColaPopTimeout() esperan como máximo delayTicks
+ * y devuelven pdFalse si no lo lograron.
+ * Cuando el tamaño del elemento es múltiplo de 4 y los datos están alineados se copian
+ * de a palabras.
+ * Para mensajes grandes la cola se puede usar sin copias: el productor pide un lugar con
+ * os_ColaPrestar(), lo llena y lo ingresa con os_ColaConfirmar(); el consumidor obtiene un
+ * puntero al primer dato con os_ColaRecibir() y lo saca con os_ColaDevolver() cuando
+ * termina de usarlo. Hay como máximo un préstamo por lado: mientras dure, el resto de los
+ * productores (o consumidores) esperan como si la cola estuviese llena (o vacía).
+ *  Varias tareas pueden ingresar y consumir datos de la misma cola. Las que esperan se
+ *  atienden por prioridad y, entre las de igual prioridad, por orden de llegada.
+ *
+ * Desde una interrupción se deben usar las variantes FromISR, que nunca esperan, no
+ * habilitan las interrupciones al terminar y solo piden un scheduling (con os_setFlagISR)
+ * si despiertan una tarea más prioritaria que la interrumpida. os_IRQHandler() hace ese
+ * scheduling una sola vez al salir de la interrupción.
+ *
+ * Notificaciones: cada tarea tiene una palabra de 32 bits de notificación. Con
+ * os_TareaNotificar() (u os_TareaNotificarFromISR()) se le agregan bits, y la tarea los
+ * espera y los borra con os_TareaNotificacionEsperar(). No hace falta declarar ningún
+ * objeto, por lo que es la forma más liviana de despertar una tarea desde una ISR.
+ *
+ * Grupos de eventos: son 32 bits de eventos que se ponen en 1 con os_EventosSet() (u
+ * os_EventosSetFromISR()). Con os_EventosEsperar() una tarea espera que se cumpla
+ * cualquiera de los bits de una máscara (OR) o todos (EVENTOS_ESPERAR_TODOS), y con
+ * EVENTOS_BORRAR_AL_SALIR los borra al cumplirse. Un solo os_EventosSet() puede despertar
+ * a todas las tareas cuya condición se cumple.
+ *
+ * Mutex: a diferencia del semáforo tienen una tarea propietaria, que es la única que lo
+ * puede liberar. Se inicializan libres con os_MutexInit(), y se toman y liberan con
+ * os_MutexTake() y os_MutexGive(). El propietario puede volver a tomarlo (recursivo), y
+ * queda libre cuando lo liberó tantas veces como lo tomó. Mientras hay tareas esperando,
+ * el propietario hereda la prioridad de la más prioritaria, de modo que tareas de prioridad
+ * intermedia no lo pueden demorar (inversión de prioridad acotada). Al liberar el último
+ * mutex que tiene tomado la tarea recupera su prioridad base.
  *
  *===================================================================================*/
 
+#include <string.h>
+
 #include "MSE_API.h"
+#include "MSE_OS_Traza.h"
+
+
+// dato[] se declara en palabras: un LONG_COLA que no sea múltiplo de 4 perdería bytes
+_Static_assert((LONG_COLA % 4)==0, "LONG_COLA debe ser multiplo de 4");
+
+/*===================[Declaración de funciones locales]================================*/
+
+static uintptr_t svcSemaforoTomar(uintptr_t sem, uintptr_t delayTicks);
+static uintptr_t svcSemaforoLiberar(uintptr_t sem, uintptr_t arg1);
+static uintptr_t svcMutexTomar(uintptr_t mtx, uintptr_t delayTicks);
+static uintptr_t svcMutexLiberar(uintptr_t mtx, uintptr_t arg1);
+static uintptr_t svcEventosSet(uintptr_t ev, uintptr_t bits);
+static uintptr_t svcEventosEsperar(uintptr_t ev, uintptr_t pedido);
+static tarea* eventosAplicar(eventos* ev);
+static uintptr_t svcNotificar(uintptr_t task, uintptr_t bits);
+static uintptr_t svcNotificacionEsperar(uintptr_t delayTicks, uintptr_t arg1);
+static bool notificar(tarea* task, uint32_t bits);
+static uintptr_t svcColaPush(uintptr_t buffer, uintptr_t pedido);
+static uintptr_t svcColaPop(uintptr_t buffer, uintptr_t pedido);
+static uintptr_t svcColaPrestar(uintptr_t buffer, uintptr_t pedido);
+static uintptr_t svcColaConfirmar(uintptr_t buffer, uintptr_t arg1);
+static uintptr_t svcColaRecibir(uintptr_t buffer, uintptr_t pedido);
+static uintptr_t svcColaDevolver(uintptr_t buffer, uintptr_t arg1);
+static void copiarDato(void *destino, const void *origen, uint16_t longitud);
+static tarea* masPrioritaria(tarea *a, tarea *b);
+static tarea* despertar(listaEspera *lista, eventoTraza evento, const void *objeto);
+
+/*===================[Definición de datos locales]=====================================*/
+
+// Argumentos de svcColaPush() y svcColaPop(), que no entran en los dos registros del SVC
+struct _pedidoCola {
+	void *dato;					// Dato a ingresar o lugar donde dejar el dato sacado
+	uint32_t ticks;				// Ticks que puede esperar la tarea
+};
+
+typedef struct _pedidoCola pedidoCola;
+
+// Condición que espera una tarea en un grupo de eventos (se apunta con datoEspera)
+struct _pedidoEventos {
+	uint32_t mascara;			// Bits esperados
+	uint8_t opciones;			// EVENTOS_ESPERAR_TODOS, EVENTOS_BORRAR_AL_SALIR
+	uint32_t ticks;				// Ticks que puede esperar la tarea
+	uint32_t resultado;			// Bits del grupo cuando se cumplió la condición
+};
+
+typedef struct _pedidoEventos pedidoEventos;
+
+static statusSemTake colaEsperar(servicioKernel servicio, cola* buffer, pedidoCola* pedido, uint64_t delayTicks);
 
 /*************************************************************************************************
 	 *  @brief Función que inicializa un semáforo binario
@@ -40,13 +126,28 @@
      *  El semáforo se crea en etapa de complación mediante la creaión de una variable "semaforo"
      *  Esta función conigura los valores iniciales de esa variable.
      *
-	 *  @param 		semaforo* sem,uint32_t delayTicks.
-	 *  @return     bool.
+	 *  @param 		semaforo* sem.
+	 *  @return     None.
 ***************************************************************************************************/
 void os_SemaforoInit(semaforo* sem){
-	sem->tareaSemaforo=NULL;
-	sem->estadoSemaforo=TOMADO;
-	sem->delaySemaforo=portMax_DELAY;
+	os_SemaforoInitContador(sem, 1, 0);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función que inicializa un semáforo contador
+     *
+     *  @details
+     *  El semáforo se puede tomar cuentaInicial veces sin esperar, y acumula hasta cuentaMax
+     *  liberaciones sin tareas esperando.
+     *
+	 *  @param 		semaforo* sem, uint32_t cuentaMax, uint32_t cuentaInicial.
+	 *  @return     None.
+***************************************************************************************************/
+void os_SemaforoInitContador(semaforo* sem, uint32_t cuentaMax, uint32_t cuentaInicial){
+	os_EsperaInit(&sem->espera);
+	sem->cuentaMax=cuentaMax;
+	sem->cuenta=(cuentaInicial<cuentaMax) ? cuentaInicial : cuentaMax;
 }
 
 
@@ -54,43 +155,28 @@ void os_SemaforoInit(semaforo* sem){
 	 *  @brief Función que toma un semáforo por un tiempo determinado
      *
      *  @details
-     *  Cuando la tarea toma el semáforo, se pasa a estado TAREA_BLOCKED. Si el semáforo ya estaba
-     *  bloqueado, sigue estando en estado bloqueado y se reescribe el delayTicks.
+     *  Si la cuenta del semáforo es mayor a cero se la decrementa y se vuelve sin esperar.
+     *  Si no, la tarea pasa a estado TAREA_BLOCKED en la lista de espera del semáforo. Si
+     *  delayTicks es distinto de portMax_DELAY la tarea se inserta además en la lista de
+     *  retardos del sistema, de donde SysTick_Handler la saca si vence el tiempo antes de que
+     *  alguien lo libere.
      *  Devuelve pdTrue si se pudo tomar correctamente, o pdFalse si durante delayTicks nadie lo
-     *  liberó.
-     *  El máximo de delayTicks es 65535
+     *  liberó. Con delayTicks igual a 0 no se espera, y con delayTicks mayor o igual a
+     *  portMax_DELAY se espera por tiempo indefinido.
      *
 	 *  @param 		semaforo* sem,uint32_t delayTicks.
 	 *  @return     bool.
 ***************************************************************************************************/
 statusSemTake os_SemaforoTake (semaforo* sem,uint64_t delayTicks) {
-	static uint64_t ticks_finales;
-	tarea * tareaActual;
-
-	// Leo el valor del contador de ticks
-	ticks_finales=portMax_DELAY;
-	if(delayTicks!=portMax_DELAY)
-		ticks_finales= os_getSytemTicks()+delayTicks;
 
-	// Actualiza estado
-	irqOff();
-	tareaActual=os_getTareaActual();
-	sem->tareaSemaforo=tareaActual;
-	tareaActual->estado=TAREA_BLOCKED;
-	tareaActual->ticks_bloqueada=TICKS_ON;	// Se hace para que SysTick_Handler no lo ponga en TAREA_READY
-	sem->delaySemaforo=ticks_finales;
-	sem->estadoSemaforo=TOMADO;
-	irqOn();
-	// Llama al scheduler
-	os_Yield();
+	if(delayTicks>portMax_DELAY)
+		delayTicks=portMax_DELAY;
 
-	while(os_getSytemTicks()<ticks_finales){
-		tareaActual->ticks_bloqueada=TICKS_ON; 	// Se hace para que SysTick_Handler no lo ponga en TAREA_READY
-		if(sem->estadoSemaforo==LIBERADO)
-			sem->estadoSemaforo=TOMADO;
+	// Si se bloqueó, al volver del SVC ya lo liberaron o venció el timeout
+	if(os_LlamadaKernel(svcSemaforoTomar, (uintptr_t)sem, (uint32_t)delayTicks)==pdTrue)
 		return pdTrue;
-		}
-	return pdFalse;									// no fue liberado durante los delayTicks
+
+	return (statusSemTake)os_getTareaActual()->resultadoEspera;
 }
 
 /********************************************************************************
@@ -103,135 +189,1180 @@ statusSemTake os_SemaforoTake (semaforo* sem,uint64_t delayTicks) {
 	 *  @return     None.
  *******************************************************************************/
 void os_SemaforoGive(semaforo* sem)  {
-	tarea * tareaLiberar;
+	os_LlamadaKernel(svcSemaforoLiberar, (uintptr_t)sem, 0);
+}
+
+
+/********************************************************************************
+	 *  @brief Liberar un semaforo desde una interrupción
+     *
+     *  @details
+     *   Igual que os_SemaforoGive() pero no usa el SVC ni habilita las
+     *   interrupciones al terminar. Si la tarea despertada es más prioritaria que
+     *   la interrumpida se pide un scheduling al salir de la interrupción.
+     *
+	 *  @param		sem		Semáforo a liberar
+	 *  @return     None.
+ *******************************************************************************/
+void os_SemaforoGiveFromISR(semaforo* sem)  {
+	uint32_t estado;
+	tarea *task;
+
+	estado=irqOffGuardar();
+	task=despertar(&sem->espera, TRAZA_SEMAFORO_DESBLOQUEA, sem);
+	if(task==NULL && sem->cuenta<sem->cuentaMax)
+		sem->cuenta++;
+	irqRestaurar(estado);
+
+	os_SolicitarCambioISR(task);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que bloquea la tarea actual en un semáforo.
+     *
+     *  @details
+     *   Si hay que esperar, la tarea se bloquea en sem->espera (y en la lista de retardos si
+     *   delayTicks es distinto de portMax_DELAY) y se llama al scheduler; el cambio de contexto
+     *   se hace al salir del SVC y el resultado de la espera queda en resultadoEspera.
+     *
+	 *  @param 		sem, delayTicks
+	 *  @return     pdTrue si se tomó sin esperar, pdFalse si no.
+***************************************************************************************************/
+static uintptr_t svcSemaforoTomar(uintptr_t sem, uintptr_t delayTicks)  {
+	semaforo *semAux=(semaforo*)sem;
+	tarea *tareaActual;
+
+	irqOff();
+	tareaActual=os_getTareaActual();
+	tareaActual->resultadoEspera=ESPERA_TIMEOUT;
+
+	if(semAux->cuenta>0)  {
+		semAux->cuenta--;
+		irqOn();
+		return pdTrue;
+	}
+
+	if(delayTicks==0)  {
+		irqOn();
+		return pdFalse;
+	}
+
+	OS_TRAZA_EVENTO(TRAZA_SEMAFORO_BLOQUEA, tareaActual, semAux);
+	os_EsperaBloquear(&semAux->espera, tareaActual, delayTicks);	// portMax_DELAY es TICKS_ON
+	irqOn();
+
+	os_Yield();
+	return pdFalse;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que libera un semáforo.
+     *
+     *  @details
+     *   Si hay tareas esperando se despierta la de mayor prioridad, que se queda con el
+     *   semáforo. Si no, se incrementa la cuenta (sin pasar de cuentaMax).
+     *   Desde una interrupción se ejecuta directamente (ver os_LlamadaKernel()).
+     *
+	 *  @param 		sem
+	 *  @return     0.
+***************************************************************************************************/
+static uintptr_t svcSemaforoLiberar(uintptr_t sem, uintptr_t arg1)  {
+	semaforo *semAux=(semaforo*)sem;
+	tarea *task;
+
+	(void)arg1;
+
+	irqOff();
+	task=despertar(&semAux->espera, TRAZA_SEMAFORO_DESBLOQUEA, semAux);
+	if(task==NULL && semAux->cuenta<semAux->cuentaMax)
+		semAux->cuenta++;
+	irqOn();
+
+	// Desde una interrupción el scheduling lo pide os_IRQHandler() al terminar
+	os_SolicitarCambio(task);
+	return 0;
+}
+
+
+
+
+
+/*************************************************************************************************
+	 *  @brief Función que inicializa un mutex
+     *
+     *  @details
+     *  El mutex se crea en etapa de complación mediante la creaión de una variable "mutex".
+     *  Se inicializa libre y sin tareas esperando.
+     *
+	 *  @param 		mutex* mtx.
+	 *  @return     None.
+***************************************************************************************************/
+void os_MutexInit(mutex* mtx){
+	os_EsperaInit(&mtx->espera);
+	mtx->recursion=0;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función que toma un mutex por un tiempo determinado
+     *
+     *  @details
+     *  Si el mutex está libre o ya es de la tarea se toma sin bloquear. Si no, la tarea se
+     *  bloquea en la lista de espera del mutex, ordenada por prioridad, y el propietario
+     *  hereda su prioridad. Al liberarlo se le entrega directamente a la tarea de mayor
+     *  prioridad que espera.
+     *  Con delayTicks igual a 0 no se espera, y con delayTicks mayor o igual a portMax_DELAY
+     *  se espera por tiempo indefinido. No se debe llamar desde una interrupción.
+     *
+	 *  @param 		mutex* mtx, uint64_t delayTicks.
+	 *  @return     pdTrue si se tomó el mutex, pdFalse si venció el tiempo.
+***************************************************************************************************/
+statusSemTake os_MutexTake(mutex* mtx,uint64_t delayTicks){
+
+	if(delayTicks>portMax_DELAY)
+		delayTicks=portMax_DELAY;
+
+	// Si se bloqueó, al volver del SVC ya le entregaron el mutex o venció el timeout
+	if(os_LlamadaKernel(svcMutexTomar, (uintptr_t)mtx, (uint32_t)delayTicks)==pdTrue)
+		return pdTrue;
+
+	return (statusSemTake)os_getTareaActual()->resultadoEspera;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función que libera un mutex
+     *
+     *  @details
+     *  Solo lo puede liberar la tarea propietaria. No se debe llamar desde una interrupción.
+     *
+	 *  @param 		mutex* mtx.
+	 *  @return     pdFalse si la tarea no era la propietaria, pdTrue en caso contrario.
+***************************************************************************************************/
+statusSemTake os_MutexGive(mutex* mtx){
+	return (statusSemTake)os_LlamadaKernel(svcMutexLiberar, (uintptr_t)mtx, 0);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que toma un mutex.
+     *
+     *  @details
+     *   Si hay que esperar, la tarea se bloquea en mtx->espera y se llama al scheduler; el
+     *   resultado de la espera queda en resultadoEspera de la tarea.
+     *
+	 *  @param 		mtx, delayTicks
+	 *  @return     pdTrue si se tomó sin esperar, pdFalse si no.
+***************************************************************************************************/
+static uintptr_t svcMutexTomar(uintptr_t mtx, uintptr_t delayTicks)  {
+	mutex *mtxAux=(mutex*)mtx;
+	tarea *tareaActual;
+
+	irqOff();
+	tareaActual=os_getTareaActual();
+	tareaActual->resultadoEspera=ESPERA_TIMEOUT;
+
+	if(mtxAux->espera.propietario==NULL)  {
+		mtxAux->espera.propietario=tareaActual;
+		mtxAux->recursion=1;
+		tareaActual->mutexTomados++;
+		irqOn();
+		return pdTrue;
+	}
 
-	tareaLiberar=sem->tareaSemaforo;
+	if(mtxAux->espera.propietario==tareaActual)  {
+		mtxAux->recursion++;
+		irqOn();
+		return pdTrue;
+	}
 
-	if (sem->estadoSemaforo == TOMADO && tareaLiberar!= NULL)  {
-		irqOff();
-		tareaLiberar->ticks_bloqueada=TICKS_OFF;
-		tareaLiberar->estado=TAREA_READY;
-		sem->estadoSemaforo = LIBERADO;
+	if(delayTicks==0)  {
 		irqOn();
+		return pdFalse;
 	}
+
+	os_EsperaBloquear(&mtxAux->espera, tareaActual, delayTicks);	// portMax_DELAY es TICKS_ON
+	irqOn();
+
+	os_Yield();
+	return pdFalse;
 }
 
 
+/*************************************************************************************************
+	 *  @brief Función del kernel que libera un mutex.
+     *
+     *  @details
+     *   Cuando el propietario libera el último mutex que tenía tomado recupera su prioridad
+     *   base. El mutex pasa directamente a la tarea de mayor prioridad que espera, que a su
+     *   vez hereda la prioridad de las que siguen esperando.
+     *
+	 *  @param 		mtx
+	 *  @return     pdTrue o pdFalse.
+***************************************************************************************************/
+static uintptr_t svcMutexLiberar(uintptr_t mtx, uintptr_t arg1)  {
+	mutex *mtxAux=(mutex*)mtx;
+	tarea *tareaActual, *siguiente;
+	prioridadTarea prioridadPrevia;
+
+	(void)arg1;
+
+	irqOff();
+	tareaActual=os_getTareaActual();
+	prioridadPrevia=tareaActual->prioridad;
+	if(mtxAux->espera.propietario!=tareaActual)  {
+		irqOn();
+		return pdFalse;
+	}
+
+	if(--mtxAux->recursion>0)  {
+		irqOn();
+		return pdTrue;
+	}
+
+	tareaActual->mutexTomados--;
+	if(tareaActual->mutexTomados==0)
+		os_setTareaPrioridadEfectiva(tareaActual, tareaActual->prioridadBase);
+
+	siguiente=os_EsperaDespertar(&mtxAux->espera, ESPERA_OK);
+	mtxAux->espera.propietario=siguiente;
+	if(siguiente!=NULL)  {
+		mtxAux->recursion=1;
+		siguiente->mutexTomados++;
+		if(mtxAux->espera.primera!=NULL && mtxAux->espera.primera->prioridad<siguiente->prioridad)
+			os_setTareaPrioridadEfectiva(siguiente, mtxAux->espera.primera->prioridad);
+	}
+	irqOn();
 
+	// Si perdió la prioridad heredada puede haber tareas READY más prioritarias
+	if(tareaActual->prioridad!=prioridadPrevia)
+		os_Yield();
+	else
+		os_SolicitarCambio(siguiente);
+	return pdTrue;
+}
 
 
 /********************************************************************************
-	 *  @brief Inicializa una cola
+	 *  @brief Inicializa un grupo de eventos
      *
      *  @details
-     *   Esta función se utiliza para inicializar una cola.
+     *   Todos los bits empiezan en 0.
      *
-	 *  @param		cola* buffer, uint8_t longDato
+	 *  @param		ev
 	 *  @return     None.
  *******************************************************************************/
-void os_ColaInit(cola* buffer, uint16_t longDato){
-	buffer->tareaIn=NULL;
-	buffer->tareaOut=NULL;
-	buffer->longElemento=longDato;
-	buffer->contadorElementos=0;
-	buffer->cantElementosMax=(uint16_t)(LONG_COLA/longDato);
-	for(int i=0;i<LONG_COLA;i++)buffer->dato[i]=0;    // no tendía que ser necesario
+void os_EventosInit(eventos* ev)  {
+	os_EsperaInit(&ev->espera);
+	ev->bits=0;
 }
 
 
+/********************************************************************************
+	 *  @brief Pone en 1 bits de un grupo de eventos
+     *
+     *  @details
+     *   Se despiertan todas las tareas cuya condición se cumple.
+     *
+	 *  @param		ev, bits
+	 *  @return     Los bits del grupo luego de despertar a las tareas.
+ *******************************************************************************/
+uint32_t os_EventosSet(eventos* ev, uint32_t bits)  {
+	return os_LlamadaKernel(svcEventosSet, (uintptr_t)ev, bits);
+}
+
 
 /********************************************************************************
-	 *  @brief Escribe un dato en la cola
+	 *  @brief Pone en 1 bits de un grupo de eventos desde una interrupción
      *
      *  @details
-     *   Esta función se utiliza poner elementos en la cola. Si la cola está
-     *   llena, bloquea la tareaIn con la función  os_setTareaEstado. Si se
-     *   bloquea la tareaIn se llama al scheduler.
+     *   Si alguna tarea despertada es más prioritaria que la interrumpida se pide
+     *   un scheduling al salir de la interrupción.
      *
-	 *  @param		cola* buffer, dato
+	 *  @param		ev, bits
 	 *  @return     None.
  *******************************************************************************/
-void os_ColaPush(cola* buffer,void* dato){
-	tarea *tareaAux;
-
-	while(1){
-		if(buffer->contadorElementos<buffer->cantElementosMax){
-			// Como hay lugar
-			memcpy(buffer->dato+buffer->contadorElementos,dato,buffer->longElemento);
-			buffer->contadorElementos++;
-			// Debo desploquear la tareaOut ya que se puso un elemento
-			if(buffer->tareaOut!=NULL){
-				void irqOff(void);
-				tareaAux=buffer->tareaOut;
-				os_setTareaEstado(tareaAux, TAREA_READY);
-				buffer->tareaOut=NULL;
-				void irqOn(void);
-				}
-			break;
+void os_EventosSetFromISR(eventos* ev, uint32_t bits)  {
+	uint32_t estado;
+	tarea *task;
+
+	estado=irqOffGuardar();
+	ev->bits|=bits;
+	task=eventosAplicar(ev);
+	irqRestaurar(estado);
+
+	os_SolicitarCambioISR(task);
+}
+
+
+/********************************************************************************
+	 *  @brief Pone en 0 bits de un grupo de eventos
+     *
+     *  @details
+     *   Se puede llamar desde una tarea o una interrupción.
+     *
+	 *  @param		ev, bits
+	 *  @return     Los bits del grupo antes de borrarlos.
+ *******************************************************************************/
+uint32_t os_EventosClear(eventos* ev, uint32_t bits)  {
+	uint32_t estado, anteriores;
+
+	estado=irqOffGuardar();
+	anteriores=ev->bits;
+	ev->bits&=~bits;
+	irqRestaurar(estado);
+
+	return anteriores;
+}
+
+
+/********************************************************************************
+	 *  @brief Espera bits de un grupo de eventos
+     *
+     *  @details
+     *   Con EVENTOS_ESPERAR_TODOS en opciones se espera que estén en 1 todos los
+     *   bits de mascara, y si no alguno de ellos. Con EVENTOS_BORRAR_AL_SALIR los
+     *   bits de mascara se borran al cumplirse la condición. Con delayTicks igual
+     *   a 0 no se espera, y con delayTicks mayor o igual a portMax_DELAY se espera
+     *   por tiempo indefinido.
+     *   Devuelve los bits del grupo al cumplirse la condición (antes de borrarlos)
+     *   o al vencer el tiempo, por lo que se sabe si se cumplió comparándolos con
+     *   la máscara.
+     *
+	 *  @param		ev, mascara, opciones, delayTicks
+	 *  @return     Los bits del grupo.
+ *******************************************************************************/
+uint32_t os_EventosEsperar(eventos* ev, uint32_t mascara, uint8_t opciones, uint64_t delayTicks)  {
+	pedidoEventos pedido;
+
+	if(delayTicks>portMax_DELAY)
+		delayTicks=portMax_DELAY;
+
+	pedido.mascara=mascara;
+	pedido.opciones=opciones;
+	pedido.ticks=(uint32_t)delayTicks;
+
+	// Si se bloqueó, al volver del SVC ya se cumplió la condición o venció el timeout
+	if(os_LlamadaKernel(svcEventosEsperar, (uintptr_t)ev, (uintptr_t)&pedido)!=pdTrue &&
+	   os_getTareaActual()->resultadoEspera==ESPERA_TIMEOUT)
+		return ev->bits;
+
+	return pedido.resultado;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Despierta a las tareas cuya condición se cumple.
+     *
+     *  @details
+     *   Se recorre toda la lista de espera (que está ordenada por prioridad) y luego se borran
+     *   los bits de las tareas que lo pidieron, de modo que todas vean los mismos bits. Se
+     *   debe llamar con las interrupciones deshabilitadas.
+     *
+	 *  @param 		ev
+	 *  @return     La tarea más prioritaria despertada, o NULL.
+***************************************************************************************************/
+static tarea* eventosAplicar(eventos* ev)  {
+	tarea *task, *siguiente, *primera=NULL;
+	pedidoEventos *pedido;
+	uint32_t borrar=0, cumplidos;
+
+	for(task=ev->espera.primera;task!=NULL;task=siguiente)  {
+		siguiente=task->siguienteEspera;
+		pedido=(pedidoEventos*)task->datoEspera;
+		cumplidos=ev->bits & pedido->mascara;
+
+		if((pedido->opciones & EVENTOS_ESPERAR_TODOS) ? cumplidos==pedido->mascara : cumplidos!=0)  {
+			pedido->resultado=ev->bits;
+			if(pedido->opciones & EVENTOS_BORRAR_AL_SALIR)
+				borrar|=pedido->mascara;
+			task->resultadoEspera=ESPERA_OK;
+			os_setTareaEstado(task, TAREA_READY);		// La quita de la lista de espera
+			if(primera==NULL)
+				primera=task;
 			}
-		else{
-			// Si la cola está llena se debe bloquear la tarea, hasta que tenga lugar
-			// El desbloquelo(TAREA_READY) lo hace os_ColaPop()
-			void irqOff(void);
-			tareaAux = os_getTareaActual();
-			buffer->tareaIn=tareaAux;
-			os_setTareaEstado(tareaAux, TAREA_BLOCKED);
-			void irqOn(void);
-			// Llama al scheduler
-			os_Yield();
+		}
+
+	ev->bits&=~borrar;
+	return primera;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel de os_EventosSet().
+     *
+	 *  @param 		ev, bits
+	 *  @return     Los bits del grupo.
+***************************************************************************************************/
+static uintptr_t svcEventosSet(uintptr_t ev, uintptr_t bits)  {
+	eventos *evAux=(eventos*)ev;
+	tarea *task;
+	uint32_t resultado;
+
+	irqOff();
+	evAux->bits|=bits;
+	task=eventosAplicar(evAux);
+	resultado=evAux->bits;
+	irqOn();
+
+	os_SolicitarCambio(task);
+	return resultado;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel de os_EventosEsperar().
+     *
+     *  @details
+     *   Si la condición ya se cumple se vuelve sin esperar. Si no, la tarea se bloquea en la
+     *   lista de espera del grupo con el pedido en datoEspera.
+     *
+	 *  @param 		ev, pedido
+	 *  @return     pdTrue si la condición se cumplió sin esperar, pdFalse si no.
+***************************************************************************************************/
+static uintptr_t svcEventosEsperar(uintptr_t ev, uintptr_t pedido)  {
+	eventos *evAux=(eventos*)ev;
+	pedidoEventos *pedidoAux=(pedidoEventos*)pedido;
+	tarea *tareaActual;
+	uint32_t cumplidos;
+
+	irqOff();
+	tareaActual=os_getTareaActual();
+	tareaActual->resultadoEspera=ESPERA_TIMEOUT;
+	cumplidos=evAux->bits & pedidoAux->mascara;
 
+	if((pedidoAux->opciones & EVENTOS_ESPERAR_TODOS) ? cumplidos==pedidoAux->mascara : cumplidos!=0)  {
+		pedidoAux->resultado=evAux->bits;
+		if(pedidoAux->opciones & EVENTOS_BORRAR_AL_SALIR)
+			evAux->bits&=~pedidoAux->mascara;
+		irqOn();
+		return pdTrue;
 		}
-	}
+
+	pedidoAux->resultado=evAux->bits;
+	if(pedidoAux->ticks==0)  {
+		irqOn();
+		return pdFalse;
+		}
+
+	tareaActual->datoEspera=pedidoAux;
+	os_EsperaBloquear(&evAux->espera, tareaActual, pedidoAux->ticks);	// portMax_DELAY es TICKS_ON
+	irqOn();
+
+	os_Yield();
+	return pdFalse;
 }
 
 
 /********************************************************************************
-	 *  @brief Inicializa una cola
+	 *  @brief Notifica a una tarea
      *
      *  @details
-     *   Esta función se utiliza sacar elementos en la cola. Si la cola está
-     *   vacía, bloquea la tareaOut con la función  os_setTareaEstado. Si se
-     *   bloquea la tareaOut se llama al scheduler.
+     *   Agrega los bits a la notificación de la tarea y, si la estaba esperando,
+     *   la despierta.
      *
-	 *  @param		cola* buffer, uint8_t longDato
+	 *  @param		task, bits
 	 *  @return     None.
  *******************************************************************************/
-void os_ColaPop(cola* buffer, void *dato){
-	tarea *tareaAux;
-
-	while(1){
-		if(buffer->contadorElementos!=0){
-			// Si la cola no esta vacía se saca un elemento
-			memcpy(dato,buffer->dato,buffer->longElemento);
-
-			// Corrimiento del buffer!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-			for(uint16_t i=0;i<buffer->contadorElementos;i=i+buffer->longElemento){
-				for(uint16_t c=0;c<buffer->longElemento;c++){
-					buffer->dato[i+c]=buffer->dato[i+c+buffer->longElemento];
-					}
-				}
-			buffer->contadorElementos--;
-			// Debo desploquear la tareaIn ya que se sacó un elemento
-			if(buffer->tareaIn!=NULL){
-				void irqOff(void);
-				tareaAux=buffer->tareaIn;
-				os_setTareaEstado(tareaAux, TAREA_READY);
-				buffer->tareaIn=NULL;
-				void irqOn(void);
-				}
-			break;
-			}
-		else{
-			// Si la cola no tiene datos debo bloquear la tarea
-			void irqOff(void);
-			tareaAux = os_getTareaActual();
-			buffer->tareaOut = tareaAux;
-			os_setTareaEstado(tareaAux, TAREA_BLOCKED);
-			void irqOn(void);
-			// Llama al scheduler
-			os_Yield();
-		}
-	}
+void os_TareaNotificar(tarea* task, uint32_t bits)  {
+	os_LlamadaKernel(svcNotificar, (uintptr_t)task, bits);
+}
+
+
+/********************************************************************************
+	 *  @brief Notifica a una tarea desde una interrupción
+     *
+	 *  @param		task, bits
+	 *  @return     None.
+ *******************************************************************************/
+void os_TareaNotificarFromISR(tarea* task, uint32_t bits)  {
+	uint32_t estado;
+	bool despertada;
+
+	estado=irqOffGuardar();
+	despertada=notificar(task, bits);
+	irqRestaurar(estado);
+
+	if(despertada)
+		os_SolicitarCambioISR(task);
 }
 
 
+/********************************************************************************
+	 *  @brief Espera una notificación
+     *
+     *  @details
+     *   Si la tarea no tiene bits de notificación pendientes se bloquea hasta que
+     *   la notifiquen o pasen delayTicks. Con delayTicks igual a 0 no se espera,
+     *   y con delayTicks mayor o igual a portMax_DELAY se espera por tiempo
+     *   indefinido. Los bits se devuelven y se borran.
+     *
+	 *  @param		delayTicks
+	 *  @return     Los bits notificados, 0 si venció el tiempo.
+ *******************************************************************************/
+uint32_t os_TareaNotificacionEsperar(uint64_t delayTicks)  {
+	tarea *tareaActual=os_getTareaActual();
+	uint32_t estado, bits;
+
+	if(delayTicks>portMax_DELAY)
+		delayTicks=portMax_DELAY;
+
+	if(delayTicks!=0)
+		os_LlamadaKernel(svcNotificacionEsperar, (uint32_t)delayTicks, 0);
+
+	estado=irqOffGuardar();
+	bits=tareaActual->notificacion;
+	tareaActual->notificacion=0;
+	tareaActual->esperaNotificacion=false;
+	irqRestaurar(estado);
+
+	return bits;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Agrega bits a la notificación de una tarea.
+     *
+     *  @details
+     *   Se debe llamar con las interrupciones deshabilitadas.
+     *
+	 *  @param 		task, bits
+	 *  @return     true si la tarea estaba esperando y se la despertó.
+***************************************************************************************************/
+static bool notificar(tarea* task, uint32_t bits)  {
+	task->notificacion|=bits;
+	if(!task->esperaNotificacion || task->notificacion==0)
+		return false;
+
+	task->esperaNotificacion=false;
+	task->resultadoEspera=ESPERA_OK;
+	os_setTareaEstado(task, TAREA_READY);
+	return true;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel de os_TareaNotificar().
+     *
+	 *  @param 		task, bits
+	 *  @return     0.
+***************************************************************************************************/
+static uintptr_t svcNotificar(uintptr_t task, uintptr_t bits)  {
+	bool despertada;
+
+	irqOff();
+	despertada=notificar((tarea*)task, bits);
+	irqOn();
+
+	if(despertada)
+		os_SolicitarCambio((tarea*)task);
+	return 0;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que bloquea la tarea hasta que la notifiquen.
+     *
+	 *  @param 		delayTicks
+	 *  @return     0.
+***************************************************************************************************/
+static uintptr_t svcNotificacionEsperar(uintptr_t delayTicks, uintptr_t arg1)  {
+	tarea *tareaActual;
+
+	(void)arg1;
+
+	irqOff();
+	tareaActual=os_getTareaActual();
+	if(tareaActual->notificacion!=0)  {
+		irqOn();
+		return 0;
+		}
+
+	tareaActual->esperaNotificacion=true;
+	tareaActual->resultadoEspera=ESPERA_TIMEOUT;
+	os_setTicksTarea(tareaActual, delayTicks);		// portMax_DELAY es TICKS_ON
+	irqOn();
+
+	os_Yield();
+	return 0;
+}
+
+
+/********************************************************************************
+	 *  @brief Inicializa una cola
+     *
+     *  @details
+     *   Esta función se utiliza para inicializar una cola sobre su buffer propio
+     *   de LONG_COLA bytes.
+     *
+	 *  @param		cola* buffer, uint8_t longDato
+	 *  @return     None.
+ *******************************************************************************/
+void os_ColaInit(cola* buffer, uint16_t longDato){
+	os_ColaInitMemoria(buffer, longDato, buffer->dato, LONG_COLA);
+}
+
+
+/********************************************************************************
+	 *  @brief Inicializa una cola sobre una memoria de la aplicación
+     *
+     *  @details
+     *   Igual que os_ColaInit(), pero los datos se guardan en memoria, que debe
+     *   durar tanto como la cola. Entran longMemoria/longDato elementos. Para que
+     *   los datos se copien de a palabras la memoria debe estar alineada a
+     *   palabra (por ejemplo, declarada como uint32_t[]). Si no entra ni un
+     *   elemento, o longDato es 0, se produce el error ERR_OS_COLA_MEMORIA y la
+     *   cola no se inicializa.
+     *
+	 *  @param		buffer, longDato, memoria, longMemoria (en bytes)
+	 *  @return     None.
+ *******************************************************************************/
+void os_ColaInitMemoria(cola* buffer, uint16_t longDato, void* memoria, uint16_t longMemoria)  {
+	if(longDato==0 || longMemoria<longDato)  {
+		os_setError(ERR_OS_COLA_MEMORIA,os_ColaInitMemoria);		// Se produce un error
+		return;
+		}
+
+	os_EsperaInit(&buffer->productores);
+	os_EsperaInit(&buffer->consumidores);
+	buffer->longElemento=longDato;
+	buffer->contadorElementos=0;
+	buffer->cabeza=0;
+	buffer->fin=0;
+	buffer->prestamoProductor=false;
+	buffer->prestamoConsumidor=false;
+	buffer->memoria=(uint8_t*)memoria;
+	buffer->cantElementosMax=(uint16_t)(longMemoria/longDato);
+}
+
+
+
+/********************************************************************************
+	 *  @brief Escribe un dato en la cola
+     *
+     *  @details
+     *   Esta función se utiliza poner elementos en la cola. Si la cola está
+     *   llena, la tarea se bloquea en la lista de productores de la cola hasta
+     *   que una tarea saque un elemento.
+     *
+	 *  @param		cola* buffer, dato
+	 *  @return     None.
+ *******************************************************************************/
+void os_ColaPush(cola* buffer,void* dato){
+	pedidoCola pedido={dato, 0};
+
+	colaEsperar(svcColaPush, buffer, &pedido, portMax_DELAY);
+}
+
+
+/********************************************************************************
+	 *  @brief Saca un dato de la cola
+     *
+     *  @details
+     *   Esta función se utiliza sacar elementos en la cola. Si la cola está
+     *   vacía, la tarea se bloquea en la lista de consumidores de la cola hasta
+     *   que una tarea ingrese un elemento.
+     *
+	 *  @param		cola* buffer, dato
+	 *  @return     None.
+ *******************************************************************************/
+void os_ColaPop(cola* buffer, void *dato){
+	pedidoCola pedido={dato, 0};
+
+	colaEsperar(svcColaPop, buffer, &pedido, portMax_DELAY);
+}
+
+
+/********************************************************************************
+	 *  @brief Escribe un dato en la cola esperando como máximo delayTicks
+     *
+     *  @details
+     *   Con delayTicks igual a 0 no se espera, y con delayTicks mayor o igual a
+     *   portMax_DELAY se espera por tiempo indefinido.
+     *
+	 *  @param		cola* buffer, dato, delayTicks
+	 *  @return     pdTrue si se ingresó el dato, pdFalse si venció el tiempo.
+ *******************************************************************************/
+statusSemTake os_ColaPushTimeout(cola* buffer,void* dato,uint64_t delayTicks){
+	pedidoCola pedido={dato, 0};
+
+	return colaEsperar(svcColaPush, buffer, &pedido, delayTicks);
+}
+
+
+/********************************************************************************
+	 *  @brief Saca un dato de la cola esperando como máximo delayTicks
+     *
+     *  @details
+     *   Con delayTicks igual a 0 no se espera, y con delayTicks mayor o igual a
+     *   portMax_DELAY se espera por tiempo indefinido.
+     *
+	 *  @param		cola* buffer, dato, delayTicks
+	 *  @return     pdTrue si se sacó un dato, pdFalse si venció el tiempo.
+ *******************************************************************************/
+statusSemTake os_ColaPopTimeout(cola* buffer,void* dato,uint64_t delayTicks){
+	pedidoCola pedido={dato, 0};
+
+	return colaEsperar(svcColaPop, buffer, &pedido, delayTicks);
+}
+
+
+/********************************************************************************
+	 *  @brief Pide prestado un lugar de la cola para llenarlo sin copias
+     *
+     *  @details
+     *   Devuelve un puntero al lugar donde va el próximo dato, dentro del buffer
+     *   de la cola. El dato recién es visible para los consumidores cuando se
+     *   llama a os_ColaConfirmar(). Si la cola está llena o ya hay un lugar
+     *   prestado se espera como máximo delayTicks.
+     *
+	 *  @param		cola* buffer, delayTicks
+	 *  @return     Puntero al lugar prestado, o NULL si venció el tiempo.
+ *******************************************************************************/
+void* os_ColaPrestar(cola* buffer,uint64_t delayTicks){
+	pedidoCola pedido={NULL, 0};
+
+	if(colaEsperar(svcColaPrestar, buffer, &pedido, delayTicks)!=pdTrue)
+		return NULL;
+	return pedido.dato;
+}
+
+
+/********************************************************************************
+	 *  @brief Ingresa en la cola el lugar prestado por os_ColaPrestar()
+     *
+	 *  @param		cola* buffer
+	 *  @return     None.
+ *******************************************************************************/
+void os_ColaConfirmar(cola* buffer){
+	os_LlamadaKernel(svcColaConfirmar, (uintptr_t)buffer, 0);
+}
+
+
+/********************************************************************************
+	 *  @brief Recibe el primer dato de la cola sin copiarlo
+     *
+     *  @details
+     *   Devuelve un puntero al primer dato dentro del buffer de la cola. El dato
+     *   sigue ocupando su lugar hasta que se llama a os_ColaDevolver(). Si la
+     *   cola está vacía o ya hay un dato prestado se espera como máximo
+     *   delayTicks.
+     *
+	 *  @param		cola* buffer, delayTicks
+	 *  @return     Puntero al dato, o NULL si venció el tiempo.
+ *******************************************************************************/
+void* os_ColaRecibir(cola* buffer,uint64_t delayTicks){
+	pedidoCola pedido={NULL, 0};
+
+	if(colaEsperar(svcColaRecibir, buffer, &pedido, delayTicks)!=pdTrue)
+		return NULL;
+	return pedido.dato;
+}
+
+
+/********************************************************************************
+	 *  @brief Saca de la cola el dato recibido con os_ColaRecibir()
+     *
+	 *  @param		cola* buffer
+	 *  @return     None.
+ *******************************************************************************/
+void os_ColaDevolver(cola* buffer){
+	os_LlamadaKernel(svcColaDevolver, (uintptr_t)buffer, 0);
+}
+
+
+/********************************************************************************
+	 *  @brief Escribe un dato en la cola desde una interrupción
+     *
+     *  @details
+     *   No espera: si la cola está llena (o hay un lugar prestado) devuelve
+     *   pdFalse. Si despierta un consumidor más prioritario que la tarea
+     *   interrumpida se pide un scheduling al salir de la interrupción.
+     *
+	 *  @param		cola* buffer, dato
+	 *  @return     pdTrue si se ingresó el dato, pdFalse si no.
+ *******************************************************************************/
+statusSemTake os_ColaPushFromISR(cola* buffer,void* dato){
+	uint32_t estado;
+	tarea *task;
+
+	estado=irqOffGuardar();
+	if(buffer->prestamoProductor || buffer->contadorElementos>=buffer->cantElementosMax)  {
+		irqRestaurar(estado);
+		return pdFalse;
+	}
+	copiarDato(buffer->memoria+buffer->fin*buffer->longElemento,dato,buffer->longElemento);
+	if(++buffer->fin==buffer->cantElementosMax)
+		buffer->fin=0;
+	buffer->contadorElementos++;
+	task=despertar(&buffer->consumidores, TRAZA_COLA_DESBLOQUEA, buffer);
+	irqRestaurar(estado);
+
+	os_SolicitarCambioISR(task);
+	return pdTrue;
+}
+
+
+/********************************************************************************
+	 *  @brief Saca un dato de la cola desde una interrupción
+     *
+     *  @details
+     *   No espera: si la cola está vacía (o hay un dato prestado) devuelve
+     *   pdFalse.
+     *
+	 *  @param		cola* buffer, dato
+	 *  @return     pdTrue si se sacó un dato, pdFalse si no.
+ *******************************************************************************/
+statusSemTake os_ColaPopFromISR(cola* buffer,void* dato){
+	uint32_t estado;
+	tarea *task;
+
+	estado=irqOffGuardar();
+	if(buffer->prestamoConsumidor || buffer->contadorElementos==0)  {
+		irqRestaurar(estado);
+		return pdFalse;
+	}
+	copiarDato(dato,buffer->memoria+buffer->cabeza*buffer->longElemento,buffer->longElemento);
+	if(++buffer->cabeza==buffer->cantElementosMax)
+		buffer->cabeza=0;
+	buffer->contadorElementos--;
+	task=despertar(&buffer->productores, TRAZA_COLA_DESBLOQUEA, buffer);
+	irqRestaurar(estado);
+
+	os_SolicitarCambioISR(task);
+	return pdTrue;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Ingresa o saca un dato de la cola, esperando como máximo delayTicks.
+     *
+     *  @details
+     *   Cuando la tarea se despierta porque cambió la cola otra tarea de mayor prioridad pudo
+     *   haber ganado el lugar o el dato, por lo que se vuelve a intentar con los ticks que
+     *   quedan de la espera original.
+     *
+	 *  @param 		servicio	svcColaPush, svcColaPop, svcColaPrestar o svcColaRecibir
+	 *  @param 		buffer, pedido (con el dato cargado), delayTicks
+	 *  @return     pdTrue o pdFalse.
+***************************************************************************************************/
+static statusSemTake colaEsperar(servicioKernel servicio, cola* buffer, pedidoCola* pedido, uint64_t delayTicks){
+	uint64_t inicio, transcurrido;
+
+	if(delayTicks>portMax_DELAY)
+		delayTicks=portMax_DELAY;
+
+	pedido->ticks=(uint32_t)delayTicks;
+	inicio=os_getSytemTicks();
+
+	while(os_LlamadaKernel(servicio, (uintptr_t)buffer, (uintptr_t)pedido)!=pdTrue){
+		if(pedido->ticks==portMax_DELAY)
+			continue;
+		if(os_getTareaActual()->resultadoEspera==ESPERA_TIMEOUT)
+			return pdFalse;
+		transcurrido=os_getSytemTicks()-inicio;
+		if(transcurrido>=delayTicks)
+			return pdFalse;
+		pedido->ticks=(uint32_t)(delayTicks-transcurrido);
+		}
+
+	return pdTrue;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que ingresa un dato en la cola.
+     *
+     *  @details
+     *   Si hay lugar se copia el dato en la posición fin y se despierta al consumidor de mayor
+     *   prioridad que espera. Si la cola está llena se bloquea la tarea en la lista de
+     *   productores (salvo que no pueda esperar).
+     *
+	 *  @param 		buffer, pedido
+	 *  @return     pdTrue si se ingresó el dato, pdFalse si no.
+***************************************************************************************************/
+static uintptr_t svcColaPush(uintptr_t buffer, uintptr_t pedido)  {
+	cola *colaAux=(cola*)buffer;
+	pedidoCola *pedidoAux=(pedidoCola*)pedido;
+	tarea *tareaActual, *task;
+
+	irqOff();
+	tareaActual=os_getTareaActual();
+	tareaActual->resultadoEspera=ESPERA_TIMEOUT;
+
+	if(!colaAux->prestamoProductor && colaAux->contadorElementos<colaAux->cantElementosMax)  {
+		// Como hay lugar
+		copiarDato(colaAux->memoria+colaAux->fin*colaAux->longElemento,pedidoAux->dato,
+				   colaAux->longElemento);
+		if(++colaAux->fin==colaAux->cantElementosMax)
+			colaAux->fin=0;
+		colaAux->contadorElementos++;
+		task=despertar(&colaAux->consumidores, TRAZA_COLA_DESBLOQUEA, colaAux);
+		irqOn();
+		os_SolicitarCambio(task);
+		return pdTrue;
+	}
+
+	// Si la cola está llena se debe bloquear la tarea, hasta que tenga lugar
+	if(pedidoAux->ticks==0)  {
+		irqOn();
+		return pdFalse;
+		}
+
+	OS_TRAZA_EVENTO(TRAZA_COLA_BLOQUEA, tareaActual, colaAux);
+	os_EsperaBloquear(&colaAux->productores, tareaActual, pedidoAux->ticks);
+	irqOn();
+	os_Yield();
+	return pdFalse;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que saca un dato de la cola.
+     *
+     *  @details
+     *   Si hay datos se copia el de la posición cabeza y se despierta al productor de mayor
+     *   prioridad que espera. Si la cola está vacía se bloquea la tarea en la lista de
+     *   consumidores (salvo que no pueda esperar).
+     *
+	 *  @param 		buffer, pedido
+	 *  @return     pdTrue si se sacó un dato, pdFalse si no.
+***************************************************************************************************/
+static uintptr_t svcColaPop(uintptr_t buffer, uintptr_t pedido)  {
+	cola *colaAux=(cola*)buffer;
+	pedidoCola *pedidoAux=(pedidoCola*)pedido;
+	tarea *tareaActual, *task;
+
+	irqOff();
+	tareaActual=os_getTareaActual();
+	tareaActual->resultadoEspera=ESPERA_TIMEOUT;
+
+	if(!colaAux->prestamoConsumidor && colaAux->contadorElementos!=0)  {
+		// Si la cola no esta vacía se saca un elemento
+		copiarDato(pedidoAux->dato,colaAux->memoria+colaAux->cabeza*colaAux->longElemento,
+				   colaAux->longElemento);
+		if(++colaAux->cabeza==colaAux->cantElementosMax)
+			colaAux->cabeza=0;
+		colaAux->contadorElementos--;
+		task=despertar(&colaAux->productores, TRAZA_COLA_DESBLOQUEA, colaAux);
+		irqOn();
+		os_SolicitarCambio(task);
+		return pdTrue;
+	}
+
+	// Si la cola no tiene datos debo bloquear la tarea
+	if(pedidoAux->ticks==0)  {
+		irqOn();
+		return pdFalse;
+		}
+
+	OS_TRAZA_EVENTO(TRAZA_COLA_BLOQUEA, tareaActual, colaAux);
+	os_EsperaBloquear(&colaAux->consumidores, tareaActual, pedidoAux->ticks);
+	irqOn();
+	os_Yield();
+	return pdFalse;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que presta el lugar de fin de la cola.
+     *
+     *  @details
+     *   El lugar no se cuenta como elemento hasta svcColaConfirmar(), por lo que los
+     *   consumidores no lo ven. Mientras esté prestado el resto de los productores esperan.
+     *
+	 *  @param 		buffer, pedido (se devuelve el lugar en pedido->dato)
+	 *  @return     pdTrue si se prestó el lugar, pdFalse si no.
+***************************************************************************************************/
+static uintptr_t svcColaPrestar(uintptr_t buffer, uintptr_t pedido)  {
+	cola *colaAux=(cola*)buffer;
+	pedidoCola *pedidoAux=(pedidoCola*)pedido;
+	tarea *tareaActual;
+
+	irqOff();
+	tareaActual=os_getTareaActual();
+	tareaActual->resultadoEspera=ESPERA_TIMEOUT;
+
+	if(!colaAux->prestamoProductor && colaAux->contadorElementos<colaAux->cantElementosMax)  {
+		colaAux->prestamoProductor=true;
+		pedidoAux->dato=colaAux->memoria+colaAux->fin*colaAux->longElemento;
+		irqOn();
+		return pdTrue;
+	}
+
+	if(pedidoAux->ticks==0)  {
+		irqOn();
+		return pdFalse;
+		}
+
+	OS_TRAZA_EVENTO(TRAZA_COLA_BLOQUEA, tareaActual, colaAux);
+	os_EsperaBloquear(&colaAux->productores, tareaActual, pedidoAux->ticks);
+	irqOn();
+	os_Yield();
+	return pdFalse;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que ingresa el lugar prestado.
+     *
+     *  @details
+     *   Se despierta al consumidor de mayor prioridad que espera, y si queda lugar a un
+     *   productor que esperaba que se termine el préstamo.
+     *
+	 *  @param 		buffer
+	 *  @return     0.
+***************************************************************************************************/
+static uintptr_t svcColaConfirmar(uintptr_t buffer, uintptr_t arg1)  {
+	cola *colaAux=(cola*)buffer;
+	tarea *task=NULL;
+
+	(void)arg1;
+
+	irqOff();
+	if(colaAux->prestamoProductor)  {
+		colaAux->prestamoProductor=false;
+		if(++colaAux->fin==colaAux->cantElementosMax)
+			colaAux->fin=0;
+		colaAux->contadorElementos++;
+		task=despertar(&colaAux->consumidores, TRAZA_COLA_DESBLOQUEA, colaAux);
+		if(colaAux->contadorElementos<colaAux->cantElementosMax)
+			task=masPrioritaria(task, despertar(&colaAux->productores, TRAZA_COLA_DESBLOQUEA, colaAux));
+	}
+	irqOn();
+	os_SolicitarCambio(task);
+	return 0;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que presta el dato de la cabeza de la cola.
+     *
+     *  @details
+     *   El dato sigue contado en la cola hasta svcColaDevolver(), por lo que los productores no
+     *   pueden pisarlo. Mientras esté prestado el resto de los consumidores esperan.
+     *
+	 *  @param 		buffer, pedido (se devuelve el dato en pedido->dato)
+	 *  @return     pdTrue si se prestó el dato, pdFalse si no.
+***************************************************************************************************/
+static uintptr_t svcColaRecibir(uintptr_t buffer, uintptr_t pedido)  {
+	cola *colaAux=(cola*)buffer;
+	pedidoCola *pedidoAux=(pedidoCola*)pedido;
+	tarea *tareaActual;
+
+	irqOff();
+	tareaActual=os_getTareaActual();
+	tareaActual->resultadoEspera=ESPERA_TIMEOUT;
+
+	if(!colaAux->prestamoConsumidor && colaAux->contadorElementos!=0)  {
+		colaAux->prestamoConsumidor=true;
+		pedidoAux->dato=colaAux->memoria+colaAux->cabeza*colaAux->longElemento;
+		irqOn();
+		return pdTrue;
+	}
+
+	if(pedidoAux->ticks==0)  {
+		irqOn();
+		return pdFalse;
+		}
+
+	OS_TRAZA_EVENTO(TRAZA_COLA_BLOQUEA, tareaActual, colaAux);
+	os_EsperaBloquear(&colaAux->consumidores, tareaActual, pedidoAux->ticks);
+	irqOn();
+	os_Yield();
+	return pdFalse;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que saca el dato prestado.
+     *
+     *  @details
+     *   Se despierta al productor de mayor prioridad que espera, y si quedan datos a un
+     *   consumidor que esperaba que se termine el préstamo.
+     *
+	 *  @param 		buffer
+	 *  @return     0.
+***************************************************************************************************/
+static uintptr_t svcColaDevolver(uintptr_t buffer, uintptr_t arg1)  {
+	cola *colaAux=(cola*)buffer;
+	tarea *task=NULL;
+
+	(void)arg1;
+
+	irqOff();
+	if(colaAux->prestamoConsumidor)  {
+		colaAux->prestamoConsumidor=false;
+		if(++colaAux->cabeza==colaAux->cantElementosMax)
+			colaAux->cabeza=0;
+		colaAux->contadorElementos--;
+		task=despertar(&colaAux->productores, TRAZA_COLA_DESBLOQUEA, colaAux);
+		if(colaAux->contadorElementos!=0)
+			task=masPrioritaria(task, despertar(&colaAux->consumidores, TRAZA_COLA_DESBLOQUEA, colaAux));
+	}
+	irqOn();
+	os_SolicitarCambio(task);
+	return 0;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Copia un elemento de la cola.
+     *
+     *  @details
+     *   Si las dos direcciones y la longitud son múltiplos de 4 se copia de a palabras, que
+     *   es el caso habitual de estructuras con campos de 32 bits. Si no se usa memcpy.
+     *
+	 *  @param 		destino, origen, longitud (en bytes)
+	 *  @return     None.
+***************************************************************************************************/
+static void copiarDato(void *destino, const void *origen, uint16_t longitud)  {
+	uint32_t *destinoAux=(uint32_t*)destino;
+	const uint32_t *origenAux=(const uint32_t*)origen;
+
+	if((((uintptr_t)destino | (uintptr_t)origen | longitud) & 0x03)==0)  {
+		for(longitud/=4;longitud>0;longitud--)
+			*destinoAux++=*origenAux++;
+		}
+	else
+		memcpy(destino,origen,longitud);
+}
+
+/*************************************************************************************************
+	 *  @brief Despierta la primera tarea de una lista de espera y lo registra en la traza.
+     *
+     *  @details
+     *   Es os_EsperaDespertar() con resultado ESPERA_OK. Con OS_TRAZA en 0 no agrega nada.
+     *   Se llama con irqOff().
+     *
+	 *  @param 		lista, evento (TRAZA_SEMAFORO_DESBLOQUEA o TRAZA_COLA_DESBLOQUEA), objeto
+	 *  @return     La tarea despertada o NULL si no había ninguna esperando.
+***************************************************************************************************/
+static tarea* despertar(listaEspera *lista, eventoTraza evento, const void *objeto)  {
+	tarea *task;
+
+	(void)evento;							// Sin uso con OS_TRAZA en 0
+	(void)objeto;
+
+	task=os_EsperaDespertar(lista, ESPERA_OK);
+	if(task!=NULL)  {
+		OS_TRAZA_EVENTO(evento, task, objeto);
+		}
+	return task;
+}
+
+/*************************************************************************************************
+	 *  @brief Elige la más prioritaria de dos tareas despertadas.
+     *
+	 *  @param 		a, b (pueden ser NULL)
+	 *  @return     La de mayor prioridad (a si son iguales), o NULL si las dos lo son.
+***************************************************************************************************/
+static tarea* masPrioritaria(tarea *a, tarea *b)  {
+	if(a==NULL)
+		return b;
+	if(b==NULL || a->prioridad<=b->prioridad)
+		return a;
+	return b;
+}
@@ -13,6 +13,7 @@
  *===================================================================================*/
 
 #include "MSE_OS_Core.h"
+#include "MSE_OS_Traza.h"
 
 //======================= Es provisorio ================================================
 
@@ -21,10 +22,19 @@
 /*===================[Declaración de funciones locales]================================*/
 
 static void scheduler(void);
-static void setPendSV(void);
-uint32_t getContextoSiguiente(uint32_t sp_actual);
-void SysTick_Handler(void);
+static void elegirTareaSiguiente(void);
+static uintptr_t svcYield(uintptr_t arg0, uintptr_t arg1);
+static uintptr_t svcDelay(uintptr_t cuentas, uintptr_t arg1);
 static uint8_t busqueda(uint8_t prioridadScan, estadoTarea estadoT);
+static void listaReadyAgregar(tarea *task);
+static void listaReadyQuitar(tarea *task);
+static void listaDelayAgregar(tarea *task, uint32_t ticks);
+static void listaDelayQuitar(tarea *task);
+static void listaEsperaAgregar(listaEspera *lista, tarea *task);
+static void listaEsperaQuitar(tarea *task);
+static void heredarPrioridad(listaEspera *lista, uint8_t prioridad);
+static uint64_t ciclosEnCurso(uint64_t ahora);
+static void actualizarCarga(void);
 void __attribute__((weak)) idleTask(void);
 
 void __attribute__((weak)) returnHook(void);
@@ -37,7 +47,26 @@ void __attribute__((weak)) errorHook(void *caller);
 
 static osControl control_OS;
 static tarea tareaIdle;
-static uint64_t systemTicks;
+static uint32_t stackIdle[STACK_SIZE_IDLE/4] __attribute__((aligned(8)));
+
+// Stacks que se reparten entre las tareas creadas con os_InitTarea()
+static uint32_t stacksDefault[OS_CANT_STACKS_DEFAULT][STACK_SIZE/4] __attribute__((aligned(8)));
+static uint8_t cantStacksDefault;
+static volatile uint64_t systemTicks;
+static volatile uint64_t baseCiclos;	// os_PortCiclos() extendido a 64 bits en el último tick
+static volatile uint32_t secuenciaTiempo;	// Impar mientras SysTick actualiza el tiempo
+static uint32_t ciclosPorTick;		// Ciclos de un tick, se toma en os_Init()
+static uint32_t anidamientoCritico;	// Cantidad de irqOff() sin su irqOn()
+static uint32_t basepriCritico;		// BASEPRI al entrar a la sección crítica más externa
+
+// Contabilidad del uso de CPU
+static uint64_t inicioEjecucion;	// os_getCiclos64() al entrar la tarea actual
+static uint64_t ciclosIRQ;			// Ciclos usados por las interrupciones
+static uint64_t ciclosIRQInicio;	// ciclosIRQ al entrar la tarea actual
+static uint64_t ventanaTicks;		// systemTicks, ciclos y ciclos de la idleTask al empezar
+static uint64_t ventanaCiclos;		// la ventana de la carga de CPU
+static uint64_t ventanaIdle;
+static uint8_t cargaCPU;
 
 /*==================[Funciones del Sistema Operativo]=================================*/
 
@@ -45,20 +74,32 @@ static uint64_t systemTicks;
 	 *  @brief Inicializa el OS.
      *
      *  @details
-     *   Inicializa el OS seteando la prioridad de PendSV como la mas baja posible. Es setear
-     *   la prioridad de PendSV antes de que inicie el sistema.
+     *   Inicializa el OS. El port (os_PortInit()) configura las prioridades de las excepciones
+     *   del kernel (PendSV la mas baja posible), el contador de ciclos y la FPU.
      *   Se llama esta función luego de inicializar cada tareas.
+     *   Al final se elige la primer tarea y se la lanza inmediatamente (sin esperar al primer
+     *   SysTick) a través de PendSV, por lo que esta función no retorna. Desde ese momento las
+     *   tareas usan el PSP y el MSP queda para el kernel y las interrupciones.
      *
 	 *  @param 		None.
 	 *  @return     None.
 ***************************************************************************************************/
 void os_Init(void)  {
+	// La fuente del tick ya fue configurada por la aplicación, se guarda el período de un tick
+	ciclosPorTick=os_PortCiclosPorTick();
+
 	/*
-	 * Todas las interrupciones tienen prioridad 0 (la máxima) al iniciar la ejecución. Para que
-	 * no se de la condicion de fault mencionada en la teoria, debemos bajar su prioridad en el
-	 * NVIC. La cuenta matematica que se observa da la probabilidad mas baja posible.
+	 * Contador de ciclos del port para medir tiempos y el uso de CPU (el DWT en el Cortex). Si
+	 * no existe o no avanza (QEMU no lo emula) os_getCiclos64() usa la fuente del tick. Arranca
+	 * desde el tiempo que ya contó el tick, para que os_getCiclos64() no vuelva atrás al
+	 * cambiar de fuente.
 	 */
-	NVIC_SetPriority(PendSV_IRQn, (1 << __NVIC_PRIO_BITS)-1);
+	baseCiclos=os_getCiclos64();
+	os_PortInit((uint32_t)baseCiclos);
+
+#if OS_TRAZA
+	os_TrazaInit();
+#endif
 
 	// Se configura las variables de estado del S.O.
 	control_OS.estado_sistema=OS_FROM_RESET;
@@ -73,7 +114,7 @@ void os_Init(void)  {
 	 * Como esta tarea debe estar siempre presente y el usuario no la inicializa.
 	 *
 	 */
-	os_InitTarea(idleTask, &tareaIdle,PRIORITY_COUNT);
+	os_InitTareaStack(idleTask, &tareaIdle,PRIORITY_COUNT,stackIdle,sizeof(stackIdle));
 
 	/*
 	 * En control_OS.listaTareas[] se tiene los punteros de cada tarea y en
@@ -84,23 +125,64 @@ void os_Init(void)  {
 	for(uint8_t c=control_OS.cantidad_Tareas+1;c<MAX_TASK_COUNT;c++){
 		control_OS.listaTareas[c]=NULL;
 	}
+
+	/*
+	 * Arranque de la primer tarea. En el Cortex con el PSP en cero PendSV_Handler sabe que no
+	 * hay contexto que guardar. PendSV tiene la menor prioridad pero el main corre en modo
+	 * thread, por lo que se ejecuta apenas se lo pone pendiente dentro del scheduler.
+	 */
+	os_PortArranque();
+	ventanaTicks=systemTicks;
+	ventanaCiclos=os_getCiclos64();
+	control_OS.estado_sistema=OS_NORMAL_RUN;
+	scheduler();			// Arranca la primer tarea: en el Cortex no se vuelve de acá
+}
+
+/*************************************************************************************************
+	 *  @brief Inicializa las tareas que correran en el OS con un stack de STACK_SIZE bytes.
+     *
+     *  @details
+     *   Mantiene la forma original de crear tareas: el stack se toma de un conjunto de
+     *   OS_CANT_STACKS_DEFAULT stacks de STACK_SIZE bytes reservados por el OS. Las tareas que
+     *   necesitan otro tamaño se crean con os_InitTareaStack().
+     *
+	 *  @param *tarea			Puntero a la tarea que se desea inicializar.
+	 *  @param prioridad		Prioridad de la tarea.
+	 *  @return     None.
+***************************************************************************************************/
+void os_InitTarea(void *entryPoint, tarea *task, prioridadTarea prioridad)  {
+	if(cantStacksDefault < OS_CANT_STACKS_DEFAULT)  {
+		os_InitTareaStack(entryPoint, task, prioridad, stacksDefault[cantStacksDefault++], STACK_SIZE);
+	}
+	else
+		os_setError(ERR_OS_STACK,os_InitTarea);
 }
 
 /*************************************************************************************************
 	 *  @brief Inicializa las tareas que correran en el OS.
      *
      *  @details
-     *   Inicializa una tarea para que pueda correr en el OS implementado.
+     *   Inicializa una tarea para que pueda correr en el OS implementado, usando como stack el
+     *   espacio provisto por la aplicación. Así cada tarea se dimensiona según su uso.
      *   Es necesario llamar a esta funcion para cada tarea antes que inicie el OS.
-     *   Setea la PRIORIDAD de la tarea, los ticks_bloqueada=0, y estado = TAREA_READY
+     *   El stack frame inicial se arma en el tope del stack, alineado a 8 bytes como pide
+     *   el AAPCS. Setea la PRIORIDAD de la tarea, los ticks_bloqueada=0, y estado = TAREA_READY
      *
 	 *  @param *tarea			Puntero a la tarea que se desea inicializar.
+	 *  @param prioridad		Prioridad de la tarea.
 	 *  @param *stack			Puntero al espacio reservado como stack para la tarea.
-	 *  @param *stack_pointer   Puntero a la variable que almacena el stack pointer de la tarea.
+	 *  @param tamanio			Tamaño del stack en bytes, al menos STACK_SIZE_MIN.
 	 *  @return     None.
 ***************************************************************************************************/
-void os_InitTarea(void *entryPoint, tarea *task, prioridadTarea prioridad)  {
+void os_InitTareaStack(void *entryPoint, tarea *task, prioridadTarea prioridad, uint32_t *stack,
+					   uint32_t tamanio)  {
 	static uint8_t id = 0;				//el id sera correlativo a medida que se generen mas tareas
+	uint32_t *tope;
+
+	if(stack == NULL || tamanio < STACK_SIZE_MIN)  {
+		os_setError(ERR_OS_STACK,entryPoint);
+		return;
+	}
 
 	/*
 	 * Al principio se efectua un pequeño checkeo para determinar si llegamos a la cantidad maxima de
@@ -114,19 +196,23 @@ void os_InitTarea(void *entryPoint, tarea *task, prioridadTarea prioridad)  {
 																	// en cuenta el lugar para la tarea
 																	// idelTask
 
-		task->stack[STACK_SIZE/4 - XPSR] = INIT_XPSR;				//necesario para bit thumb
-		task->stack[STACK_SIZE/4 - PC_REG] = (uint32_t)entryPoint;	//direccion de la tarea (ENTRY_POINT)
-		task->stack[STACK_SIZE/4 - LR] = (uint32_t)returnHook;		//Retorno de la tarea (no deberia darse)
+		// Tope del stack alineado a 8 bytes, el stack crece hacia direcciones menores
+		tope = (uint32_t *)(((uintptr_t)stack + tamanio) & ~(uintptr_t)0x07);
+		task->stack = stack;
+		task->stack_size = tamanio;
 
 		/*
-		 * El valor previo de LR (que es EXEC_RETURN en este caso) es necesario dado que
-		 * en esta implementacion, se llama a una funcion desde dentro del handler de PendSV
-		 * con lo que el valor de LR se modifica por la direccion de retorno para cuando
-		 * se termina de ejecutar getContextoSiguiente
+		 * Se pinta el stack con un patrón conocido para poder medir después hasta dónde llegó
+		 * (os_getTareaStackMaximo()), y se ponen palabras de guarda en el fondo, que solo se
+		 * pisan si la tarea desborda su stack.
 		 */
-		task->stack[STACK_SIZE/4 - LR_PREV_VALUE] = EXEC_RETURN;
+		for(uint32_t *p=stack;p<tope;p++)
+			*p = STACK_PATRON;
+		for(uint8_t c=0;c<STACK_GUARDAS;c++)
+			stack[c] = STACK_CANARIO;
 
-		task->stack_pointer = (uint32_t) (task->stack + STACK_SIZE/4 - FULL_STACKING_SIZE);
+		// El port arma en el tope el contexto con el que la tarea arranca en entryPoint
+		task->stack_pointer = os_PortInitContexto(stack, tope, entryPoint, returnHook);
 
 		/*
 		 * Si es la primera vez se configura prioridadMin_Tarea y prioridadMax_Tarea con un valor inicial
@@ -149,6 +235,19 @@ void os_InitTarea(void *entryPoint, tarea *task, prioridadTarea prioridad)  {
 		task->entry_point = entryPoint;
 		task->estado = TAREA_READY;
 		task->ticks_bloqueada=0;
+		task->fpuHabilitada=false;				// Todas las tareas arrancan sin FPU
+		task->contextoFPU=false;
+		task->cambiosFPU=0;
+		task->esperando=NULL;
+		task->siguienteEspera=NULL;
+		task->resultadoEspera=ESPERA_OK;
+		task->datoEspera=NULL;
+		task->notificacion=0;
+		task->esperaNotificacion=false;
+		task->mutexTomados=0;
+		task->ciclosEjecucion=0;
+		task->cambiosContexto=0;
+		task->expropiaciones=0;
 		control_OS.listaTareas[id] = task;		// Se carga los punteros de cada tarea
 
 		if(entryPoint==idleTask){
@@ -167,6 +266,10 @@ void os_InitTarea(void *entryPoint, tarea *task, prioridadTarea prioridad)  {
 			id++;
 			control_OS.cantidad_Tareas=id;     		// Informo al S.O. la cantidad de tareas
 		}
+		task->prioridadBase = task->prioridad;
+
+		// Como la tarea se crea READY se la encola al final de la lista de su prioridad
+		listaReadyAgregar(task);
 	}
 
 	else {
@@ -175,18 +278,17 @@ void os_InitTarea(void *entryPoint, tarea *task, prioridadTarea prioridad)  {
 		 * el ultimo error generado en la estructura de control del OS y se llama a errorHook y se
 		 * envia informacion de quien es quien la invoca.
 		 */
-		os_setError(ERR_OS_CANT_TAREAS,os_InitTarea);
+		os_setError(ERR_OS_CANT_TAREAS,os_InitTareaStack);
 	}
 }
 
 /*************************************************************************************************
-	 *  @brief Función que setea el campo ticks_bloqueada de una tarea
+	 *  @brief Función que bloquea la tarea actual una cantidad de ticks
      *
      *  @details
-     *   Cuando ticks_bloqueada es distinto de cero la tarea se encuantra en estado BLOCKED,
-     *   esto se lleva a cabo en la función SysTick_Handler().
-     *   En la rutina del SysTick cada vez que se entra decrementa en uno el valor del campo
-     *   ticks_bloqueada.
+     *   La tarea pasa a estado BLOCKED y se inserta ordenada en la lista de retardos (ver
+     *   os_setTicksTarea()). SysTick_Handler() solamente decrementa la primera tarea de esa
+     *   lista y la pasa a READY cuando llega a cero.
      *   Si la cantidad de ticks es dististo de cero, se pone el flag de TAREA_BLOCKED, y se
      *   fuerza un scheduling, esto se hace para no esperar hasta el próximo SysTick.
      *   Esta función no se puede llamar dentro de la atención de una interrupción.
@@ -197,13 +299,8 @@ void os_InitTarea(void *entryPoint, tarea *task, prioridadTarea prioridad)  {
 void tareaDelay(uint32_t cuentas) {
 
 	if(control_OS.estado_sistema!=OS_IRQ_RUN){
-		if (cuentas!=0){
-			irqOff();
-			control_OS.tarea_actual->ticks_bloqueada=cuentas;
-			control_OS.tarea_actual->estado=TAREA_BLOCKED;
-			irqOn();
-			os_Yield();
-			}
+		if (cuentas!=0)
+			os_LlamadaKernel(svcDelay, cuentas, 0);
 		}
 	else{
 		os_setError(ERR_DELAY_FROM_ISR,tareaDelay);			// Se produce un error
@@ -215,15 +312,23 @@ void tareaDelay(uint32_t cuentas) {
 	 *  @brief Función que lee el contador del sistema
      *
      *  @details
-     *   Esta variable se incrementa cada 1mseg
+     *   Esta variable se incrementa cada 1mseg. No deshabilita interrupciones: si SysTick la
+     *   modificó durante la lectura (cambió secuenciaTiempo) se vuelve a leer.
      *
 	 *  @param 		none
 	 *  @return     systemTicks
 ***************************************************************************************************/
 uint64_t os_getSytemTicks(void){
-	irqOff();
-	return systemTicks;
-	irqOn();
+	uint32_t secuencia;
+	uint64_t ticks;
+
+	do  {
+		secuencia=secuenciaTiempo;
+		__DMB();
+		ticks=systemTicks;
+		__DMB();
+	} while((secuencia & 1) || secuencia!=secuenciaTiempo);
+	return ticks;
 }
 
 
@@ -286,6 +391,224 @@ tarea* os_getTareaActual(void)  {
 	return control_OS.tarea_actual;
 }
 
+/*************************************************************************************************
+	 *  @brief Devuelve si la tarea tenía contexto de FPU.
+     *
+     *  @details
+     *   Se actualiza en cada cambio de contexto a partir del EXEC_RETURN guardado.
+     *
+	 *  @param 		task
+	 *  @return     true si el último contexto guardado de la tarea incluye la FPU.
+***************************************************************************************************/
+bool os_getTareaContextoFPU(tarea *task)  {
+	return task->contextoFPU;
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve el uso máximo de stack de una tarea.
+     *
+     *  @details
+     *   Recorre el stack desde el fondo mientras encuentra las guardas y el patrón con el que
+     *   se pintó en os_InitTareaStack(). Lo que queda por encima fue usado alguna vez. Sirve
+     *   para ajustar el tamaño de cada stack según lo medido.
+     *   Recorre todo el stack, por lo que no conviene llamarla en el camino crítico.
+     *
+	 *  @param 		task
+	 *  @return     Cantidad máxima de bytes del stack que usó la tarea.
+***************************************************************************************************/
+uint32_t os_getTareaStackMaximo(tarea *task)  {
+	uint32_t palabras = task->stack_size/4;
+	uint32_t libres = STACK_GUARDAS;
+
+	while(libres < palabras && task->stack[libres] == STACK_PATRON)
+		libres++;
+
+	return task->stack_size - libres*4;
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve el uso de CPU de una tarea.
+     *
+     *  @details
+     *   Los ciclos se le cargan a la tarea en cada cambio de contexto, sin contar los que
+     *   usaron las interrupciones instaladas con os_InstalarIRQ() mientras corría. Si la tarea
+     *   es la que está corriendo se suma el tramo en curso.
+     *   cambiosContexto son las veces que entró a ejecutarse y expropiaciones las que salió
+     *   estando lista (la desplazó otra tarea o el Round-Robin) en lugar de bloquearse.
+     *
+	 *  @param 		task, estadisticas		Donde se dejan los valores.
+	 *  @return     None.
+***************************************************************************************************/
+void os_getEstadisticasTarea(tarea *task, estadisticasTarea *estadisticas)  {
+	irqOff();
+	estadisticas->ciclos=task->ciclosEjecucion;
+	if(task==control_OS.tarea_actual)
+		estadisticas->ciclos+=ciclosEnCurso(os_getCiclos64());
+	estadisticas->cambiosContexto=task->cambiosContexto;
+	estadisticas->expropiaciones=task->expropiaciones;
+	irqOn();
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve la tarea idle.
+     *
+	 *  @param 		None.
+	 *  @return     Puntero a la tarea idle.
+***************************************************************************************************/
+tarea* os_getTareaIdle(void)  {
+	return &tareaIdle;
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve la carga de CPU.
+     *
+     *  @details
+     *   Es el porcentaje de la última ventana de OS_CARGA_VENTANA_TICKS en el que no corrió la
+     *   idleTask (tareas, kernel e interrupciones). Se actualiza en SysTick_Handler.
+     *
+	 *  @param 		None.
+	 *  @return     Carga de 0 a 100.
+***************************************************************************************************/
+uint8_t os_getCargaCPU(void)  {
+	return cargaCPU;
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve los ciclos usados por las interrupciones.
+     *
+	 *  @param 		None.
+	 *  @return     Ciclos acumulados desde os_Init().
+***************************************************************************************************/
+uint64_t os_getCiclosIRQ(void)  {
+	uint64_t ciclos;
+
+	irqOff();
+	ciclos=ciclosIRQ;
+	irqOn();
+	return ciclos;
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve el contador de ciclos de CPU.
+     *
+     *  @details
+     *   Es el contador del port (en el Cortex el registro CYCCNT del DWT). Si el port no tiene
+     *   contador (por ejemplo el DWT en un emulador) son los 32 bits bajos de os_getCiclos64().
+     *   Es de 32 bits: solo sirve para medir intervalos de menos de 2^32 ciclos.
+     *
+	 *  @param 		None.
+	 *  @return     Ciclos.
+***************************************************************************************************/
+uint32_t os_getCiclos(void)  {
+	uint32_t ciclos;
+
+	if(os_PortCiclos(&ciclos))
+		return ciclos;
+	return (uint32_t)os_getCiclos64();
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve los ciclos de CPU desde el arranque, en 64 bits.
+     *
+     *  @details
+     *   Con el contador del port (DWT) se lo extiende con baseCiclos, que SysTick_Handler
+     *   actualiza en cada tick (CYCCNT da la vuelta cada 2^32 ciclos, mucho más que un tick).
+     *   Sin él se combinan systemTicks y lo que transcurrió del tick en curso; si el tick ya
+     *   venció pero su interrupción está pendiente, el port suma el tick que falta.
+     *   No deshabilita interrupciones: si SysTick actualizó el tiempo durante la lectura se
+     *   vuelve a leer. El resultado es monótono y se puede llamar desde tareas e interrupciones.
+     *
+	 *  @param 		None.
+	 *  @return     Ciclos.
+***************************************************************************************************/
+uint64_t os_getCiclos64(void)  {
+	uint32_t secuencia, cuenta, pendiente;
+	uint64_t base;
+
+	do  {
+		secuencia=secuenciaTiempo;
+		__DMB();
+		if(os_PortCiclos(&cuenta))  {
+			base=baseCiclos;
+			base+=(uint32_t)(cuenta-(uint32_t)base);
+			}
+		else  {
+			cuenta=os_PortCiclosEnTick(&pendiente);
+			base=(systemTicks+pendiente)*ciclosPorTick + cuenta;
+			}
+		__DMB();
+	} while((secuencia & 1) || secuencia!=secuenciaTiempo);
+
+	return base;
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve el tiempo desde el arranque en nanosegundos.
+     *
+	 *  @param 		None.
+	 *  @return     Nanosegundos, con la resolución de un ciclo.
+***************************************************************************************************/
+uint64_t os_getTiempoNs(void)  {
+	return os_CiclosANs(os_getCiclos64());
+}
+
+/*************************************************************************************************
+	 *  @brief Convierte ciclos de CPU a nanosegundos.
+     *
+     *  @details
+     *   Se separan los segundos enteros para que la multiplicación no desborde.
+     *
+	 *  @param 		ciclos.
+	 *  @return     Nanosegundos.
+***************************************************************************************************/
+uint64_t os_CiclosANs(uint64_t ciclos)  {
+	uint32_t frecuencia=SystemCoreClock;
+
+	return (ciclos/frecuencia)*1000000000ULL + ((ciclos%frecuencia)*1000000000ULL)/frecuencia;
+}
+
+/*************************************************************************************************
+	 *  @brief Convierte ciclos de CPU a microsegundos.
+     *
+	 *  @param 		ciclos.
+	 *  @return     Microsegundos.
+***************************************************************************************************/
+uint64_t os_CiclosAUs(uint64_t ciclos)  {
+	uint32_t frecuencia=SystemCoreClock;
+
+	return (ciclos/frecuencia)*1000000ULL + ((ciclos%frecuencia)*1000000ULL)/frecuencia;
+}
+
+/*************************************************************************************************
+	 *  @brief Convierte nanosegundos a ciclos de CPU.
+     *
+	 *  @param 		ns.
+	 *  @return     Ciclos.
+***************************************************************************************************/
+uint64_t os_NsACiclos(uint64_t ns)  {
+	uint32_t frecuencia=SystemCoreClock;
+
+	return (ns/1000000000ULL)*frecuencia + ((ns%1000000000ULL)*frecuencia)/1000000000ULL;
+}
+
+/*************************************************************************************************
+	 *  @brief Suma los ciclos que usó una interrupción.
+     *
+     *  @details
+     *   La llama os_IRQHandler() al terminar la interrupción más externa. Esos ciclos no se le
+     *   cargan a la tarea interrumpida.
+     *
+	 *  @param 		ciclos.
+	 *  @return     None.
+***************************************************************************************************/
+void os_SumarCiclosIRQ(uint32_t ciclos)  {
+	uint32_t estado;
+
+	estado=irqOffGuardar();
+	ciclosIRQ+=ciclos;
+	irqRestaurar(estado);
+}
+
 
 /*************************************************************************************************
 	 *  @brief Busca la cantidad de tareas que hay en una prioridad determinada.
@@ -367,6 +690,8 @@ int8_t os_getPrioridadMin(void){
      *  Cambia la prioridad de una tarea.
      *  Si la tarea se encuentra en RUNNIG la PRIORIDAD no se cambia. O sea una tarea
      *  no puede cambiar su PRIORIDAD.
+     *  Se cambia la prioridad base. Si la tarea tiene mutex tomados conserva la prioridad
+     *  heredada mientras sea mayor, y la base se recupera al liberar el último.
      *
 	 *  @param 		area *task, uint8_t prioridad
 	 *  @return     None.
@@ -374,24 +699,106 @@ int8_t os_getPrioridadMin(void){
 void os_setTareaPrioridad(tarea *task, uint8_t prioridad){
 	while(true){
 		if(task->estado!=TAREA_RUNNING){
-				task->prioridad = prioridad;
-		return;
+			irqOff();
+			task->prioridadBase = prioridad;
+			if(task->mutexTomados==0 || prioridad<task->prioridad)
+				os_setTareaPrioridadEfectiva(task, prioridad);
+			irqOn();
+			return;
 		}
 	}
 }
 
+/*************************************************************************************************
+	 *  @brief Cambia la prioridad efectiva de una tarea.
+     *
+     *  @details
+     *  La usan los mutex para la herencia de prioridad, por lo que a diferencia de
+     *  os_setTareaPrioridad() funciona en cualquier estado: si la tarea está READY o RUNNING se
+     *  la mueve a la lista READY de la nueva prioridad, y si está esperando en una listaEspera
+     *  se la reubica en ella. No cambia la prioridad base.
+     *  Se debe llamar con las interrupciones deshabilitadas (irqOff()), y luego al scheduler.
+     *
+	 *  @param 		tarea *task, uint8_t prioridad
+	 *  @return     None.
+***************************************************************************************************/
+void os_setTareaPrioridadEfectiva(tarea *task, uint8_t prioridad){
+	listaEspera *lista;
+
+	if(task->prioridad==prioridad)
+		return;
+
+	if(task->estado==TAREA_READY || task->estado==TAREA_RUNNING){
+		listaReadyQuitar(task);
+		task->prioridad = prioridad;
+		listaReadyAgregar(task);
+		}
+	else if(task->esperando!=NULL){
+		lista=task->esperando;
+		listaEsperaQuitar(task);
+		task->prioridad = prioridad;
+		listaEsperaAgregar(lista, task);
+		}
+	else
+		task->prioridad = prioridad;
+}
+
 
 /*************************************************************************************************
 	 *  @brief Setea los ticks de bloqueo.
      *
      *  @details
      *  Si una tarea tiene ticks_de_bloqueo distinto de cero, la tarea permanecerá BLOQUEADA.
+     *  Con TICKS_ON queda bloqueada por tiempo indefinido (hasta que otro la pase a READY), con
+     *  TICKS_OFF pasa a READY y con cualquier otro valor se la inserta en la lista de retardos.
+     *  Se debe llamar con las interrupciones deshabilitadas (irqOff()).
      *
-	 *  @param 		area *task, uint8_t prioridad
+	 *  @param 		area *task, uint32_t ticks_de_bloqueo
 	 *  @return     None.
 ***************************************************************************************************/
 void os_setTicksTarea (tarea *task, uint32_t ticks_de_bloqueo){
-	task->ticks_bloqueada=ticks_de_bloqueo;
+	if(ticks_de_bloqueo==TICKS_OFF){
+		os_setTareaEstado(task, TAREA_READY);
+		return;
+		}
+
+	os_setTareaEstado(task, TAREA_BLOCKED);		// Queda con TICKS_ON
+	if(ticks_de_bloqueo!=TICKS_ON)
+		listaDelayAgregar(task, ticks_de_bloqueo);
+}
+
+/*************************************************************************************************
+	 *  @brief Declara si una tarea usa la FPU.
+     *
+     *  @details
+     *  Las tareas arrancan sin contexto de FPU, y solo lo adquieren cuando ejecutan una
+     *  instrucción de punto flotante. Desde ese momento cada cambio de contexto les cuesta
+     *  guardar y recuperar S0-S31 y FPSCR, y FPU_STACKING_SIZE palabras más de stack.
+     *  Esta función documenta qué tareas tienen presupuestado ese costo. Con OS_CHEQUEO_FPU en
+     *  1 getContextoSiguiente() llama a errorHook si una tarea no habilitada deja contexto de
+     *  FPU, lo que permite dimensionar el stack de las tareas enteras sin ese margen.
+     *
+	 *  @param 		tarea *task, bool habilitada
+	 *  @return     None.
+***************************************************************************************************/
+void os_setTareaFPU(tarea *task, bool habilitada){
+	task->fpuHabilitada=habilitada;
+}
+
+/*************************************************************************************************
+	 *  @brief Descarta el contexto de FPU de la tarea actual.
+     *
+     *  @details
+     *  Una tarea que usa la FPU solo en una parte de su código puede llamar a esta función al
+     *  terminar esa parte. Se borra CONTROL.FPCA, por lo que los próximos cambios de contexto
+     *  de la tarea vuelven a ser sin FPU (no se guarda ni recupera S0-S31). Los valores de los
+     *  registros de la FPU se pierden, por lo que no debe haber cálculos en curso.
+     *
+	 *  @param 		None
+	 *  @return     None.
+***************************************************************************************************/
+void os_TareaLiberarFPU(void){
+	os_PortLiberarFPU();
 }
 
 /*************************************************************************************************
@@ -416,6 +823,9 @@ void os_setEstadoSistema(estadoOS estado)  {
      *
      *  @details
      *  Cambia el estado de una tarea, y el ticks de bloqueo.
+     *  Es el único punto donde una tarea entra o sale de las listas READY, por lo que todo
+     *  cambio entre TAREA_READY/TAREA_RUNNING y TAREA_BLOCKED debe pasar por esta función.
+     *  Se debe llamar con las interrupciones deshabilitadas (irqOff()).
      *
 	 *  @param 		tarea *task, estadoTarea estado
 	 *  @return     None.
@@ -423,11 +833,22 @@ void os_setEstadoSistema(estadoOS estado)  {
 void os_setTareaEstado(tarea *task, estadoTarea estado){
 	if(estado==TAREA_BLOCKED){
 		task->ticks_bloqueada=TICKS_ON;
+		if(task->estado==TAREA_READY || task->estado==TAREA_RUNNING)
+			listaReadyQuitar(task);
 		task->estado = TAREA_BLOCKED;
 		}
 	if(estado==TAREA_READY){
+		// Si se la libera antes de que venza su timeout se la quita de la lista de retardos
+		listaDelayQuitar(task);
+		// Si venció el timeout esperando un objeto se la quita de su lista de espera
+		if(task->esperando!=NULL)
+			listaEsperaQuitar(task);
 		task->ticks_bloqueada=TICKS_OFF;
-		task->estado = TAREA_READY;
+		// Una tarea RUNNING ya está en su lista y sigue corriendo
+		if(task->estado!=TAREA_READY && task->estado!=TAREA_RUNNING){
+			task->estado = TAREA_READY;
+			listaReadyAgregar(task);
+			}
 	}
 }
 
@@ -439,12 +860,67 @@ void os_setTareaEstado(tarea *task, estadoTarea estado){
      *   En los casos que un delay de una tarea comience a ejecutarse instantes luego de que
      *   ocurriese un scheduling, se despericia mucho tiempo hasta el próximo tick de sistema,
      *   por lo que se fuerza un scheduling y un cambio de contexto si es necesario.
+     *   Desde una tarea se entra al kernel por SVC; desde una interrupción se llama
+     *   directamente al scheduler.
      *
 	 *  @param 		None
 	 *  @return     None.
 ***************************************************************************************************/
 void os_Yield(void)  {
-	scheduler();
+	os_LlamadaKernel(svcYield, 0, 0);
+}
+
+/*************************************************************************************************
+	 *  @brief Inicializa una lista de espera.
+     *
+	 *  @param 		lista
+	 *  @return     None.
+***************************************************************************************************/
+void os_EsperaInit(listaEspera *lista)  {
+	lista->primera=NULL;
+	lista->propietario=NULL;
+}
+
+/*************************************************************************************************
+	 *  @brief Bloquea una tarea en una lista de espera.
+     *
+     *  @details
+     *   La tarea se inserta ordenada por prioridad y queda BLOCKED. Con ticks distinto de
+     *   TICKS_ON además se la inserta en la lista de retardos; si vence el tiempo
+     *   SysTick_Handler la pasa a READY, os_setTareaEstado() la saca de la lista de espera y
+     *   resultadoEspera queda en ESPERA_TIMEOUT.
+     *   Si la lista tiene propietario (un mutex) éste hereda la prioridad de la tarea, y la
+     *   herencia se propaga si el propietario a su vez espera otro mutex.
+     *   Se debe llamar con las interrupciones deshabilitadas y ticks distinto de TICKS_OFF.
+     *
+	 *  @param 		lista, task, ticks
+	 *  @return     None.
+***************************************************************************************************/
+void os_EsperaBloquear(listaEspera *lista, tarea *task, uint32_t ticks)  {
+	os_setTicksTarea(task, ticks);
+	task->resultadoEspera=ESPERA_TIMEOUT;
+	listaEsperaAgregar(lista, task);
+	heredarPrioridad(lista, task->prioridad);
+}
+
+/*************************************************************************************************
+	 *  @brief Despierta la tarea de mayor prioridad de una lista de espera.
+     *
+     *  @details
+     *   La tarea pasa a READY con el resultado indicado. Se debe llamar con las interrupciones
+     *   deshabilitadas, y luego al scheduler.
+     *
+	 *  @param 		lista, resultado
+	 *  @return     La tarea despertada, o NULL si no había ninguna esperando.
+***************************************************************************************************/
+tarea* os_EsperaDespertar(listaEspera *lista, uint32_t resultado)  {
+	tarea *task=lista->primera;
+
+	if(task!=NULL){
+		task->resultadoEspera=resultado;
+		os_setTareaEstado(task, TAREA_READY);		// La quita de la lista de espera
+		}
+	return task;
 }
 
 /*************************************************************************************************
@@ -452,62 +928,125 @@ void os_Yield(void)  {
      *
      *  @details
      *   Sirve cuando se desea proteger una parte crítica del código. No olvidarse habilitar.
-     *   No se lleva la cuenta de cuantas veces se llama a esta función. Se supone que se la
-     *   convoca una vez, y luego de una porci{on de c{odigo no muy extensa se llama a la
-     *   funci{on irqOn().
+     *   Las llamadas se pueden anidar: se lleva la cuenta y solo el irqOn() que cierra la
+     *   sección más externa restaura el BASEPRI que había al entrar.
+     *   Solo se enmascaran las interrupciones de prioridad OS_IRQ_PRIORIDAD_KERNEL o menor
+     *   (BASEPRI), las de mayor prioridad siguen atendiéndose sin latencia agregada.
+     *   Dentro de la sección crítica no se puede ejecutar SVC (os_LlamadaKernel()).
      *
 	 *  @param 		none.
 	 *  @return     None.
 ***************************************************************************************************/
 void irqOff(void) {
-	__asm("cpsid i");
-	//__asm("cpsie i");
+	uint32_t estado=irqOffGuardar();
+
+	if(anidamientoCritico++==0)
+		basepriCritico=estado;
 }
 
 /*************************************************************************************************
 	 *  @brief Función que se utiliza para habilitar las interrupciones
      *
      *  @details
-     *   Sirve cuando se desea proteger una parte crítica del código.
+     *   Cierra la sección crítica abierta con irqOff(). Un irqOn() sin irqOff() previo no
+     *   tiene efecto.
      *
 	 *  @param 		none.
 	 *  @return     None.
 ***************************************************************************************************/
 void irqOn(void) {
-	 //__asm("cpsid i");
-	__asm("cpsie i");
+	if(anidamientoCritico==0)
+		return;
+	if(--anidamientoCritico==0)
+		irqRestaurar(basepriCritico);
 }
 
-/*================[Funciones internas del Sistema Operativo]==========================*/
-
+#if OS_TICKLESS_IDLE
 /*************************************************************************************************
-	 *  @brief setPendSV Handler.
+	 *  @brief Duerme el procesador sin ticks hasta el próximo vencimiento.
      *
      *  @details
-     *  Dentro se setea como pendiente la excepcion PendSV.
+     *   Se llama desde idleTask. Si todas las tareas del usuario están bloqueadas, se calcula
+     *   cuántos ticks faltan para que venza la primera tarea de la lista de retardos y el port
+     *   duerme sin interrupciones de tick (os_PortDormirTicks()) como máximo ese tiempo. Si
+     *   el port no puede dormir tanto de una vez, idleTask vuelve a llamar a esta función en
+     *   su lazo.
+     *   Al despertar se corrigen systemTicks y la primera tarea de la lista de retardos con los
+     *   ticks completos que pasaron; el port reprograma el tick para que el reloj del sistema
+     *   no derive.
+     *   Las interrupciones se deshabilitan con os_PortIrqDeshabilitar() y no con irqOff(): en
+     *   el Cortex una interrupción enmascarada por BASEPRI no despierta a __WFI, con PRIMASK
+     *   sí. Las pendientes se atienden al volver a habilitarlas. tickHook no se ejecuta para
+     *   los ticks suprimidos.
      *
 	 *  @param 		None.
 	 *  @return     None.
 ***************************************************************************************************/
-void setPendSV(void)  {
+void os_IdleSinTick(void)  {
+	uint32_t ticksEsperados, completos;
 
-	/**
-	 * Se setea el bit correspondiente a la excepción PendSV
-	 * Habilita para que pueda ser llamada la PendSV
-	 */
-	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	os_PortIrqDeshabilitar();
 
-	/**
-	 * Instruction Synchronization Barrier; flushes the pipeline and ensures that
-	 * all previous instructions are completed before executing new instructions
+	/*
+	 * Si hay alguna tarea del usuario READY (cualquier bit distinto del de la idleTask) o si
+	 * falta poco para el próximo vencimiento no se duerme sin tick.
 	 */
-	__ISB();
+	ticksEsperados=(control_OS.primeraDelay!=NULL) ? control_OS.primeraDelay->ticks_bloqueada : TICKS_ON;
 
-	/**
-	 * Data Synchronization Barrier; ensures that all memory accesses are
-	 * completed before next instruction is executed
-	 */
-	__DSB();
+	if((control_OS.mapaReady & ~(1UL << (31-PRIORITY_COUNT))) != 0 ||
+			ticksEsperados<OS_TICKLESS_MIN_TICKS)  {
+		os_PortEsperarIrq();
+		os_PortIrqHabilitar();
+		return;
+		}
+
+	completos=os_PortDormirTicks(ticksEsperados);
+
+	// Corrección del reloj del sistema y de la primera tarea de la lista de retardos
+	if(completos!=0)  {
+		secuenciaTiempo++;
+		systemTicks+=completos;
+		secuenciaTiempo++;
+		if(control_OS.primeraDelay!=NULL)
+			control_OS.primeraDelay->ticks_bloqueada-=completos;
+		}
+
+	os_PortIrqHabilitar();
+}
+#endif
+
+/*================[Funciones internas del Sistema Operativo]==========================*/
+
+/*************************************************************************************************
+	 *  @brief Función del kernel de os_Yield().
+     *
+	 *  @param 		No se usan.
+	 *  @return     0.
+***************************************************************************************************/
+static uintptr_t svcYield(uintptr_t arg0, uintptr_t arg1)  {
+	(void)arg0;
+	(void)arg1;
+	scheduler();
+	return 0;
+}
+
+/*************************************************************************************************
+	 *  @brief Función del kernel de tareaDelay().
+     *
+     *  @details
+     *   Bloquea la tarea actual la cantidad de ticks pedida y llama al scheduler. El cambio de
+     *   contexto se hace al salir del SVC.
+     *
+	 *  @param 		cuentas		Cantidad de ticks.
+	 *  @return     0.
+***************************************************************************************************/
+static uintptr_t svcDelay(uintptr_t cuentas, uintptr_t arg1)  {
+	(void)arg1;
+	irqOff();
+	os_setTicksTarea(control_OS.tarea_actual, cuentas);
+	irqOn();
+	scheduler();
+	return 0;
 }
 
 /*************************************************************************************************
@@ -518,15 +1057,27 @@ void setPendSV(void)  {
      *   contexto a ser cargado. El cambio de contexto se ejecuta en el handler de PendSV, dentro
      *   del cual se llama a esta funcion
      *
-	 *  @param 		sp_actual	Este valor es una copia del contenido de MSP al momento en
-	 *  			que la funcion es invocada.
-	 *  @return     El valor a cargar en MSP para apuntar al contexto de la tarea siguiente.
+	 *  @param 		sp_actual	Este valor es una copia del contenido de PSP al momento en
+	 *  			que la funcion es invocada (cero en el arranque del sistema).
+	 *  @return     El valor a cargar en PSP para apuntar al contexto de la tarea siguiente.
 ***************************************************************************************************/
-uint32_t getContextoSiguiente(uint32_t sp_actual)  {
-	uint32_t sp_siguiente;
+uintptr_t getContextoSiguiente(uintptr_t sp_actual)  {
+	uintptr_t sp_siguiente;
+	tarea *anterior=control_OS.tarea_actual;
+	uint64_t ahora=os_getCiclos64();
+
+	/*
+	 * Si entre la elección del scheduler y este cambio de contexto una interrupción despertó
+	 * una tarea, su scheduling quedó pendiente (scheduler() volvió sin hacerlo). Se vuelve a
+	 * elegir la tarea siguiente. PendSV_Handler ya enmascaró las interrupciones del kernel.
+	 */
+	if(control_OS.schedulingPendiente)  {
+		control_OS.schedulingPendiente=false;
+		elegirTareaSiguiente();
+	}
 
 	/*
-	 * Esta funcion efectua el cambio de contexto. Se guarda el MSP (sp_actual) en la variable
+	 * Esta funcion efectua el cambio de contexto. Se guarda el PSP (sp_actual) en la variable
 	 * correspondiente de la estructura de la tarea corriendo actualmente. El estado de la tarea
 	 * actual fue modificado por el módulo SysTick_Handler(), el cual pasa todas las tereas a
 	 * RUNNING si el contador de ticks de bloqueo se encuentran en cero.
@@ -535,12 +1086,55 @@ uint32_t getContextoSiguiente(uint32_t sp_actual)  {
 	 * y se retorna al handler de PendSV
 	 */
 
-	control_OS.tarea_actual->stack_pointer = sp_actual;
+	// En el arranque (desde os_Init) no hay tarea saliente
+	if(control_OS.tarea_actual != NULL)  {
+		control_OS.tarea_actual->stack_pointer = sp_actual;
+
+		/*
+		 * Seguimiento de la FPU por tarea: en el Cortex el EXEC_RETURN guardado por PendSV
+		 * sobre R4-R11 indica si el contexto de la tarea incluye la FPU.
+		 */
+		control_OS.tarea_actual->contextoFPU = os_PortContextoFPU(sp_actual);
+		if(control_OS.tarea_actual->contextoFPU)  {
+			control_OS.tarea_actual->cambiosFPU++;
+#if OS_CHEQUEO_FPU
+			if(!control_OS.tarea_actual->fpuHabilitada)
+				os_setError(ERR_OS_FPU_NO_HABILITADA, control_OS.tarea_actual->entry_point);
+#endif
+		}
+
+#if OS_CHEQUEO_STACK
+		/*
+		 * La tarea desbordó su stack si el contexto recién guardado quedó sobre las guardas
+		 * o si alguna de ellas fue pisada.
+		 */
+		if(sp_actual < (uintptr_t)(control_OS.tarea_actual->stack + STACK_GUARDAS) ||
+		   control_OS.tarea_actual->stack[0] != STACK_CANARIO ||
+		   control_OS.tarea_actual->stack[STACK_GUARDAS-1] != STACK_CANARIO)
+			os_setError(ERR_OS_STACK_DESBORDE, control_OS.tarea_actual->entry_point);
+#endif
+
+		// Se le cargan los ciclos que corrió, descontando los de las interrupciones
+		control_OS.tarea_actual->ciclosEjecucion += ciclosEnCurso(ahora);
+
+		// Si la tarea saliente no se bloqueó sigue en su lista READY: fue expropiada
+		if(control_OS.tarea_actual->estado == TAREA_RUNNING)  {
+			control_OS.tarea_actual->estado = TAREA_READY;
+			if(control_OS.tarea_actual != control_OS.tarea_siguiente)
+				control_OS.tarea_actual->expropiaciones++;
+		}
+	}
 
 	// Se cambia a la tarea siguiente
 	sp_siguiente = control_OS.tarea_siguiente->stack_pointer;
 	control_OS.tarea_actual = control_OS.tarea_siguiente;
 	control_OS.tarea_actual->estado = TAREA_RUNNING;
+	if(control_OS.tarea_actual != anterior)
+		control_OS.tarea_actual->cambiosContexto++;
+	inicioEjecucion=ahora;
+	ciclosIRQInicio=ciclosIRQ;
+	OS_TRAZA_EVENTO(TRAZA_CAMBIO_CONTEXTO, control_OS.tarea_actual,
+			(anterior!=NULL) ? anterior->id : OS_TRAZA_SIN_TAREA);
 
 	/*
 	 * Indicamos que luego de retornar de esta funcion, ya no es necesario un cambio de contexto
@@ -563,31 +1157,45 @@ uint32_t getContextoSiguiente(uint32_t sp_actual)  {
 	 *  @return     None.
 ***************************************************************************************************/
 void SysTick_Handler(void)  {
-	tarea *task_aux;		//variable auxiliar
-
+	uint32_t estado, cuenta;
 
-	// Incrementa el el reloj del sistema
+	/*
+	 * Incrementa el el reloj del sistema. Las lecturas no deshabilitan interrupciones, ven
+	 * secuenciaTiempo impar o cambiada y reintentan. La actualización se protege de las
+	 * interrupciones que podrían leer el tiempo a medio escribir.
+	 */
+	estado=irqOffGuardar();
+	secuenciaTiempo++;
 	systemTicks++;
+	if(os_PortCiclos(&cuenta))
+		baseCiclos+=(uint32_t)(cuenta-(uint32_t)baseCiclos);
+	secuenciaTiempo++;
+	irqRestaurar(estado);
+
+	// Hasta que os_Init() lance la primer tarea solo se cuenta el tiempo
+	if(control_OS.estado_sistema==OS_FROM_RESET)
+		return;
+
+	OS_TRAZA_EVENTO(TRAZA_TICK, control_OS.tarea_actual, systemTicks);
+
+	if(systemTicks-ventanaTicks >= OS_CARGA_VENTANA_TICKS)
+		actualizarCarga();
 
 	/*
-	 * Actualiza ticks_bloqueada de cada tarea y si tienen un valor de ticks  mayor a cero,
-	 * se decrementan en una unidad. Si este contador llega a cero, entonces se debe pasar
-	 * la tarea a READY. Si la tarea se encuentra en RUNNING y se setea un ticks de bloqueo
-	 * mayor que cero, esta parte del código la pasa a estado BLOQUED, pero estrictamente
-	 * deja de correr cuando se produzca el cambio de contexto en la función:
-	 * getContextoSiguiente()
+	 * Las tareas bloqueadas con timeout están en control_OS.primeraDelay ordenadas por
+	 * vencimiento, y cada una guarda en ticks_bloqueada la diferencia con la anterior. Por eso
+	 * solo se decrementa la primera, y se pasan a READY todas las que quedan en cero (las que
+	 * vencen en este mismo tick). Las tareas con TICKS_ON (bloqueadas por tiempo indefinido)
+	 * no están en la lista.
 	 */
 
-	for(uint8_t id_tarea=0;id_tarea<control_OS.cantidad_Tareas+1;id_tarea++) {
-		task_aux =(tarea*)control_OS.listaTareas[id_tarea];
-		if (  task_aux->ticks_bloqueada != TICKS_OFF ) {
-			task_aux->ticks_bloqueada--;
-			task_aux->estado=TAREA_BLOCKED;
-			}
-		else{
-			task_aux->estado=TAREA_READY;
-	    }
-	}
+	irqOff();
+	if(control_OS.primeraDelay!=NULL){
+		control_OS.primeraDelay->ticks_bloqueada--;
+		while(control_OS.primeraDelay!=NULL && control_OS.primeraDelay->ticks_bloqueada==0)
+			os_setTareaEstado(control_OS.primeraDelay, TAREA_READY);
+		}
+	irqOn();
 
 	/*
 	 * Dentro del SysTick handler se llama al scheduler. Separar el scheduler de
@@ -629,37 +1237,240 @@ uint8_t busqueda(uint8_t prioridadScan, estadoTarea estadoT) {
 }
 
 /*************************************************************************************************
-	 *  @brief roundRobin.
+	 *  @brief Agrega una tarea al final de la lista READY de su prioridad.
+     *
+     *  @details
+     *  Cada prioridad tiene una lista FIFO doblemente enlazada de tareas READY (y la RUNNING).
+     *  Además se mantiene control_OS.mapaReady, donde el bit (31-prioridad) indica que esa
+     *  lista no está vacía, de manera que la prioridad más alta con tareas listas se obtiene
+     *  con una sola instrucción CLZ. Se debe llamar con las interrupciones deshabilitadas.
+     *
+	 *  @param 		tarea *task.
+	 *  @return     None.
+***************************************************************************************************/
+static void listaReadyAgregar(tarea *task) {
+	uint8_t prioridad=task->prioridad;
+
+	task->siguienteReady=NULL;
+	task->anteriorReady=control_OS.ultimaReady[prioridad];
+	if(control_OS.ultimaReady[prioridad]!=NULL)
+		control_OS.ultimaReady[prioridad]->siguienteReady=task;
+	else
+		control_OS.primeraReady[prioridad]=task;
+	control_OS.ultimaReady[prioridad]=task;
+
+	control_OS.mapaReady |= (1UL << (31-prioridad));
+}
+
+/*************************************************************************************************
+	 *  @brief Quita una tarea de la lista READY de su prioridad.
      *
      *  @details
-     *  Realiza La política de scheduling Round-Robin entre tareas de la misma prioridad.
-     *  Devuelve la próxima id_tarea a ejecutarse.
+     *  Es O(1) por ser una lista doblemente enlazada. Si la lista queda vacía se borra el bit
+     *  de esa prioridad en control_OS.mapaReady. Se debe llamar con las interrupciones
+     *  deshabilitadas.
      *
-	 *  @param 		(prioridadTarea scanPrioridad,uint8_t id_tarea).
-	 *  @return     id_tarea.
+	 *  @param 		tarea *task.
+	 *  @return     None.
 ***************************************************************************************************/
-uint8_t roundRobin(prioridadTarea scanPrioridad,uint8_t id_tarea) {
-	static prioridadTarea scanPrioridad_old=0;
-	tarea *task_aux;				//variable auxiliar
+static void listaReadyQuitar(tarea *task) {
+	uint8_t prioridad=task->prioridad;
 
-	if(scanPrioridad!=scanPrioridad_old || id_tarea>=control_OS.cantidad_Tareas+1){
-		id_tarea=0;
-	}
-	while(true){
-		task_aux =(tarea*)control_OS.listaTareas[id_tarea];
-		if(task_aux->prioridad==scanPrioridad && task_aux->estado==TAREA_READY){
-			control_OS.tarea_siguiente=control_OS.listaTareas[id_tarea];
-			id_tarea++;
+	if(task->anteriorReady!=NULL)
+		task->anteriorReady->siguienteReady=task->siguienteReady;
+	else
+		control_OS.primeraReady[prioridad]=task->siguienteReady;
+
+	if(task->siguienteReady!=NULL)
+		task->siguienteReady->anteriorReady=task->anteriorReady;
+	else
+		control_OS.ultimaReady[prioridad]=task->anteriorReady;
+
+	task->anteriorReady=NULL;
+	task->siguienteReady=NULL;
+
+	if(control_OS.primeraReady[prioridad]==NULL)
+		control_OS.mapaReady &= ~(1UL << (31-prioridad));
+}
+
+/*************************************************************************************************
+	 *  @brief Inserta una tarea en la lista de retardos.
+     *
+     *  @details
+     *  La lista está ordenada por vencimiento y cada tarea guarda en ticks_bloqueada los ticks
+     *  que faltan luego de que venza la anterior. Se recorre restando los deltas hasta encontrar
+     *  la posición, y se descuenta el delta de la tarea insertada a la que queda detrás. Las
+     *  tareas con igual vencimiento quedan en orden FIFO. Se debe llamar con las interrupciones
+     *  deshabilitadas.
+     *
+	 *  @param 		tarea *task, uint32_t ticks (distinto de TICKS_OFF y TICKS_ON).
+	 *  @return     None.
+***************************************************************************************************/
+static void listaDelayAgregar(tarea *task, uint32_t ticks) {
+	tarea *anterior=NULL;
+	tarea *siguiente=control_OS.primeraDelay;
+
+	while(siguiente!=NULL && siguiente->ticks_bloqueada<=ticks){
+		ticks-=siguiente->ticks_bloqueada;
+		anterior=siguiente;
+		siguiente=siguiente->siguienteDelay;
+		}
+
+	task->ticks_bloqueada=ticks;
+	task->anteriorDelay=anterior;
+	task->siguienteDelay=siguiente;
+
+	if(anterior!=NULL)
+		anterior->siguienteDelay=task;
+	else
+		control_OS.primeraDelay=task;
+
+	if(siguiente!=NULL){
+		siguiente->anteriorDelay=task;
+		siguiente->ticks_bloqueada-=ticks;
+		}
+}
+
+/*************************************************************************************************
+	 *  @brief Quita una tarea de la lista de retardos.
+     *
+     *  @details
+     *  Si la tarea no está en la lista no hace nada. Los ticks que le faltaban se suman a la
+     *  tarea siguiente para no adelantar su vencimiento. Se debe llamar con las interrupciones
+     *  deshabilitadas.
+     *
+	 *  @param 		tarea *task.
+	 *  @return     None.
+***************************************************************************************************/
+static void listaDelayQuitar(tarea *task) {
+	if(task->anteriorDelay==NULL && control_OS.primeraDelay!=task)
+		return;
+
+	if(task->siguienteDelay!=NULL){
+		task->siguienteDelay->ticks_bloqueada+=task->ticks_bloqueada;
+		task->siguienteDelay->anteriorDelay=task->anteriorDelay;
+		}
+
+	if(task->anteriorDelay!=NULL)
+		task->anteriorDelay->siguienteDelay=task->siguienteDelay;
+	else
+		control_OS.primeraDelay=task->siguienteDelay;
+
+	task->anteriorDelay=NULL;
+	task->siguienteDelay=NULL;
+}
+
+/*************************************************************************************************
+	 *  @brief Inserta una tarea en una lista de espera.
+     *
+     *  @details
+     *  Queda detrás de las tareas de igual o mayor prioridad. Se debe llamar con las
+     *  interrupciones deshabilitadas.
+     *
+	 *  @param 		lista, task.
+	 *  @return     None.
+***************************************************************************************************/
+static void listaEsperaAgregar(listaEspera *lista, tarea *task) {
+	tarea **enlace=&lista->primera;
+
+	while(*enlace!=NULL && (*enlace)->prioridad<=task->prioridad)
+		enlace=&(*enlace)->siguienteEspera;
+
+	task->siguienteEspera=*enlace;
+	*enlace=task;
+	task->esperando=lista;
+}
+
+/*************************************************************************************************
+	 *  @brief Quita una tarea de la lista de espera en la que está.
+     *
+     *  @details
+     *  Se debe llamar con las interrupciones deshabilitadas.
+     *
+	 *  @param 		task.
+	 *  @return     None.
+***************************************************************************************************/
+static void listaEsperaQuitar(tarea *task) {
+	tarea **enlace=&task->esperando->primera;
+
+	while(*enlace!=NULL && *enlace!=task)
+		enlace=&(*enlace)->siguienteEspera;
+
+	if(*enlace!=NULL)
+		*enlace=task->siguienteEspera;
+
+	task->siguienteEspera=NULL;
+	task->esperando=NULL;
+}
+
+/*************************************************************************************************
+	 *  @brief Herencia de prioridad.
+     *
+     *  @details
+     *  El propietario de la lista (si lo hay) pasa a tener la prioridad de la tarea que espera
+     *  cuando ésta es mayor. Si el propietario está a su vez esperando otro mutex se repite
+     *  con el propietario de éste. La cadena no puede ser más larga que la cantidad de tareas.
+     *  Se debe llamar con las interrupciones deshabilitadas.
+     *
+	 *  @param 		lista, prioridad.
+	 *  @return     None.
+***************************************************************************************************/
+static void heredarPrioridad(listaEspera *lista, uint8_t prioridad) {
+	uint8_t saltos=MAX_TASK_COUNT;
+
+	while(lista!=NULL && lista->propietario!=NULL && saltos>0){
+		if(prioridad>=lista->propietario->prioridad)
 			break;
-			}
-		else{
-			id_tarea++;
-			if(id_tarea>=control_OS.cantidad_Tareas+1) id_tarea=0;
+		os_setTareaPrioridadEfectiva(lista->propietario, prioridad);
+		lista=lista->propietario->esperando;
+		saltos--;
 		}
-	}
+}
 
-	scanPrioridad_old=scanPrioridad;
-	return id_tarea;
+/*************************************************************************************************
+	 *  @brief Ciclos que lleva corriendo la tarea actual.
+     *
+     *  @details
+     *   Desde que entró a ejecutarse, descontando los de las interrupciones. Se debe llamar con
+     *   las interrupciones deshabilitadas.
+     *
+	 *  @param 		ahora		Valor actual de os_getCiclos64().
+	 *  @return     Ciclos.
+***************************************************************************************************/
+static uint64_t ciclosEnCurso(uint64_t ahora)  {
+	return (ahora-inicioEjecucion) - (ciclosIRQ-ciclosIRQInicio);
+}
+
+/*************************************************************************************************
+	 *  @brief Calcula la carga de CPU de la ventana que termina.
+     *
+     *  @details
+     *   Se llama desde SysTick_Handler cada OS_CARGA_VENTANA_TICKS. La carga es la parte de la
+     *   ventana en la que no corrió la idleTask; si la idleTask está corriendo se cuenta el
+     *   tramo en curso. Se cuenta en 64 bits, por lo que la ventana puede durar más de 2^32
+     *   ciclos.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void actualizarCarga(void)  {
+	uint64_t ahora, total, libre, idle;
+
+	irqOff();
+	ahora=os_getCiclos64();
+	idle=tareaIdle.ciclosEjecucion;
+	if(control_OS.tarea_actual==&tareaIdle)
+		idle+=ciclosEnCurso(ahora);
+
+	total=ahora-ventanaCiclos;
+	libre=idle-ventanaIdle;
+	if(total>0 && libre<=total)
+		cargaCPU=100-(uint8_t)((libre*100)/total);
+
+	ventanaTicks=systemTicks;
+	ventanaCiclos=ahora;
+	ventanaIdle=idle;
+	irqOn();
 }
 
 /*************************************************************************************************
@@ -667,23 +1478,17 @@ uint8_t roundRobin(prioridadTarea scanPrioridad,uint8_t id_tarea) {
      *
      *  @details
      *   Segun el critero al momento de desarrollo, determina que tarea debe ejecutarse luego, y
-     *   por lo tanto provee los punteros correspondientes para el cambio de contexto. Esta
-     *   implementacion de scheduler es muy sencilla, del tipo Round-Robin
+     *   por lo tanto provee los punteros correspondientes para el cambio de contexto.
+     *   La prioridad más alta con tareas READY se obtiene con un CLZ sobre control_OS.mapaReady
+     *   y se ejecuta la primera tarea de esa lista. La política Round-Robin entre tareas de la
+     *   misma prioridad se logra pasando la tarea que venía corriendo al final de su lista. El
+     *   costo es constante, independiente de la cantidad de tareas.
      *
 	 *  @param 		None.
 	 *  @return     None.
 ***************************************************************************************************/
 void scheduler(void)  {
-	static uint8_t id_tarea=0;
-	prioridadTarea	scanPrioridad=PRIORIDAD_0;
-
-	/*
-	 * Si se viene del reset se pone a la tarea idle como tarea actual
-	 */
-	if (control_OS.estado_sistema == OS_FROM_RESET)  {
-		control_OS.tarea_actual = control_OS.listaTareas[control_OS.cantidad_Tareas];
-		control_OS.estado_sistema = OS_NORMAL_RUN;
-	}
+	tarea *actual;
 
 	/*
 	 * Puede darse el caso en que se haya invocado la funcion os_CpuYield() la cual hace una
@@ -691,9 +1496,12 @@ void scheduler(void)  {
 	 * esta siendo atendida en modo Thread ocurre una excepcion dada por el SysTick, habra una
 	 * instancia del scheduler pendiente en modo trhead y otra corriendo en modo Handler invocada
 	 * por el SysTick. Para evitar un doble scheduling, se controla que el sistema no este haciendo
-	 * uno ya. En caso afirmativo se vuelve prematuramente
+	 * uno ya. En caso afirmativo se vuelve prematuramente, pero se deja el pedido pendiente: lo
+	 * atiende el scheduling en curso o getContextoSiguiente() si ya se pidió el cambio de
+	 * contexto. Si no, una tarea despertada por una interrupción esperaría hasta el próximo tick.
 	 */
 	if (control_OS.estado_sistema == OS_SCHEDULING)  {
+		control_OS.schedulingPendiente = true;
 		return;
 	}
 
@@ -703,19 +1511,46 @@ void scheduler(void)  {
 	 */
 	control_OS.estado_sistema = OS_SCHEDULING;
 
-
-	for(scanPrioridad=0;scanPrioridad<=PRIORITY_COUNT;scanPrioridad++){
-		if(busqueda(scanPrioridad, TAREA_READY)){
-			id_tarea=roundRobin(scanPrioridad,id_tarea);
-			break;
+	irqOff();
+	// Round-Robin: la tarea que venía corriendo pasa al final de la lista de su prioridad
+	actual=control_OS.tarea_actual;
+	if(actual!=NULL && actual->estado==TAREA_RUNNING && actual->siguienteReady!=NULL){
+		listaReadyQuitar(actual);
+		listaReadyAgregar(actual);
 		}
-	}
 
-	// Por ahora el cambio de contexto siempre es necesario
-	control_OS.cambioContextoNecesario=true;
+	control_OS.schedulingPendiente=false;
+	elegirTareaSiguiente();
+
+	/*
+	 * Solo se pide el cambio de contexto si cambia la tarea a ejecutar. Si no cambia se sale
+	 * del estado OS_SCHEDULING dentro de la sección crítica, para que el scheduling que pida
+	 * una interrupción después no se pierda.
+	 */
+	control_OS.cambioContextoNecesario=(control_OS.tarea_siguiente!=control_OS.tarea_actual);
+	if(!control_OS.cambioContextoNecesario)
+		control_OS.estado_sistema = OS_NORMAL_RUN;
+	irqOn();
+
 	if(control_OS.cambioContextoNecesario)
-		setPendSV();
+		os_PortCambioContexto();
+
+}
+
+/*************************************************************************************************
+	 *  @brief Elige la tarea siguiente.
+     *
+     *  @details
+     *   Es la primera de la lista READY de mayor prioridad. La tarea idle está siempre READY,
+     *   por lo que mapaReady nunca es cero. Se llama en sección crítica.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+static void elegirTareaSiguiente(void)  {
+	uint8_t prioridad=__CLZ(control_OS.mapaReady);
 
+	control_OS.tarea_siguiente=control_OS.primeraReady[prioridad];
 }
 
 
@@ -735,7 +1570,11 @@ void scheduler(void)  {
 ***************************************************************************************************/
 void __attribute__((weak)) idleTask(void)  {
 	while(1)  {
-		__WFI();
+#if OS_TICKLESS_IDLE
+		os_IdleSinTick();
+#else
+		os_PortEsperarIrq();
+#endif
 	}
 }
 
@@ -802,6 +1641,7 @@ void __attribute__((weak)) tickHook(void)  {
 	 *  @return none.
 ***************************************************************************************************/
 void __attribute__((weak)) errorHook(void *caller)  {
+	(void)caller;
 	/*
 	 * Revisar el contenido de control_OS.error para obtener informacion. Utilizar os_getError()
 	 */
@@ -837,5 +1677,43 @@ bool os_getFlagISR(void)  {
 }
 
 
+/*************************************************************************************************
+	 *  @brief Pide un scheduling al terminar la interrupción.
+     *
+     *  @details
+     *  La usan las funciones FromISR luego de despertar una tarea. Solo se levanta la bandera si
+     *  la tarea despertada es más prioritaria que la que se interrumpió; os_IRQHandler() la
+     *  atiende con un único scheduling al salir de la interrupción más externa, por muchas
+     *  tareas que se hayan despertado.
+     *
+	 *  @param 		task	Tarea despertada (puede ser NULL).
+	 *  @return     none.
+***************************************************************************************************/
+void os_SolicitarCambioISR(tarea *task)  {
+	if(task!=NULL && (control_OS.tarea_actual==NULL || task->prioridad<control_OS.tarea_actual->prioridad))
+		control_OS.banderaISR = true;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Pide un scheduling luego de despertar una tarea.
+     *
+     *  @details
+     *  La usan las funciones del kernel que liberan un recurso. Solo se cede la CPU si la tarea
+     *  despertada es más prioritaria que la actual; si es de igual o menor prioridad la actual
+     *  sigue corriendo sin pasar al final de su lista. Desde una interrupción se comporta como
+     *  os_SolicitarCambioISR().
+     *
+	 *  @param 		task	Tarea despertada (puede ser NULL).
+	 *  @return     none.
+***************************************************************************************************/
+void os_SolicitarCambio(tarea *task)  {
+	if(control_OS.estado_sistema==OS_IRQ_RUN)
+		os_SolicitarCambioISR(task);
+	else if(task!=NULL && (control_OS.tarea_actual==NULL || task->prioridad<control_OS.tarea_actual->prioridad))
+		os_Yield();
+}
+
+
 
 //
@@ -13,9 +13,11 @@
 
 
 #include "MSE_OS_IRQ.h"
+#include "MSE_OS_Traza.h"
 
 
 static void* isr_vector_usuario[CANT_IRQ];		//vector de punteros a funciones para nuestras interrupciones
+static volatile uint8_t anidamientoIRQ;			//cantidad de interrupciones en curso (anidadas)
 
 
 /*************************************************************************************************
@@ -24,6 +26,8 @@ static void* isr_vector_usuario[CANT_IRQ];		//vector de punteros a funciones par
      *  @details
      *   Debemos pasarle el tipo de interrupción y la función del usuario que desea  atender esa
      *    interrupción.
+     *   La interrupción queda con prioridad OS_IRQ_PRIORIDAD_KERNEL, para que las secciones
+     *   críticas del kernel la enmascaren y pueda usar las funciones FromISR.
      * 	 La funcion devuelve true si fue exitosa o false en caso contrario.
      *
 	 *  @param 		LPC43XX_IRQn_Type irq, void* usr_isr
@@ -40,6 +44,7 @@ bool os_InstalarIRQ(LPC43XX_IRQn_Type irq, void* usr_isr)  {
 
 	if (isr_vector_usuario[irq] == NULL) {
 		isr_vector_usuario[irq] = usr_isr;
+		NVIC_SetPriority(irq, OS_IRQ_PRIORIDAD_KERNEL);
 		NVIC_ClearPendingIRQ(irq);
 		NVIC_EnableIRQ(irq);
 		status = true;
@@ -81,6 +86,10 @@ bool os_RemoverIRQ(LPC43XX_IRQn_Type irq)  {
      *
      *  @details
      *  Se encarga de llamar a la funcion de usuario que haya sido cargada.
+     *  Si las interrupciones se anidan, el scheduling pedido con os_setFlagISR() se hace una
+     *  sola vez, al terminar la más externa.
+     *  Los ciclos de la interrupción se suman con os_SumarCiclosIRQ() y no se le cargan a la
+     *  tarea interrumpida.
      *
      *  IMORTANTE : LAS FUNCIONES DE USUARIO LLAMADAS POR ESTA FUNCION SE EJECUTAN EN MODO HANDLER
      *  DE IGUAL FORMA. CUIDADO CON LA CARGA DE CODIGO EN ELLAS, MISMAS REGLAS QUE EN BARE METAL.
@@ -91,18 +100,28 @@ bool os_RemoverIRQ(LPC43XX_IRQn_Type irq)  {
 static void os_IRQHandler(LPC43XX_IRQn_Type IRQn)  {
 	estadoOS estadoPrevio_OS;
 	void (*funcion_usuario)(void);
+	uint32_t inicio=0;
 
 	//Guardamos el estado del sistema para restablecerlo al salir de la interrupción.
 	estadoPrevio_OS = os_getEstadoSistema();
 
 	// Actualizamos el estado del sistema operativo
 	os_setEstadoSistema(OS_IRQ_RUN);
+	if(anidamientoIRQ==0)
+		inicio=os_getCiclos();		// El tiempo de las anidadas lo incluye la más externa
+	anidamientoIRQ++;
+	OS_TRAZA_EVENTO(TRAZA_IRQ_ENTRA, os_getTareaActual(), IRQn);
 
 	// Llamamos a la funcion definida por el usuario
 	funcion_usuario = isr_vector_usuario[IRQn];
 	funcion_usuario();
 
+	OS_TRAZA_EVENTO(TRAZA_IRQ_SALE, os_getTareaActual(), IRQn);
+
 	// Retomamos el estado anterior de sistema operativo
+	anidamientoIRQ--;
+	if(anidamientoIRQ==0)
+		os_SumarCiclosIRQ(os_getCiclos()-inicio);
 	os_setEstadoSistema(estadoPrevio_OS);
 
 
@@ -112,8 +131,8 @@ static void os_IRQHandler(LPC43XX_IRQn_Type IRQn)  {
 
 
 	// Si hubo alguna llamada desde una interrupción a una API liberando un evento, entonces
-	// llamamos al scheduler
-	if (os_getFlagISR())  {
+	// llamamos al scheduler, una sola vez al salir de la interrupción más externa
+	if (anidamientoIRQ==0 && os_getFlagISR())  {
 		os_setFlagISR(false);
 		os_Yield();
 	}
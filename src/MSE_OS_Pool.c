@@ -0,0 +1,194 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_Pool.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * Este módulo implementa pools de bloques de memoria de tamaño fijo.
+ * La memoria de cada pool es un array estático declarado por la aplicación con
+ * OS_POOL_MEMORIA(), y os_PoolInit() la divide en bloques. Los bloques libres
+ * forman una lista simplemente enlazada que se guarda dentro de los mismos
+ * bloques (lista intrusiva), por lo que no se usa memoria extra y pedir o
+ * devolver un bloque es siempre de tiempo constante, sin fragmentación.
+ * os_PoolAlloc() y os_PoolFree() se pueden llamar desde una interrupción.
+ * os_PoolAllocTimeout() bloquea la tarea si no hay bloques libres; quien
+ * devuelve un bloque se lo entrega directamente a la tarea de mayor prioridad
+ * que espera.
+ *
+ *===========================================================================*/
+
+
+#include "MSE_OS_Pool.h"
+
+
+static uintptr_t svcPoolTomar(uintptr_t p, uintptr_t delayTicks);
+static uintptr_t svcPoolLiberar(uintptr_t p, uintptr_t bloque);
+
+
+/*************************************************************************************************
+	 *  @brief Inicializa un pool.
+     *
+     *  @details
+     *   Arma la lista de bloques libres sobre la memoria. La memoria debe estar alineada a
+     *   puntero y tener lugar para cantBloques bloques de OS_POOL_BLOQUE(tamBloque) bytes, lo
+     *   que se asegura declarándola con OS_POOL_MEMORIA().
+     *
+	 *  @param 		p, memoria, tamBloque (en bytes), cantBloques
+	 *  @return     None.
+***************************************************************************************************/
+void os_PoolInit(pool* p, void* memoria, uint16_t tamBloque, uint16_t cantBloques)  {
+	uint8_t *bloque=(uint8_t*)memoria;
+
+	p->tamBloque=OS_POOL_BLOQUE(tamBloque);
+	p->cantBloques=cantBloques;
+	p->cantLibres=cantBloques;
+	p->libre=(cantBloques>0) ? memoria : NULL;
+	os_EsperaInit(&p->espera);
+
+	for(uint16_t i=1;i<cantBloques;i++)  {
+		*(void**)bloque=bloque+p->tamBloque;
+		bloque+=p->tamBloque;
+		}
+	if(cantBloques>0)
+		*(void**)bloque=NULL;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Pide un bloque sin esperar.
+     *
+     *  @details
+     *   Saca el primer bloque de la lista libre. Se puede llamar desde una interrupción.
+     *
+	 *  @param 		p
+	 *  @return     El bloque, o NULL si no hay bloques libres.
+***************************************************************************************************/
+void* os_PoolAlloc(pool* p)  {
+	void *bloque;
+
+	irqOff();
+	bloque=p->libre;
+	if(bloque!=NULL)  {
+		p->libre=*(void**)bloque;
+		p->cantLibres--;
+		}
+	irqOn();
+
+	return bloque;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Pide un bloque esperando como máximo delayTicks.
+     *
+     *  @details
+     *   Si no hay bloques libres la tarea se bloquea en la lista de espera del pool, y quien
+     *   devuelva un bloque se lo entrega en datoEspera. Con delayTicks igual a 0 no se espera,
+     *   y con delayTicks mayor o igual a portMax_DELAY se espera por tiempo indefinido. No se
+     *   debe llamar desde una interrupción.
+     *
+	 *  @param 		p, delayTicks
+	 *  @return     El bloque, o NULL si venció el tiempo.
+***************************************************************************************************/
+void* os_PoolAllocTimeout(pool* p, uint64_t delayTicks)  {
+	void *bloque;
+	tarea *tareaActual;
+
+	if(delayTicks>portMax_DELAY)
+		delayTicks=portMax_DELAY;
+
+	bloque=(void*)os_LlamadaKernel(svcPoolTomar, (uintptr_t)p, (uint32_t)delayTicks);
+	if(bloque!=NULL || delayTicks==0)
+		return bloque;
+
+	// Se bloqueó, al volver del SVC ya le entregaron un bloque o venció el timeout
+	tareaActual=os_getTareaActual();
+	return (tareaActual->resultadoEspera==ESPERA_OK) ? tareaActual->datoEspera : NULL;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Devuelve un bloque al pool.
+     *
+     *  @details
+     *   Se puede llamar desde una interrupción.
+     *
+	 *  @param 		p, bloque (obtenido de este mismo pool)
+	 *  @return     None.
+***************************************************************************************************/
+void os_PoolFree(pool* p, void* bloque)  {
+	if(bloque!=NULL)
+		os_LlamadaKernel(svcPoolLiberar, (uintptr_t)p, (uintptr_t)bloque);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Devuelve la cantidad de bloques libres.
+     *
+	 *  @param 		p
+	 *  @return     Cantidad de bloques libres.
+***************************************************************************************************/
+uint16_t os_PoolLibres(pool* p)  {
+	return p->cantLibres;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel de os_PoolAllocTimeout().
+     *
+	 *  @param 		p, delayTicks
+	 *  @return     El bloque, o NULL si la tarea se bloqueó o no puede esperar.
+***************************************************************************************************/
+static uintptr_t svcPoolTomar(uintptr_t p, uintptr_t delayTicks)  {
+	pool *poolAux=(pool*)p;
+	void *bloque;
+
+	irqOff();
+	bloque=poolAux->libre;
+	if(bloque!=NULL || delayTicks==0)  {
+		if(bloque!=NULL)  {
+			poolAux->libre=*(void**)bloque;
+			poolAux->cantLibres--;
+			}
+		irqOn();
+		return (uintptr_t)bloque;
+		}
+
+	os_EsperaBloquear(&poolAux->espera, os_getTareaActual(), delayTicks);	// portMax_DELAY es TICKS_ON
+	irqOn();
+
+	os_Yield();
+	return (uintptr_t)NULL;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel de os_PoolFree().
+     *
+     *  @details
+     *   Si hay tareas esperando el bloque pasa directamente a la de mayor prioridad, sin volver
+     *   a la lista libre. Solo se cambia de contexto si esa tarea es más prioritaria que la
+     *   actual; desde una interrupción el scheduling lo pide os_IRQHandler() al salir.
+     *
+	 *  @param 		p, bloque
+	 *  @return     0.
+***************************************************************************************************/
+static uintptr_t svcPoolLiberar(uintptr_t p, uintptr_t bloque)  {
+	pool *poolAux=(pool*)p;
+	tarea *task;
+
+	irqOff();
+	task=os_EsperaDespertar(&poolAux->espera, ESPERA_OK);
+	if(task!=NULL)
+		task->datoEspera=(void*)bloque;
+	else  {
+		*(void**)bloque=poolAux->libre;
+		poolAux->libre=(void*)bloque;
+		poolAux->cantLibres++;
+		}
+	irqOn();
+
+	os_SolicitarCambio(task);
+	return 0;
+}
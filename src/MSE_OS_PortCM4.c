@@ -0,0 +1,427 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_PortCM4.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * En este módulo se encuentra el port del S.O. para el Cortex-M4 de la
+ * EDU-CIAA-NXP: prioridades de las excepciones, stack frame inicial de las
+ * tareas, entrada al kernel por SVC, secciones críticas con BASEPRI, SysTick
+ * sin tick para la idleTask y contador de ciclos del DWT.
+ * El cambio de contexto propiamente dicho está en PendSV_Handler.S.
+ *
+ *===========================================================================*/
+
+#include "MSE_OS_Core.h"
+
+
+// PendSV_Handler.S calcula OS_BASEPRI_KERNEL con OS_PORT_PRIO_BITS
+_Static_assert(OS_PORT_PRIO_BITS==__NVIC_PRIO_BITS,
+			   "OS_PORT_PRIO_BITS debe ser igual a __NVIC_PRIO_BITS del CMSIS");
+
+
+/*===================[Declaración de funciones locales]================================*/
+
+void os_SVCDespachar(uint32_t *frame);
+
+
+/*==================[Definición de variables globales]=================================*/
+
+static uint32_t ciclosPorTick;		// Cuentas del SysTick en un tick
+static bool cuentaDWT;				// El DWT cuenta ciclos (en algunos emuladores no)
+
+
+/*==================[Funciones del port]=================================*/
+
+/*************************************************************************************************
+	 *  @brief Inicializa el procesador para el OS.
+     *
+     *  @details
+     *   Baja la prioridad de PendSV, SVC y SysTick a la más baja posible, arranca el contador
+     *   de ciclos del DWT desde cicloInicial y configura el apilado lazy de la FPU.
+     *
+	 *  @param 		cicloInicial	Valor inicial de CYCCNT.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortInit(uint32_t cicloInicial)  {
+	uint32_t cuenta;
+
+	/*
+	 * Todas las interrupciones tienen prioridad 0 (la máxima) al iniciar la ejecución. Para que
+	 * no se de la condicion de fault mencionada en la teoria, debemos bajar su prioridad en el
+	 * NVIC. La cuenta matematica que se observa da la probabilidad mas baja posible.
+	 */
+	NVIC_SetPriority(PendSV_IRQn, (1 << __NVIC_PRIO_BITS)-1);
+
+	/*
+	 * El SVC (entrada al kernel desde las tareas) comparte la prioridad de PendSV y SysTick,
+	 * así las funciones del kernel no se interrumpen entre sí.
+	 */
+	NVIC_SetPriority(SVCall_IRQn, (1 << __NVIC_PRIO_BITS)-1);
+	NVIC_SetPriority(SysTick_IRQn, (1 << __NVIC_PRIO_BITS)-1);
+
+	/*
+	 * Contador de ciclos del DWT. Si no existe o no avanza (QEMU no lo emula)
+	 * os_PortCiclos() devuelve false y el kernel usa el SysTick.
+	 */
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT=cicloInicial;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+	cuenta=DWT->CYCCNT;
+	__NOP();
+	__NOP();
+	cuentaDWT=!(DWT->CTRL & DWT_CTRL_NOCYCCNT_Msk) && DWT->CYCCNT!=cuenta;
+
+#if (__FPU_USED == 1)
+	/*
+	 * Apilado automático y lazy de la FPU: el hardware solo reserva lugar para S0-S15 en el
+	 * stack frame y los guarda si realmente se usa la FPU. Con esto CONTROL.FPCA indica por
+	 * tarea si tiene contexto de FPU, y EXEC_RETURN[4] le avisa a PendSV si debe guardar S16-S31.
+	 */
+	FPU->FPCCR |= FPU_FPCCR_ASPEN_Msk | FPU_FPCCR_LSPEN_Msk;
+#endif
+}
+
+/*************************************************************************************************
+	 *  @brief Arma el stack frame inicial de una tarea.
+     *
+     *  @details
+     *   Se arma en el tope del stack (alineado a 8 bytes) el contexto que PendSV_Handler
+     *   recupera la primera vez que la tarea entra en ejecución.
+     *
+	 *  @param 		stack		Fondo del stack (no se usa en este port).
+	 *  @param 		tope		Tope del stack alineado a 8 bytes.
+	 *  @param 		entryPoint	Dirección de la tarea.
+	 *  @param 		retorno		Función a la que salta la tarea si retorna.
+	 *  @return     El valor inicial del PSP de la tarea.
+***************************************************************************************************/
+uintptr_t os_PortInitContexto(uint32_t *stack, uint32_t *tope, void *entryPoint, void *retorno)  {
+	(void)stack;
+	tope[-XPSR] = INIT_XPSR;						//necesario para bit thumb
+	tope[-PC_REG] = (uint32_t)entryPoint;			//direccion de la tarea (ENTRY_POINT)
+	tope[-LR] = (uint32_t)retorno;					//Retorno de la tarea (no deberia darse)
+
+	/*
+	 * El valor previo de LR (que es EXEC_RETURN en este caso) es necesario dado que
+	 * en esta implementacion, se llama a una funcion desde dentro del handler de PendSV
+	 * con lo que el valor de LR se modifica por la direccion de retorno para cuando
+	 * se termina de ejecutar getContextoSiguiente
+	 */
+	tope[-LR_PREV_VALUE] = EXEC_RETURN;
+
+	return (uintptr_t)(tope - FULL_STACKING_SIZE);
+}
+
+/*************************************************************************************************
+	 *  @brief Prepara el arranque de la primer tarea.
+     *
+     *  @details
+     *   Con el PSP en cero PendSV_Handler sabe que no hay contexto que guardar.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortArranque(void)  {
+	__set_PSP(0);
+}
+
+/*************************************************************************************************
+	 *  @brief Pide un cambio de contexto.
+     *
+     *  @details
+     *  Dentro se setea como pendiente la excepcion PendSV.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortCambioContexto(void)  {
+
+	/**
+	 * Se setea el bit correspondiente a la excepción PendSV
+	 * Habilita para que pueda ser llamada la PendSV
+	 */
+	SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+
+	/**
+	 * Instruction Synchronization Barrier; flushes the pipeline and ensures that
+	 * all previous instructions are completed before executing new instructions
+	 */
+	__ISB();
+
+	/**
+	 * Data Synchronization Barrier; ensures that all memory accesses are
+	 * completed before next instruction is executed
+	 */
+	__DSB();
+}
+
+/*************************************************************************************************
+	 *  @brief Indica si un contexto guardado incluye la FPU.
+     *
+     *  @details
+     *   El EXEC_RETURN guardado por PendSV sobre R4-R11 tiene el bit 4 en cero si el stack
+     *   frame incluye los registros de la FPU.
+     *
+	 *  @param 		sp		PSP de la tarea luego de guardar su contexto.
+	 *  @return     true si el contexto incluye la FPU.
+***************************************************************************************************/
+bool os_PortContextoFPU(uintptr_t sp)  {
+	return !(((uint32_t*)sp)[FULL_STACKING_SIZE-LR_PREV_VALUE] & EXEC_RETURN_FPU_Msk);
+}
+
+/*************************************************************************************************
+	 *  @brief Descarta el contexto de FPU de la tarea actual.
+     *
+     *  @details
+     *   Se borra CONTROL.FPCA, por lo que los próximos cambios de contexto de la tarea vuelven
+     *   a ser sin FPU.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortLiberarFPU(void)  {
+#if (__FPU_USED == 1)
+	__set_CONTROL(__get_CONTROL() & ~CONTROL_FPCA_Msk);
+	__ISB();
+#endif
+}
+
+/*************************************************************************************************
+	 *  @brief Ejecuta una función del kernel en modo handler.
+     *
+     *  @details
+     *   Las tareas no llaman directamente a las funciones que modifican las listas del kernel,
+     *   sino que lo hacen a través de la excepción SVC: se deja la función en R12 y los
+     *   argumentos en R0 y R1, y SVC_Handler (PendSV_Handler.S) llama a os_SVCDespachar(), que
+     *   la ejecuta y deja el valor de retorno en el R0 apilado. Como SVC, PendSV y SysTick
+     *   tienen la misma prioridad, la función del kernel no es interrumpida por un scheduling y
+     *   si pone pendiente un cambio de contexto éste se hace apenas termina, antes de volver a
+     *   la tarea.
+     *   Si ya se está en modo handler (por ejemplo dentro de una interrupción) no se puede
+     *   ejecutar un SVC, y la función se llama directamente.
+     *   Con las interrupciones del kernel enmascaradas (irqOff()) el SVC no se puede atender y
+     *   escalaría a HardFault, por lo que en su lugar se informa ERR_OS_SVC_IRQ_OFF.
+     *
+	 *  @param 		servicio	Función del kernel a ejecutar.
+	 *  @param 		arg0, arg1	Argumentos de la función.
+	 *  @return     El valor que devuelve la función.
+***************************************************************************************************/
+uintptr_t os_LlamadaKernel(servicioKernel servicio, uintptr_t arg0, uintptr_t arg1)  {
+	if(__get_IPSR()!=0)
+		return servicio(arg0, arg1);
+
+	if(__get_BASEPRI()!=0 || __get_PRIMASK()!=0)  {
+		os_setError(ERR_OS_SVC_IRQ_OFF, servicio);
+		return 0;
+	}
+
+	register uint32_t r0 __asm("r0") = arg0;
+	register uint32_t r1 __asm("r1") = arg1;
+	register uint32_t r12 __asm("r12") = (uint32_t)servicio;
+
+	__asm volatile("svc 0" : "+r"(r0) : "r"(r1), "r"(r12) : "memory");
+
+	return r0;
+}
+
+/*************************************************************************************************
+	 *  @brief Despacha una llamada al kernel hecha por SVC.
+     *
+     *  @details
+     *   La llama SVC_Handler con la dirección del stack frame apilado por la excepción. La
+     *   función del kernel está en el R12 apilado y sus argumentos en R0 y R1. El resultado se
+     *   escribe en el R0 apilado, que es el valor que recibe la tarea al volver del SVC.
+     *
+	 *  @param 		frame	Stack frame apilado por la excepción SVC.
+	 *  @return     None.
+***************************************************************************************************/
+void os_SVCDespachar(uint32_t *frame)  {
+	servicioKernel servicio;
+
+	servicio=(servicioKernel)frame[SVC_FRAME_R12];
+	frame[SVC_FRAME_R0]=servicio(frame[SVC_FRAME_R0], frame[SVC_FRAME_R1]);
+}
+
+/*************************************************************************************************
+	 *  @brief Deshabilita las interrupciones guardando el estado anterior.
+     *
+     *  @details
+     *   A diferencia de irqOff()/irqOn(), el estado lo guarda quien llama y se restaura con
+     *   irqRestaurar(). Se usa __set_BASEPRI_MAX, que solo sube el nivel de enmascaramiento,
+     *   para no habilitar interrupciones que una sección más externa tenía enmascaradas.
+     *
+	 *  @param 		none.
+	 *  @return     El estado anterior (BASEPRI).
+***************************************************************************************************/
+uint32_t irqOffGuardar(void) {
+	uint32_t estado=__get_BASEPRI();
+
+	__set_BASEPRI_MAX(OS_BASEPRI_KERNEL);
+	__DSB();
+	__ISB();
+	return estado;
+}
+
+/*************************************************************************************************
+	 *  @brief Restaura el estado de las interrupciones guardado por irqOffGuardar().
+     *
+	 *  @param 		estado.
+	 *  @return     None.
+***************************************************************************************************/
+void irqRestaurar(uint32_t estado) {
+	__set_BASEPRI(estado);
+}
+
+/*************************************************************************************************
+	 *  @brief Deshabilita todas las interrupciones (PRIMASK).
+     *
+     *  @details
+     *   Una interrupción enmascarada con PRIMASK igual despierta a __WFI, con BASEPRI no.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortIrqDeshabilitar(void)  {
+	__asm("cpsid i");
+}
+
+/*************************************************************************************************
+	 *  @brief Habilita las interrupciones deshabilitadas con os_PortIrqDeshabilitar().
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortIrqHabilitar(void)  {
+	__asm("cpsie i");
+}
+
+/*************************************************************************************************
+	 *  @brief Duerme el procesador hasta la próxima interrupción.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_PortEsperarIrq(void)  {
+	__WFI();
+}
+
+/*************************************************************************************************
+	 *  @brief Duerme sin interrupciones de SysTick.
+     *
+     *  @details
+     *   Se llama desde os_IdleSinTick() con las interrupciones deshabilitadas. Se reprograma el
+     *   SysTick para una sola cuenta larga y se ejecuta __WFI. El SysTick es de 24 bits, por lo
+     *   que cada llamada duerme como máximo 0xFFFFFF ciclos.
+     *   Si se despertó por otra interrupción (por ejemplo una tecla) se programa la próxima
+     *   interrupción del SysTick para que caiga en el mismo instante que si no se hubiese
+     *   detenido, de manera que el reloj del sistema no deriva.
+     *
+	 *  @param 		ticks	Ticks hasta el próximo vencimiento.
+	 *  @return     Ticks completos transcurridos que no atenderá SysTick_Handler.
+***************************************************************************************************/
+uint32_t os_PortDormirTicks(uint32_t ticks)  {
+	uint32_t ticksMax, cuentaInicial, recarga, ctrl, transcurrido, completos, resto;
+
+	ticksMax=SysTick_LOAD_RELOAD_Msk/ciclosPorTick;
+	if(ticks>ticksMax)
+		ticks=ticksMax;
+
+	// Se detiene el SysTick, VAL son las cuentas que faltaban para el próximo tick
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	cuentaInicial=SysTick->VAL;
+	if(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk)  {
+		// Justo venció un tick, se deja que SysTick_Handler lo atienda
+		SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+		return 0;
+		}
+
+	// Una sola cuenta hasta el final del tick en curso más los ticks-1 siguientes
+	recarga=cuentaInicial+(ticks-1)*ciclosPorTick;
+	SysTick->LOAD=recarga-1;
+	SysTick->VAL=0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+
+	__DSB();
+	__WFI();
+	__ISB();
+
+	// La lectura de CTRL borra COUNTFLAG, por eso se la lee una única vez
+	ctrl=SysTick->CTRL;
+	SysTick->CTRL=ctrl & ~SysTick_CTRL_ENABLE_Msk;
+
+	if(ctrl & SysTick_CTRL_COUNTFLAG_Msk)  {
+		/*
+		 * Venció la cuenta: el último tick lo cuenta SysTick_Handler, que quedó pendiente.
+		 * Las cuentas que corrieron desde el vencimiento se descuentan del próximo tick.
+		 */
+		completos=ticks-1;
+		transcurrido=(recarga-1)-SysTick->VAL;
+		resto=(transcurrido<ciclosPorTick) ? ciclosPorTick-transcurrido : ciclosPorTick;
+		}
+	else  {
+		/*
+		 * Despertó otra interrupción antes del vencimiento. Se cuentan los ticks completos
+		 * transcurridos desde el último tick y se programa el resto del tick en curso.
+		 */
+		transcurrido=(ciclosPorTick-cuentaInicial)+(recarga-SysTick->VAL);
+		completos=transcurrido/ciclosPorTick;
+		resto=ciclosPorTick-(transcurrido%ciclosPorTick);
+		}
+
+	// Se reprograma el resto del tick y el período normal para los siguientes
+	SysTick->LOAD=resto-1;
+	SysTick->VAL=0;
+	SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk;
+	SysTick->LOAD=ciclosPorTick-1;
+
+	return completos;
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve las cuentas del SysTick en un tick.
+     *
+     *  @details
+     *   El SysTick ya fue configurado por la aplicación; se toma su período y se lo guarda
+     *   para el resto del port (en el modo sin tick LOAD cambia).
+     *
+	 *  @param 		None.
+	 *  @return     Ciclos por tick.
+***************************************************************************************************/
+uint32_t os_PortCiclosPorTick(void)  {
+	ciclosPorTick=SysTick->LOAD+1;
+	return ciclosPorTick;
+}
+
+/*************************************************************************************************
+	 *  @brief Lee el contador de ciclos del DWT.
+     *
+	 *  @param 		ciclos	Donde se deja CYCCNT.
+	 *  @return     false si el DWT no cuenta.
+***************************************************************************************************/
+bool os_PortCiclos(uint32_t *ciclos)  {
+	if(!cuentaDWT)
+		return false;
+	*ciclos=DWT->CYCCNT;
+	return true;
+}
+
+/*************************************************************************************************
+	 *  @brief Devuelve los ciclos transcurridos del tick en curso.
+     *
+     *  @details
+     *   Si el SysTick ya llegó a cero pero su interrupción está pendiente se vuelve a leer la
+     *   cuenta, que ya es del tick siguiente.
+     *
+	 *  @param 		pendiente	1 si hay un tick pendiente de atender, si no 0.
+	 *  @return     Ciclos.
+***************************************************************************************************/
+uint32_t os_PortCiclosEnTick(uint32_t *pendiente)  {
+	uint32_t cuenta;
+
+	cuenta=SysTick->VAL;
+	*pendiente=(SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) ? 1 : 0;
+	if(*pendiente)
+		cuenta=SysTick->VAL;
+	return ciclosPorTick-1-cuenta;
+}
@@ -0,0 +1,228 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_Stream.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * Este módulo implementa stream buffers: buffers circulares de bytes para
+ * pasar datos de una interrupción (UART RX, captura de flancos, etc.) a una
+ * tarea sin un evento por byte.
+ * Hay un único productor y un único consumidor, y cada índice lo modifica uno
+ * solo de ellos, por lo que la escritura y la lectura de datos no necesitan
+ * deshabilitar interrupciones. Los índices avanzan libremente y se enmascaran
+ * con capacidad-1, que debe ser potencia de 2.
+ * El consumidor se bloquea hasta que haya la cantidad de bytes que pide o el
+ * nivel de disparo, lo que sea menor. El productor solo entra al kernel para
+ * despertarlo cuando se alcanza esa cantidad, una vez por ráfaga.
+ *
+ *===========================================================================*/
+
+
+#include <string.h>
+
+#include "MSE_OS_Stream.h"
+
+
+static uintptr_t svcStreamEsperar(uintptr_t s, uintptr_t delayTicks);
+static uintptr_t svcStreamDespertar(uintptr_t s, uintptr_t arg1);
+
+
+/*************************************************************************************************
+	 *  @brief Inicializa un stream buffer.
+     *
+	 *  @param 		s, memoria, capacidad (potencia de 2, en bytes), nivelDisparo
+	 *  @return     None.
+***************************************************************************************************/
+void os_StreamInit(stream* s, uint8_t* memoria, uint32_t capacidad, uint32_t nivelDisparo)  {
+	if(capacidad==0 || (capacidad & (capacidad-1))!=0)  {
+		os_setError(ERR_OS_STREAM_CAPACIDAD,os_StreamInit);
+		return;
+		}
+
+	s->memoria=memoria;
+	s->mascara=capacidad-1;
+	s->escritura=0;
+	s->lectura=0;
+	s->esperados=0;
+	s->consumidor=NULL;
+	os_StreamSetDisparo(s, nivelDisparo);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Cambia el nivel de disparo.
+     *
+     *  @details
+     *   Es la cantidad de bytes con la que se despierta al consumidor aunque haya pedido más.
+     *   Se limita entre 1 y la capacidad.
+     *
+	 *  @param 		s, nivelDisparo
+	 *  @return     None.
+***************************************************************************************************/
+void os_StreamSetDisparo(stream* s, uint32_t nivelDisparo)  {
+	if(nivelDisparo==0)
+		nivelDisparo=1;
+	if(nivelDisparo>s->mascara+1)
+		nivelDisparo=s->mascara+1;
+	s->nivelDisparo=nivelDisparo;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Devuelve la cantidad de bytes que hay en el stream.
+     *
+	 *  @param 		s
+	 *  @return     Cantidad de bytes.
+***************************************************************************************************/
+uint32_t os_StreamDisponibles(stream* s)  {
+	return s->escritura - s->lectura;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Escribe bytes en el stream.
+     *
+     *  @details
+     *   La llama el único productor, normalmente una ISR. Se copian los bytes que entran, se
+     *   publica el nuevo índice de escritura y, si el consumidor está bloqueado y ya tiene los
+     *   bytes que esperaba, se lo despierta. No espera nunca.
+     *
+	 *  @param 		s, datos, cantidad
+	 *  @return     Cantidad de bytes escritos (menor a cantidad si el stream se llenó).
+***************************************************************************************************/
+uint32_t os_StreamEscribir(stream* s, const void* datos, uint32_t cantidad)  {
+	const uint8_t *origen=(const uint8_t*)datos;
+	uint32_t escritura=s->escritura;
+	uint32_t libres=s->mascara+1-(escritura-s->lectura);
+	uint32_t tramo;
+
+	if(cantidad>libres)
+		cantidad=libres;
+
+	// Puede hacer falta copiar en dos tramos si se pasa el final del buffer
+	tramo=s->mascara+1-(escritura & s->mascara);
+	if(tramo>cantidad)
+		tramo=cantidad;
+	memcpy(s->memoria+(escritura & s->mascara),origen,tramo);
+	memcpy(s->memoria,origen+tramo,cantidad-tramo);
+
+	// Los datos tienen que estar en memoria antes de que el consumidor vea el índice
+	__DMB();
+	s->escritura=escritura+cantidad;
+
+	if(s->consumidor!=NULL && s->escritura-s->lectura>=s->esperados)
+		os_LlamadaKernel(svcStreamDespertar, (uintptr_t)s, 0);
+
+	return cantidad;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Lee bytes del stream.
+     *
+     *  @details
+     *   La llama el único consumidor, que debe ser una tarea. Si hay menos bytes que el mínimo
+     *   entre cantidad y el nivel de disparo se bloquea hasta que lleguen o pasen delayTicks.
+     *   Luego lee todos los que haya, hasta cantidad. Con delayTicks igual a 0 no se espera, y
+     *   con delayTicks mayor o igual a portMax_DELAY se espera por tiempo indefinido.
+     *
+	 *  @param 		s, datos, cantidad, delayTicks
+	 *  @return     Cantidad de bytes leídos (puede ser 0 si venció el tiempo).
+***************************************************************************************************/
+uint32_t os_StreamLeer(stream* s, void* datos, uint32_t cantidad, uint64_t delayTicks)  {
+	uint8_t *destino=(uint8_t*)datos;
+	uint32_t lectura, disponibles, tramo;
+
+	if(delayTicks>portMax_DELAY)
+		delayTicks=portMax_DELAY;
+
+	s->esperados=(cantidad<s->nivelDisparo) ? cantidad : s->nivelDisparo;
+	if(os_StreamDisponibles(s)<s->esperados && delayTicks!=0)  {
+		os_LlamadaKernel(svcStreamEsperar, (uintptr_t)s, (uint32_t)delayTicks);
+		s->consumidor=NULL;					// Por si venció el tiempo
+		}
+
+	lectura=s->lectura;
+	disponibles=s->escritura-lectura;
+	__DMB();
+	if(cantidad>disponibles)
+		cantidad=disponibles;
+
+	tramo=s->mascara+1-(lectura & s->mascara);
+	if(tramo>cantidad)
+		tramo=cantidad;
+	memcpy(destino,s->memoria+(lectura & s->mascara),tramo);
+	memcpy(destino+tramo,s->memoria,cantidad-tramo);
+
+	// Se termina de leer antes de liberar el lugar al productor
+	__DMB();
+	s->lectura=lectura+cantidad;
+
+	return cantidad;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que bloquea al consumidor.
+     *
+     *  @details
+     *   Se vuelve a verificar la cantidad de bytes con las interrupciones deshabilitadas: si el
+     *   productor escribió entre la verificación de os_StreamLeer() y este punto no se bloquea.
+     *   Si escribe después ya ve al consumidor registrado y lo despierta.
+     *
+	 *  @param 		s, delayTicks
+	 *  @return     0.
+***************************************************************************************************/
+static uintptr_t svcStreamEsperar(uintptr_t s, uintptr_t delayTicks)  {
+	stream *streamAux=(stream*)s;
+	tarea *tareaActual;
+
+	irqOff();
+	if(os_StreamDisponibles(streamAux)>=streamAux->esperados)  {
+		irqOn();
+		return 0;
+		}
+
+	tareaActual=os_getTareaActual();
+	tareaActual->resultadoEspera=ESPERA_TIMEOUT;
+	streamAux->consumidor=tareaActual;
+	os_setTicksTarea(tareaActual, delayTicks);		// portMax_DELAY es TICKS_ON
+	irqOn();
+
+	os_Yield();
+	return 0;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel que despierta al consumidor.
+     *
+     *  @details
+     *   Solo se cambia de contexto si el consumidor es más prioritario que la tarea actual.
+     *   Desde una interrupción se ejecuta directamente y el scheduling lo pide os_IRQHandler()
+     *   al salir.
+     *
+	 *  @param 		s
+	 *  @return     0.
+***************************************************************************************************/
+static uintptr_t svcStreamDespertar(uintptr_t s, uintptr_t arg1)  {
+	stream *streamAux=(stream*)s;
+	tarea *task;
+
+	(void)arg1;
+
+	irqOff();
+	task=streamAux->consumidor;
+	if(task==NULL || task->estado!=TAREA_BLOCKED)  {
+		irqOn();
+		return 0;
+		}
+	streamAux->consumidor=NULL;
+	task->resultadoEspera=ESPERA_OK;
+	os_setTareaEstado(task, TAREA_READY);
+	irqOn();
+
+	os_SolicitarCambio(task);
+	return 0;
+}
@@ -0,0 +1,394 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_Temporizador.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * Este módulo implementa temporizadores por software sobre una rueda de
+ * tiempo jerárquica (hierarchical timing wheel).
+ * La rueda tiene TEMP_NIVELES niveles de TEMP_RANURAS ranuras. Un temporizador
+ * que vence dentro de las próximas 32 ticks va a la ranura de su tick en el
+ * nivel 0; los más lejanos van a niveles superiores, donde cada ranura abarca
+ * 32 veces más ticks. Cuando el nivel 0 da una vuelta se vuelca (cascade) la
+ * ranura siguiente del nivel 1 en los niveles inferiores, y así sucesivamente.
+ * Iniciar, detener y vencer un temporizador es de tiempo constante,
+ * independiente de la cantidad de temporizadores activos.
+ * La rueda la avanza una tarea del S.O., que además ejecuta las funciones de
+ * los temporizadores vencidos en modo thread. La tarea solo se despierta en
+ * los ticks en los que hay algo que hacer (un vencimiento o el cascade de una
+ * ranura ocupada) y al despertar salta directamente al tick de ese evento, por
+ * lo que su costo no depende de los ticks transcurridos. Si no hay
+ * temporizadores activos queda bloqueada, por lo que no impide el modo sin
+ * tick de la idleTask.
+ *
+ *===========================================================================*/
+
+
+#include "MSE_OS_Temporizador.h"
+
+
+#define TEMP_MASCARA			(TEMP_RANURAS-1)
+#define TEMP_ALCANCE			(1UL << (TEMP_BITS_RANURA*TEMP_NIVELES))
+// Máxima distancia que se inserta: el nivel superior no debe caer en su ranura actual
+#define TEMP_MAXIMO				(TEMP_ALCANCE - (1UL << (TEMP_BITS_RANURA*(TEMP_NIVELES-1))))
+
+
+static temporizador *ranuras[TEMP_NIVELES][TEMP_RANURAS];
+static uint32_t ocupadas[TEMP_NIVELES];		// Bit n en 1 si la ranura n tiene temporizadores
+static uint32_t ahora;						// Tick hasta el que avanzó la rueda
+static uint16_t cantActivos;
+
+static tarea tareaTemp;
+static uint32_t stackTemp[OS_TEMPORIZADOR_STACK/4] __attribute__((aligned(8)));
+
+static void tareaTemporizador(void);
+static void insertar(temporizador* t, bool cascade);
+static void quitar(temporizador* t);
+static bool avanzar(uint32_t tick);
+static uint32_t ticksHastaEvento(void);
+static void avisarTarea(void);
+
+
+/*************************************************************************************************
+	 *  @brief Inicializa los temporizadores y crea su tarea.
+     *
+     *  @details
+     *   Se debe llamar antes de os_Init(). Las funciones de los temporizadores se ejecutan con
+     *   la prioridad indicada.
+     *
+	 *  @param 		prioridad	Prioridad de la tarea de temporizadores.
+	 *  @return     None.
+***************************************************************************************************/
+void os_TemporizadorInit(prioridadTarea prioridad)  {
+	ahora=(uint32_t)os_getSytemTicks();
+	cantActivos=0;
+	os_InitTareaStack(tareaTemporizador, &tareaTemp, prioridad, stackTemp, sizeof(stackTemp));
+}
+
+
+/*************************************************************************************************
+	 *  @brief Configura un temporizador.
+     *
+     *  @details
+     *   El temporizador queda detenido. Un período de 0 se toma como 1 tick.
+     *
+	 *  @param 		t, funcion, argumento, periodo (ticks), periodico
+	 *  @return     None.
+***************************************************************************************************/
+void os_TemporizadorCrear(temporizador* t, funcionTemporizador funcion, void* argumento,
+						  uint32_t periodo, bool periodico)  {
+	t->funcion=funcion;
+	t->argumento=argumento;
+	t->periodo=(periodo!=0) ? periodo : 1;
+	t->periodico=periodico;
+	t->activo=false;
+	t->anterior=NULL;
+	t->siguiente=NULL;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Inicia un temporizador.
+     *
+     *  @details
+     *   Vence dentro de un período contado desde ahora. Si ya estaba activo vuelve a empezar
+     *   (igual que os_TemporizadorReiniciar()). Se puede llamar desde una tarea o una ISR.
+     *   Si la rueda está vacía se la lleva directamente al tick actual, para que la tarea no
+     *   tenga que recorrer de a uno los ticks en los que no hubo temporizadores.
+     *
+	 *  @param 		t
+	 *  @return     None.
+***************************************************************************************************/
+void os_TemporizadorIniciar(temporizador* t)  {
+	uint32_t estado, tick;
+
+	tick=(uint32_t)os_getSytemTicks();
+
+	estado=irqOffGuardar();
+	if(t->activo)
+		quitar(t);
+	else  {
+		if(cantActivos==0 && (int32_t)(tick-ahora)>0)
+			ahora=tick;
+		cantActivos++;
+		}
+	t->activo=true;
+	t->vencimiento=tick+t->periodo;
+	insertar(t, false);
+	irqRestaurar(estado);
+
+	avisarTarea();
+}
+
+
+/*************************************************************************************************
+	 *  @brief Detiene un temporizador.
+     *
+	 *  @param 		t
+	 *  @return     None.
+***************************************************************************************************/
+void os_TemporizadorDetener(temporizador* t)  {
+	uint32_t estado;
+
+	estado=irqOffGuardar();
+	if(t->activo)  {
+		quitar(t);
+		t->activo=false;
+		cantActivos--;
+		}
+	irqRestaurar(estado);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Vuelve a empezar la cuenta de un temporizador.
+     *
+	 *  @param 		t
+	 *  @return     None.
+***************************************************************************************************/
+void os_TemporizadorReiniciar(temporizador* t)  {
+	os_TemporizadorIniciar(t);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Cambia el período de un temporizador.
+     *
+     *  @details
+     *   El temporizador queda activo y vence dentro del nuevo período contado desde ahora.
+     *
+	 *  @param 		t, periodo (ticks)
+	 *  @return     None.
+***************************************************************************************************/
+void os_TemporizadorCambiarPeriodo(temporizador* t, uint32_t periodo)  {
+	t->periodo=(periodo!=0) ? periodo : 1;
+	os_TemporizadorIniciar(t);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Indica si un temporizador está activo.
+     *
+	 *  @param 		t
+	 *  @return     true si está activo.
+***************************************************************************************************/
+bool os_TemporizadorActivo(temporizador* t)  {
+	return t->activo;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Inserta un temporizador en la rueda.
+     *
+     *  @details
+     *   Se elige el nivel más bajo en el que el vencimiento cae dentro de las próximas
+     *   TEMP_RANURAS ranuras. Los vencimientos más allá del alcance de la rueda se dejan en la
+     *   última ranura alcanzable del nivel superior, y se reubican al hacer el cascade. Se debe
+     *   llamar con las interrupciones deshabilitadas.
+     *   En el cascade un vencimiento igual a ahora va a la ranura actual del nivel 0, que se
+     *   atiende a continuación en el mismo tick; fuera del cascade se pasa al tick siguiente.
+     *
+	 *  @param 		t
+	 *  @param 		cascade		true si se reubica desde un nivel superior.
+	 *  @return     None.
+***************************************************************************************************/
+static void insertar(temporizador* t, bool cascade)  {
+	uint32_t vencimiento=t->vencimiento, minimo=cascade ? ahora : ahora+1;
+	uint8_t nivel, desplazamiento=0;
+
+	// Los ya vencidos se atienden en el primer tick que todavía se puede atender
+	if((int32_t)(vencimiento-minimo)<0)
+		vencimiento=minimo;
+	else if(vencimiento-ahora>TEMP_MAXIMO)
+		vencimiento=ahora+TEMP_MAXIMO;
+
+	for(nivel=0;nivel<TEMP_NIVELES-1;nivel++,desplazamiento+=TEMP_BITS_RANURA)
+		if((vencimiento>>desplazamiento)-(ahora>>desplazamiento) < TEMP_RANURAS)
+			break;
+
+	t->nivel=nivel;
+	t->ranura=(vencimiento>>desplazamiento) & TEMP_MASCARA;
+	t->anterior=NULL;
+	t->siguiente=ranuras[nivel][t->ranura];
+	if(t->siguiente!=NULL)
+		t->siguiente->anterior=t;
+	ranuras[nivel][t->ranura]=t;
+	ocupadas[nivel]|=(1UL << t->ranura);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Quita un temporizador de la rueda.
+     *
+     *  @details
+     *   Se debe llamar con las interrupciones deshabilitadas.
+     *
+	 *  @param 		t
+	 *  @return     None.
+***************************************************************************************************/
+static void quitar(temporizador* t)  {
+	if(t->anterior!=NULL)
+		t->anterior->siguiente=t->siguiente;
+	else
+		ranuras[t->nivel][t->ranura]=t->siguiente;
+	if(t->siguiente!=NULL)
+		t->siguiente->anterior=t->anterior;
+
+	if(ranuras[t->nivel][t->ranura]==NULL)
+		ocupadas[t->nivel]&=~(1UL << t->ranura);
+
+	t->anterior=NULL;
+	t->siguiente=NULL;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Avanza la rueda hasta el próximo evento, si no pasa de tick.
+     *
+     *  @details
+     *   Los ticks anteriores al próximo evento no tienen nada que hacer, por lo que la rueda
+     *   salta directamente al tick del evento. Si el nivel 0 dio la vuelta se vuelcan las
+     *   ranuras correspondientes de los niveles superiores, y luego se atienden los
+     *   temporizadores de la ranura actual del nivel 0. Las funciones se ejecutan con las
+     *   interrupciones habilitadas; los periódicos se vuelven a insertar antes, para que la
+     *   función los pueda detener.
+     *   Si el próximo evento es posterior a tick la rueda queda en tick.
+     *
+	 *  @param 		tick	Tick actual del sistema.
+	 *  @return     true si atendió un evento (puede haber otro antes de tick).
+***************************************************************************************************/
+static bool avanzar(uint32_t tick)  {
+	temporizador *t;
+	uint32_t estado, ticks;
+	uint8_t nivel, desplazamiento, ranura;
+
+	estado=irqOffGuardar();
+	ticks=ticksHastaEvento();
+	if(ticks==0 || (int32_t)(ahora+ticks-tick)>0)  {
+		if((int32_t)(tick-ahora)>0)
+			ahora=tick;
+		irqRestaurar(estado);
+		return false;
+		}
+	ahora+=ticks;
+	for(nivel=1,desplazamiento=TEMP_BITS_RANURA;nivel<TEMP_NIVELES;nivel++,desplazamiento+=TEMP_BITS_RANURA)  {
+		if((ahora & ((1UL << desplazamiento)-1))!=0)
+			break;
+		ranura=(ahora>>desplazamiento) & TEMP_MASCARA;
+		while((t=ranuras[nivel][ranura])!=NULL)  {
+			quitar(t);
+			insertar(t, true);
+			}
+		}
+	irqRestaurar(estado);
+
+	ranura=ahora & TEMP_MASCARA;
+	while(1)  {
+		estado=irqOffGuardar();
+		t=ranuras[0][ranura];
+		if(t==NULL)  {
+			irqRestaurar(estado);
+			break;
+			}
+		quitar(t);
+		if((int32_t)(t->vencimiento-ahora)>0)  {
+			insertar(t, false);					// Más allá del alcance, sigue esperando
+			irqRestaurar(estado);
+			continue;
+			}
+		if(t->periodico)  {
+			t->vencimiento+=t->periodo;			// Sin deriva respecto del vencimiento anterior
+			insertar(t, false);
+			}
+		else  {
+			t->activo=false;
+			cantActivos--;
+			}
+		irqRestaurar(estado);
+
+		t->funcion(t->argumento);
+		}
+	return true;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Calcula cuántos ticks faltan para que la rueda tenga algo que hacer.
+     *
+     *  @details
+     *   En cada nivel se busca la próxima ranura ocupada: en el nivel 0 se atiende en su tick,
+     *   y en los superiores se vuelca (cascade) cuando empieza el tramo de ticks que abarca.
+     *   El evento es el más cercano de todos los niveles. Se debe llamar con las interrupciones
+     *   deshabilitadas.
+     *
+	 *  @param 		None
+	 *  @return     Ticks desde ahora, o 0 si no hay temporizadores activos.
+***************************************************************************************************/
+static uint32_t ticksHastaEvento(void)  {
+	uint32_t ticks=0, hasta, mapa, posicion, rotacion;
+	uint8_t desplazamiento=0;
+
+	for(uint8_t nivel=0;nivel<TEMP_NIVELES;nivel++,desplazamiento+=TEMP_BITS_RANURA)  {
+		mapa=ocupadas[nivel];
+		if(mapa==0)
+			continue;
+
+		// Se rota el mapa para que el bit 0 sea la ranura siguiente a la actual
+		posicion=ahora>>desplazamiento;
+		rotacion=(posicion+1) & TEMP_MASCARA;
+		mapa=(rotacion==0) ? mapa : ((mapa >> rotacion) | (mapa << (TEMP_RANURAS-rotacion)));
+		hasta=((posicion+__CLZ(__RBIT(mapa))+1) << desplazamiento) - ahora;
+		if(ticks==0 || hasta<ticks)
+			ticks=hasta;
+		}
+
+	return ticks;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Avisa a la tarea de temporizadores que cambió la rueda.
+     *
+	 *  @param 		None
+	 *  @return     None.
+***************************************************************************************************/
+static void avisarTarea(void)  {
+	if(os_getEstadoSistema()==OS_IRQ_RUN)
+		os_TareaNotificarFromISR(&tareaTemp, 1);
+	else if(os_getEstadoSistema()!=OS_FROM_RESET)
+		os_TareaNotificar(&tareaTemp, 1);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Tarea de temporizadores.
+     *
+     *  @details
+     *   Atiende los eventos de la rueda hasta el tick actual y se bloquea hasta el próximo.
+     *   Si mientras tanto se inicia un temporizador la notifican y recalcula la espera.
+     *
+	 *  @param 		None
+	 *  @return     None.
+***************************************************************************************************/
+static void tareaTemporizador(void)  {
+	uint32_t estado, ticks, tick;
+
+	while(1)  {
+		tick=(uint32_t)os_getSytemTicks();
+		while(avanzar(tick));
+
+		estado=irqOffGuardar();
+		ticks=ticksHastaEvento();
+		irqRestaurar(estado);
+
+		if(ticks==0)
+			os_TareaNotificacionEsperar(portMax_DELAY);
+		else  {
+			// La rueda se pudo haber atrasado mientras se ejecutaban las funciones
+			tick=(uint32_t)os_getSytemTicks();
+			if((int32_t)(ahora+ticks-tick)>0)
+				os_TareaNotificacionEsperar(ahora+ticks-tick);
+			}
+		}
+}
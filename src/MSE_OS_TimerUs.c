@@ -0,0 +1,176 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_TimerUs.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * Este módulo implementa retardos con resolución de microsegundos sin aumentar
+ * la frecuencia del SysTick.
+ * Se usa un TIMER del LPC4337 (OS_TIMER_US) contando libremente a 1 MHz. Las
+ * tareas que llaman a tareaDelayUs() se guardan en una lista ordenada por
+ * vencimiento, y el registro de match se programa como one-shot para el
+ * vencimiento más próximo. La interrupción del timer pasa por os_IRQHandler(),
+ * pone READY las tareas vencidas y levanta la bandera de ISR para que se haga
+ * el scheduling al salir.
+ * Los vencimientos son absolutos sobre un contador de 32 bits, por lo que se
+ * comparan con aritmética modular y el máximo retardo es de 2^31 us.
+ *
+ *===========================================================================*/
+
+
+#include "MSE_OS_TimerUs.h"
+
+
+static tarea *primeraUs;			// Lista de tareas ordenada por vencimientoUs
+
+static uintptr_t svcDelayUs(uintptr_t us, uintptr_t arg1);
+
+
+/*************************************************************************************************
+	 *  @brief Programa el match para la primera tarea de la lista.
+     *
+     *  @details
+     *   El match solo interrumpe cuando el contador es igual al valor cargado, por lo que si el
+     *   vencimiento ya pasó mientras se programaba se devuelve false para que el llamador lo
+     *   atienda. Se debe llamar con las interrupciones deshabilitadas.
+     *
+	 *  @param 		None
+	 *  @return     true si el match quedó programado en el futuro.
+***************************************************************************************************/
+static bool programarMatch(void)  {
+	Chip_TIMER_SetMatch(OS_TIMER_US, OS_TIMER_US_MATCH, primeraUs->vencimientoUs);
+	return (int32_t)(primeraUs->vencimientoUs - Chip_TIMER_ReadCount(OS_TIMER_US)) > 0;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Atención de la interrupción del timer.
+     *
+     *  @details
+     *   Pasa a READY todas las tareas vencidas y programa el próximo match. Se repite mientras
+     *   el próximo vencimiento ya haya pasado, porque os_IRQHandler() borra la interrupción
+     *   pendiente al salir. Si despertó alguna tarea se pide un scheduling con os_setFlagISR().
+     *
+	 *  @param 		None
+	 *  @return     None.
+***************************************************************************************************/
+static void os_TimerUsHandler(void)  {
+	tarea *task;
+	uint32_t ahora;
+
+	Chip_TIMER_ClearMatch(OS_TIMER_US, OS_TIMER_US_MATCH);
+
+	irqOff();
+	do  {
+		ahora=Chip_TIMER_ReadCount(OS_TIMER_US);
+		while(primeraUs!=NULL && (int32_t)(primeraUs->vencimientoUs - ahora) <= 0)  {
+			task=primeraUs;
+			primeraUs=task->siguienteUs;
+			task->siguienteUs=NULL;
+			os_setTareaEstado(task, TAREA_READY);
+			os_setFlagISR(true);
+			}
+		} while(primeraUs!=NULL && !programarMatch());
+	irqOn();
+}
+
+
+/*************************************************************************************************
+	 *  @brief Inicializa la base de tiempo en microsegundos.
+     *
+     *  @details
+     *   Configura OS_TIMER_US para contar a 1 MHz en forma libre, habilita la interrupción por
+     *   match (sin reset ni stop del contador) e instala su ISR en el vector del S.O. Se debe
+     *   llamar antes de os_Init().
+     *
+	 *  @param 		None
+	 *  @return     None.
+***************************************************************************************************/
+void os_TimerUsInit(void)  {
+	primeraUs=NULL;
+
+	Chip_TIMER_Init(OS_TIMER_US);
+	Chip_TIMER_Reset(OS_TIMER_US);
+	Chip_TIMER_PrescaleSet(OS_TIMER_US, Chip_Clock_GetRate(OS_TIMER_US_CLK)/OS_US_POR_SEGUNDO - 1);
+	Chip_TIMER_MatchEnableInt(OS_TIMER_US, OS_TIMER_US_MATCH);
+	Chip_TIMER_ClearMatch(OS_TIMER_US, OS_TIMER_US_MATCH);
+	Chip_TIMER_Enable(OS_TIMER_US);
+
+	os_InstalarIRQ(OS_TIMER_US_IRQ, os_TimerUsHandler);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Devuelve el tiempo en microsegundos.
+     *
+     *  @details
+     *   Es el contador libre de OS_TIMER_US, da la vuelta cada 2^32 us.
+     *
+	 *  @param 		None
+	 *  @return     tiempo en us.
+***************************************************************************************************/
+uint32_t os_getTiempoUs(void)  {
+	return Chip_TIMER_ReadCount(OS_TIMER_US);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Bloquea la tarea actual una cantidad de microsegundos.
+     *
+     *  @details
+     *   Se calcula el vencimiento absoluto, se bloquea la tarea por tiempo indefinido (no usa la
+     *   lista de retardos en ticks) y se la inserta ordenada en la lista de microsegundos. Si
+     *   queda primera se reprograma el match. Si el vencimiento ya pasó al programarlo se fuerza
+     *   la interrupción. Esta función no se puede llamar dentro de la atención de una
+     *   interrupción.
+     *
+	 *  @param 		us		cantidad de microsegundos (menor a 2^31).
+	 *  @return     None.
+***************************************************************************************************/
+void tareaDelayUs(uint32_t us)  {
+	if(os_getEstadoSistema()==OS_IRQ_RUN)  {
+		os_setError(ERR_DELAY_FROM_ISR,tareaDelayUs);			// Se produce un error
+		return;
+		}
+	if(us!=0)
+		os_LlamadaKernel(svcDelayUs, us, 0);
+}
+
+
+/*************************************************************************************************
+	 *  @brief Función del kernel de tareaDelayUs().
+     *
+	 *  @param 		us		cantidad de microsegundos.
+	 *  @return     0.
+***************************************************************************************************/
+static uintptr_t svcDelayUs(uintptr_t us, uintptr_t arg1)  {
+	tarea *task, *anterior, *siguiente;
+
+	(void)arg1;
+
+	irqOff();
+	task=os_getTareaActual();
+	task->vencimientoUs=Chip_TIMER_ReadCount(OS_TIMER_US)+us;
+	os_setTareaEstado(task, TAREA_BLOCKED);
+
+	// Inserción ordenada, las de igual vencimiento quedan en orden FIFO
+	anterior=NULL;
+	siguiente=primeraUs;
+	while(siguiente!=NULL && (int32_t)(siguiente->vencimientoUs - task->vencimientoUs) <= 0)  {
+		anterior=siguiente;
+		siguiente=siguiente->siguienteUs;
+		}
+	task->siguienteUs=siguiente;
+	if(anterior!=NULL)
+		anterior->siguienteUs=task;
+	else  {
+		primeraUs=task;
+		if(!programarMatch())
+			NVIC_SetPendingIRQ(OS_TIMER_US_IRQ);
+		}
+	irqOn();
+
+	os_Yield();
+	return 0;
+}
@@ -0,0 +1,151 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_Trabajo.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * Este módulo implementa la cola de trabajos diferidos del S.O.
+ * Las funciones de usuario instaladas con os_InstalarIRQ() se ejecutan en modo
+ * handler, por lo que deben ser cortas. Con os_TrabajoEncolar() una ISR deja
+ * un par (función, argumento) en un buffer circular en tiempo constante, y
+ * OS_TRABAJO_WORKERS tareas de la prioridad elegida en os_TrabajoInit() los
+ * ejecutan en modo thread, en orden de llegada.
+ * Los workers esperan en un semáforo contador. Cada worker que se despierta
+ * ejecuta todos los trabajos pendientes (por lotes), por lo que una ráfaga de
+ * interrupciones no produce un cambio de contexto por trabajo.
+ *
+ *===========================================================================*/
+
+
+#include "MSE_OS_Trabajo.h"
+
+
+// Los índices se enmascaran en lugar de tomar el resto
+_Static_assert((OS_TRABAJO_CANT & (OS_TRABAJO_CANT-1))==0 && OS_TRABAJO_CANT!=0,
+			   "OS_TRABAJO_CANT debe ser potencia de 2");
+
+
+static itemTrabajo trabajos[OS_TRABAJO_CANT];	// Buffer circular de trabajos
+static uint32_t escritura;						// Índices libres, se enmascaran con
+static uint32_t lectura;						// OS_TRABAJO_CANT-1
+static uint32_t perdidos;
+static semaforo pendientes;						// Despierta a los workers
+
+static tarea tareasTrabajo[OS_TRABAJO_WORKERS];
+static uint32_t stacksTrabajo[OS_TRABAJO_WORKERS][OS_TRABAJO_STACK/4] __attribute__((aligned(8)));
+
+static void tareaTrabajo(void);
+static bool sacarTrabajo(itemTrabajo *item);
+
+
+/*************************************************************************************************
+	 *  @brief Inicializa la cola de trabajos y crea los workers.
+     *
+     *  @details
+     *   Se debe llamar antes de os_Init(), ya que crea OS_TRABAJO_WORKERS tareas. La
+     *   prioridad define qué tan pronto se ejecutan los trabajos respecto del resto de las
+     *   tareas.
+     *
+	 *  @param 		prioridad	Prioridad de los workers.
+	 *  @return     None.
+***************************************************************************************************/
+void os_TrabajoInit(prioridadTarea prioridad)  {
+	escritura=0;
+	lectura=0;
+	perdidos=0;
+
+	// Un give sin workers esperando se recuerda, hasta uno por worker
+	os_SemaforoInitContador(&pendientes, OS_TRABAJO_WORKERS, 0);
+
+	for(uint8_t i=0;i<OS_TRABAJO_WORKERS;i++)
+		os_InitTareaStack(tareaTrabajo, &tareasTrabajo[i], prioridad, stacksTrabajo[i],
+						  sizeof(stacksTrabajo[i]));
+}
+
+
+/*************************************************************************************************
+	 *  @brief Encola un trabajo.
+     *
+     *  @details
+     *   Se puede llamar desde una ISR o desde una tarea. Es de tiempo constante y las
+     *   interrupciones solo se deshabilitan para copiar el par (función, argumento). Si la cola
+     *   está llena el trabajo se descarta y se cuenta en os_TrabajoPerdidos().
+     *
+	 *  @param 		funcion, argumento
+	 *  @return     true si se encoló, false si la cola estaba llena.
+***************************************************************************************************/
+bool os_TrabajoEncolar(funcionTrabajo funcion, void *argumento)  {
+	uint32_t estado;
+
+	estado=irqOffGuardar();
+	if(escritura-lectura>=OS_TRABAJO_CANT)  {
+		perdidos++;
+		irqRestaurar(estado);
+		return false;
+		}
+	trabajos[escritura & (OS_TRABAJO_CANT-1)].funcion=funcion;
+	trabajos[escritura & (OS_TRABAJO_CANT-1)].argumento=argumento;
+	escritura++;
+	irqRestaurar(estado);
+
+	if(os_getEstadoSistema()==OS_IRQ_RUN)
+		os_SemaforoGiveFromISR(&pendientes);
+	else
+		os_SemaforoGive(&pendientes);
+	return true;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Devuelve la cantidad de trabajos descartados por tener la cola llena.
+     *
+	 *  @param 		None
+	 *  @return     Cantidad de trabajos perdidos.
+***************************************************************************************************/
+uint32_t os_TrabajoPerdidos(void)  {
+	return perdidos;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Saca el trabajo más antiguo.
+     *
+	 *  @param 		item	Donde se copia el trabajo.
+	 *  @return     false si no había trabajos.
+***************************************************************************************************/
+static bool sacarTrabajo(itemTrabajo *item)  {
+	uint32_t estado;
+
+	estado=irqOffGuardar();
+	if(escritura==lectura)  {
+		irqRestaurar(estado);
+		return false;
+		}
+	*item=trabajos[lectura & (OS_TRABAJO_CANT-1)];
+	lectura++;
+	irqRestaurar(estado);
+
+	return true;
+}
+
+
+/*************************************************************************************************
+	 *  @brief Tarea worker.
+     *
+     *  @details
+     *   Espera que haya trabajos y los ejecuta todos antes de volver a esperar. Si un trabajo
+     *   se encola mientras tanto, el give queda registrado en el semáforo y no se pierde.
+     *
+	 *  @param 		None
+	 *  @return     None.
+***************************************************************************************************/
+static void tareaTrabajo(void)  {
+	itemTrabajo item;
+
+	while(1)  {
+		os_SemaforoTake(&pendientes, portMax_DELAY);
+		while(sacarTrabajo(&item))
+			item.funcion(item.argumento);
+		}
+}
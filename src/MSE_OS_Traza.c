@@ -0,0 +1,71 @@
+/*=============================================================================
+ * Author: Pablo Daniel Folino  <pfolino@gmail.com>
+ * Date: 2021/08/14
+ * Archivo: MSE_OS_Traza.c
+ * Version: 1
+ *===========================================================================*/
+/*Descripción:
+ * Este módulo implementa la traza del kernel. Cada punto de traza escribe un
+ * registro de 8 bytes (tiempo en ciclos, evento, tarea y un dato) en un buffer
+ * circular en RAM, pisando los más viejos. La marca de tiempo es
+ * os_getCiclos() (el contador de ciclos del DWT, o el SysTick si no cuenta).
+ * El buffer se vuelca con el debugger y se decodifica en la PC con
+ * tools/traza_a_json.py, que genera un JSON para chrome://tracing o Perfetto
+ * con una línea de tiempo por tarea.
+ *
+ *===========================================================================*/
+
+
+#include "MSE_OS_Traza.h"
+
+#if OS_TRAZA
+
+#if (OS_TRAZA_CANT_REGISTROS & (OS_TRAZA_CANT_REGISTROS-1)) != 0
+#error "OS_TRAZA_CANT_REGISTROS debe ser potencia de 2"
+#endif
+
+traza os_traza;
+
+
+/*************************************************************************************************
+	 *  @brief Inicializa la traza.
+     *
+     *  @details
+     *   Borra el buffer. La llama os_Init(), luego de habilitar el contador de ciclos.
+     *
+	 *  @param 		None.
+	 *  @return     None.
+***************************************************************************************************/
+void os_TrazaInit(void)  {
+	os_traza.magico=OS_TRAZA_MAGICO;
+	os_traza.cantRegistros=OS_TRAZA_CANT_REGISTROS;
+	os_traza.frecuencia=SystemCoreClock;
+	os_traza.indice=0;
+}
+
+/*************************************************************************************************
+	 *  @brief Agrega un registro a la traza.
+     *
+     *  @details
+     *   Se puede llamar desde las tareas, desde el kernel y desde las interrupciones que usan
+     *   el kernel. Se reserva el lugar y se escribe el registro dentro de una sección crítica
+     *   corta, para que los registros queden en orden de tiempo.
+     *
+	 *  @param 		evento, task (puede ser NULL), dato (se guardan los 16 bits bajos).
+	 *  @return     None.
+***************************************************************************************************/
+void os_TrazaRegistrar(eventoTraza evento, const tarea *task, uint32_t dato)  {
+	registroTraza *reg;
+	uint32_t estado;
+
+	estado=irqOffGuardar();
+	reg=&os_traza.registro[os_traza.indice & (OS_TRAZA_CANT_REGISTROS-1)];
+	os_traza.indice++;
+	reg->tiempo=os_getCiclos();
+	reg->evento=(uint8_t)evento;
+	reg->tarea=(task!=NULL) ? task->id : OS_TRAZA_SIN_TAREA;
+	reg->dato=(uint16_t)dato;
+	irqRestaurar(estado);
+}
+
+#endif
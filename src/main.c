@@ -67,6 +67,9 @@
 
 #define antiRebote		30
 
+#define EVENTO_TECLA1	(1<<0)		// Bits de eventosTeclas
+#define EVENTO_TECLA2	(1<<1)
+
 /*==================[internal data definition]===============================*/
 enum _estadoBot  {
 	NIVEL_1,
@@ -105,10 +108,15 @@ typedef struct _statusBotones statusBotones;
 tarea estadoTareaBoton1,estadoTareaBoton2;
 tarea estadoTareaUpdate,estadoTareaLed;
 
+// tareaUpdate usa itoa() y uartWriteString(), se le da un stack propio más grande
+static uint32_t stackTareaUpdate[512/4] __attribute__((aligned(8)));
+
 // Creo los semáforos binarios
 semaforo semTecla1_descendente, semTecla1_ascendente;
 semaforo semTecla2_descendente, semTecla2_ascendente;
-semaforo semTecla1_OK, semTecla2_OK;
+
+// Avisa a tareaUpdate que cada tecla completó sus dos flancos
+eventos eventosTeclas;
 
 cola bufferLed;			// Creo una cola
 
@@ -255,7 +263,7 @@ void tareaBoton1(void)  {
 					}
 				else{
 					// Informo que el boton 1 se produjeron los dos flancos
-					os_SemaforoGive(&semTecla1_OK);
+					os_EventosSet(&eventosTeclas,EVENTO_TECLA1);
 					}
 				}
 			}
@@ -288,7 +296,7 @@ void tareaBoton2(void)  {
 					}
 				else{
 					// Se informa que se tocaron las teclas en forma no intercalada
-					os_SemaforoGive(&semTecla2_OK);
+					os_EventosSet(&eventosTeclas,EVENTO_TECLA2);
 					}
 				}
 			}
@@ -304,9 +312,9 @@ void tareaUpdate(void)  {
 	char s_ascendente[8],s_descendente[8];
 
 	while (1) {
-		// Espero que se presionen las dos teclas
-		os_SemaforoTake(&semTecla1_OK, portMax_DELAY);
-		os_SemaforoTake(&semTecla2_OK, portMax_DELAY);
+		// Espero que se presionen las dos teclas, en cualquier orden
+		os_EventosEsperar(&eventosTeclas, EVENTO_TECLA1|EVENTO_TECLA2,
+						  EVENTOS_ESPERAR_TODOS|EVENTOS_BORRAR_AL_SALIR, portMax_DELAY);
 
 //		//===================================
 //		tareaDelay(2000);
@@ -401,22 +409,22 @@ void tareaLed(void)  {
 //==============================================================================
 //==================[Atención a Interrupciones]=================================
 void tecla1_flanco_desc(void) {
-	os_SemaforoGive(&semTecla1_descendente);
+	os_SemaforoGiveFromISR(&semTecla1_descendente);
 	Chip_PININT_ClearIntStatus( LPC_GPIO_PIN_INT, PININTCH( 0 ) );
 }
 
 void tecla1_flanco_asc(void)  {
-	os_SemaforoGive(&semTecla1_ascendente);
+	os_SemaforoGiveFromISR(&semTecla1_ascendente);
 	Chip_PININT_ClearIntStatus( LPC_GPIO_PIN_INT, PININTCH( 1 ) );
 }
 
 void tecla2_flanco_desc(void) {
-	os_SemaforoGive(&semTecla2_descendente);
+	os_SemaforoGiveFromISR(&semTecla2_descendente);
 	Chip_PININT_ClearIntStatus( LPC_GPIO_PIN_INT, PININTCH( 2 ) );
 }
 
 void tecla2_flanco_asc(void)  {
-	os_SemaforoGive(&semTecla2_ascendente);
+	os_SemaforoGiveFromISR(&semTecla2_ascendente);
 	Chip_PININT_ClearIntStatus( LPC_GPIO_PIN_INT, PININTCH( 3 ) );
 }
 
@@ -434,7 +442,7 @@ int main(void)  {
 	os_InitTarea(tareaBoton1, &estadoTareaBoton1,PRIORIDAD_0);
 	os_InitTarea(tareaBoton2, &estadoTareaBoton2,PRIORIDAD_0);
 	os_InitTarea(tareaLed, &estadoTareaLed,PRIORIDAD_1);
-	os_InitTarea(tareaUpdate, &estadoTareaUpdate,PRIORIDAD_0);
+	os_InitTareaStack(tareaUpdate, &estadoTareaUpdate,PRIORIDAD_0,stackTareaUpdate,sizeof(stackTareaUpdate));
 
 	// Configuro la cola
 	os_ColaInit(&bufferLed,sizeof(dataLed));
@@ -443,8 +451,7 @@ int main(void)  {
 	os_SemaforoInit(&semTecla1_descendente);
 	os_SemaforoInit(&semTecla2_ascendente);
 	os_SemaforoInit(&semTecla2_descendente);
-	os_SemaforoInit(&semTecla1_OK);
-	os_SemaforoInit(&semTecla2_OK);
+	os_EventosInit(&eventosTeclas);
 	// Instalo las interrupciones
 	os_InstalarIRQ(PIN_INT0_IRQn,tecla1_flanco_desc);
 	os_InstalarIRQ(PIN_INT1_IRQn,tecla1_flanco_asc);
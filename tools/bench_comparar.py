@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+# =============================================================================
+# Author: Pablo Daniel Folino  <pfolino@gmail.com>
+# Date: 2021/08/14
+# Archivo: bench_comparar.py
+# Version: 1
+# =============================================================================
+# Descripción:
+#  Compara dos corridas de los benchmarks del kernel (bench/qemu-mps2, una
+#  línea JSON por resultado) y muestra la variación de ciclos por operación.
+#  Termina con código 1 si algún benchmark empeoró más que el umbral, para
+#  usarlo en integración continua:
+#      python3 bench_comparar.py anterior.jsonl nuevo.jsonl [-u 5]
+# =============================================================================
+
+import argparse
+import json
+import sys
+
+
+def leer_resultados(archivo):
+    """Devuelve {bench: ciclos por operación} con las líneas de resultados del archivo.
+
+    Se usa el total de ciclos sobre n y no ciclos_op, que está truncado a entero."""
+    resultados = {}
+    with open(archivo, encoding="utf-8") as entrada:
+        for linea in entrada:
+            linea = linea.strip()
+            if not linea.startswith("{"):
+                continue
+            dato = json.loads(linea)
+            if dato.get("bench") in ("error", "falla"):
+                sys.exit(f"{archivo}: la corrida terminó con error: {linea}")
+            if dato.get("n"):
+                resultados[dato["bench"]] = dato["ciclos"] / dato["n"]
+    if not resultados:
+        sys.exit(f"{archivo}: no tiene resultados")
+    return resultados
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compara dos corridas de benchmarks del kernel")
+    parser.add_argument("anterior", help="resultados de referencia")
+    parser.add_argument("nuevo", help="resultados a comparar")
+    parser.add_argument("-u", "--umbral", type=float, default=5.0,
+                        help="empeoramiento máximo aceptado en %% (por defecto 5)")
+    args = parser.parse_args()
+
+    anterior = leer_resultados(args.anterior)
+    nuevo = leer_resultados(args.nuevo)
+
+    peores = []
+    print(f"{'bench':<22}{'anterior':>12}{'nuevo':>12}{'variación':>12}")
+    for bench in anterior:
+        if bench not in nuevo:
+            print(f"{bench:<22}{anterior[bench]:>12.2f}{'-':>12}{'falta':>12}")
+            peores.append(bench)
+            continue
+        variacion = 100.0 * (nuevo[bench] - anterior[bench]) / anterior[bench] if anterior[bench] else 0.0
+        print(f"{bench:<22}{anterior[bench]:>12.2f}{nuevo[bench]:>12.2f}{variacion:>+11.1f}%")
+        if variacion > args.umbral:
+            peores.append(bench)
+    for bench in nuevo:
+        if bench not in anterior:
+            print(f"{bench:<22}{'-':>12}{nuevo[bench]:>12.2f}{'nuevo':>12}")
+
+    if peores:
+        print(f"empeoraron más de {args.umbral}%: {', '.join(peores)}")
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
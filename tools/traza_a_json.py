@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+# =============================================================================
+# Author: Pablo Daniel Folino  <pfolino@gmail.com>
+# Date: 2021/08/14
+# Archivo: traza_a_json.py
+# Version: 1
+# =============================================================================
+# Descripción:
+#  Decodifica un volcado de la traza del kernel (os_traza, ver MSE_OS_Traza.h)
+#  y genera un JSON en el formato de Chrome/Perfetto (chrome://tracing o
+#  ui.perfetto.dev), con una línea de tiempo por tarea y otra para las
+#  interrupciones.
+#
+#  El volcado se obtiene con el debugger:
+#      (gdb) dump binary value traza.bin os_traza
+#  y se decodifica con:
+#      python3 traza_a_json.py traza.bin -o traza.json [-n 0=tareaLed,1=tareaUpdate]
+# =============================================================================
+
+import argparse
+import json
+import struct
+import sys
+
+MAGICO = 0x415A5254
+SIN_TAREA = 0xFF
+PID = 1
+TID_IRQ = 1000
+
+CAMBIO_CONTEXTO = 1
+TICK = 2
+IRQ_ENTRA = 3
+IRQ_SALE = 4
+SEMAFORO_BLOQUEA = 5
+SEMAFORO_DESBLOQUEA = 6
+COLA_BLOQUEA = 7
+COLA_DESBLOQUEA = 8
+
+NOMBRE_EVENTO = {
+    TICK: "tick",
+    SEMAFORO_BLOQUEA: "semaforo bloquea",
+    SEMAFORO_DESBLOQUEA: "semaforo desbloquea",
+    COLA_BLOQUEA: "cola bloquea",
+    COLA_DESBLOQUEA: "cola desbloquea",
+}
+
+
+def leer_registros(datos):
+    """Devuelve (frecuencia, registros) con los registros en orden cronológico."""
+    magico, cant, frecuencia, indice = struct.unpack_from("<4I", datos, 0)
+    if magico != MAGICO:
+        sys.exit("el volcado no empieza con el número mágico de la traza")
+    if frecuencia == 0:
+        sys.exit("frecuencia cero: os_TrazaInit() no se ejecutó")
+
+    validos = min(indice, cant)
+    registros = []
+    for n in range(indice - validos, indice):
+        tiempo, evento, tarea, dato = struct.unpack_from("<IBBH", datos, 16 + 8 * (n % cant))
+        registros.append((tiempo, evento, tarea, dato))
+    return frecuencia, registros
+
+
+def a_microsegundos(registros, frecuencia):
+    """Desenrolla el contador de ciclos de 32 bits y lo pasa a us desde el primer registro."""
+    salida = []
+    acumulado = 0
+    anterior = registros[0][0] if registros else 0
+    for tiempo, evento, tarea, dato in registros:
+        acumulado += (tiempo - anterior) & 0xFFFFFFFF
+        anterior = tiempo
+        salida.append((acumulado * 1e6 / frecuencia, evento, tarea, dato))
+    return salida
+
+
+def generar_eventos(registros, nombres):
+    eventos = []
+    tareas = set()
+    corriendo = None                # (tarea, inicio)
+    irqs = []                       # pila de (irq, inicio) por el anidamiento
+
+    def nombre_tarea(tarea):
+        return nombres.get(tarea, "tarea %d" % tarea)
+
+    for ts, evento, tarea, dato in registros:
+        if tarea != SIN_TAREA:
+            tareas.add(tarea)
+
+        if evento == CAMBIO_CONTEXTO:
+            if corriendo is not None:
+                eventos.append({"name": nombre_tarea(corriendo[0]), "ph": "X", "pid": PID,
+                                "tid": corriendo[0], "ts": corriendo[1], "dur": ts - corriendo[1]})
+            corriendo = (tarea, ts)
+        elif evento == IRQ_ENTRA:
+            irqs.append((dato, ts))
+        elif evento == IRQ_SALE:
+            if irqs:
+                irq, inicio = irqs.pop()
+                eventos.append({"name": "IRQ %d" % irq, "ph": "X", "pid": PID, "tid": TID_IRQ,
+                                "ts": inicio, "dur": ts - inicio})
+        elif evento in NOMBRE_EVENTO:
+            args = {"dato": "0x%04X" % dato} if evento != TICK else {"tick": dato}
+            eventos.append({"name": NOMBRE_EVENTO[evento], "ph": "i", "s": "t", "pid": PID,
+                            "tid": tarea if tarea != SIN_TAREA else TID_IRQ, "ts": ts,
+                            "args": args})
+
+    # La tarea que estaba corriendo al volcar la traza
+    if corriendo is not None and registros:
+        eventos.append({"name": nombre_tarea(corriendo[0]), "ph": "X", "pid": PID,
+                        "tid": corriendo[0], "ts": corriendo[1],
+                        "dur": registros[-1][0] - corriendo[1]})
+
+    metadatos = [{"name": "process_name", "ph": "M", "pid": PID, "args": {"name": "MSE_OS"}},
+                 {"name": "thread_name", "ph": "M", "pid": PID, "tid": TID_IRQ,
+                  "args": {"name": "interrupciones"}}]
+    for tarea in sorted(tareas):
+        metadatos.append({"name": "thread_name", "ph": "M", "pid": PID, "tid": tarea,
+                          "args": {"name": nombre_tarea(tarea)}})
+    return metadatos + eventos
+
+
+def parsear_nombres(texto):
+    nombres = {}
+    if texto:
+        for par in texto.split(","):
+            tarea, nombre = par.split("=", 1)
+            nombres[int(tarea)] = nombre
+    return nombres
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decodifica la traza binaria de MSE_OS")
+    parser.add_argument("volcado", help="archivo binario con el contenido de os_traza")
+    parser.add_argument("-o", "--salida", default="-", help="archivo JSON (por defecto stdout)")
+    parser.add_argument("-n", "--nombres", help="nombres de las tareas: id=nombre,id=nombre")
+    args = parser.parse_args()
+
+    with open(args.volcado, "rb") as archivo:
+        frecuencia, registros = leer_registros(archivo.read())
+
+    eventos = generar_eventos(a_microsegundos(registros, frecuencia),
+                              parsear_nombres(args.nombres))
+    salida = sys.stdout if args.salida == "-" else open(args.salida, "w")
+    json.dump({"traceEvents": eventos, "displayTimeUnit": "ns"}, salida, indent=1)
+    if salida is not sys.stdout:
+        salida.close()
+
+
+if __name__ == "__main__":
+    main()